@@ -0,0 +1,374 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include "synthetic.h"
+
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+static void BM_SetIValue_Levels(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    ColumnW column = data.dataset()["txt"];
+
+    const int N = 4096;
+    vector<int> rowNos = SyntheticData::randomInts(N, 0, rows - 1, 10);
+    vector<int> values = SyntheticData::randomInts(N, 0, levels - 1, 11);
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        column.setIValue(rowNos[i % N], values[i % N]);
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetIValue_Levels)->Apply(rowsAndLevels)->Unit(benchmark::kNanosecond);
+
+static void BM_SetDValue(benchmark::State &state)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(2);
+    ColumnW column = data.dataset()["dec"];
+
+    const int N = 4096;
+    vector<int> rowNos = SyntheticData::randomInts(N, 0, rows - 1, 10);
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        column.setDValue(rowNos[i % N], (double)i);
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetDValue)->Apply(rowsOnly)->Unit(benchmark::kNanosecond);
+
+static void BM_AppendLevel(benchmark::State &state)
+{
+    int levels = state.range(0);
+
+    SyntheticData data(0);
+    ColumnW column = data.addTextNominal("txt", 1);
+
+    vector<string> labels;
+    for (int i = 0; i < levels; i++)
+    {
+        stringstream ss;
+        ss << "level " << i;
+        labels.push_back(ss.str());
+    }
+
+    for (auto _ : state)
+    {
+        column.clearLevels();
+        for (int i = 0; i < levels; i++)
+            column.appendLevel(i, labels[i].c_str(), labels[i].c_str());
+    }
+
+    state.SetItemsProcessed(state.iterations() * levels);
+}
+BENCHMARK(BM_AppendLevel)->RangeMultiplier(8)->Range(8, 32768)->ArgNames({ "levels" });
+
+static void BM_InsertLevel(benchmark::State &state)
+{
+    int levels = state.range(0);
+
+    SyntheticData data(0);
+    ColumnW column = data.addIntegerNominal("nom", 1);
+
+    for (auto _ : state)
+    {
+        column.clearLevels();
+        for (int i = 0; i < levels; i++)
+            column.insertLevel(i);
+    }
+
+    state.SetItemsProcessed(state.iterations() * levels);
+}
+BENCHMARK(BM_InsertLevel)->RangeMultiplier(8)->Range(8, 32768)->ArgNames({ "levels" });
+
+static void BM_BuildLevels(benchmark::State &state)
+{
+    int levels = state.range(0);
+
+    SyntheticData data(0);
+    ColumnW column = data.addTextNominal("txt", 1);
+
+    vector<LevelData> newLevels;
+    for (int i = 0; i < levels; i++)
+    {
+        stringstream ss;
+        ss << "level " << i;
+        newLevels.push_back(LevelData(ss.str().c_str(), ss.str().c_str()));
+    }
+
+    for (auto _ : state)
+        column.buildLevels(newLevels);
+
+    state.SetItemsProcessed(state.iterations() * levels);
+}
+BENCHMARK(BM_BuildLevels)->RangeMultiplier(8)->Range(8, 32768)->ArgNames({ "levels" });
+
+static void BM_SetLevels(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    ColumnW column = data.dataset()["nom"];
+    const vector<LevelData> newLevels = column.levels();
+
+    for (auto _ : state)
+        column.setLevels(newLevels);
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_SetLevels)->Apply(rowsAndLevels);
+
+static void BM_TrimUnusedLevels(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    ColumnW column = data.dataset()["txt"];
+
+    // as many unused levels again, in among the used
+    vector<LevelData> withUnused;
+    for (const LevelData &level : column.levels())
+    {
+        withUnused.push_back(level);
+        stringstream ss;
+        ss << "unused " << level.svalue();
+        withUnused.push_back(LevelData(ss.str().c_str(), ss.str().c_str()));
+    }
+
+    vector<int> values = SyntheticData::randomInts(rows, 0, levels - 1);
+    for (int &value : values)
+        value *= 2;  // the used levels, among the unused
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        column.setIValues(0, values);
+        column.buildLevels(withUnused);  // which counts the rows again
+        state.ResumeTiming();
+
+        column.trimUnusedLevels();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_TrimUnusedLevels)->Apply(fewRowsAndLevels);
+
+static void BM_ChangeDMType(
+    benchmark::State &state,
+    const char *columnName,
+    DataType::Type dataType,
+    MeasureType::Type measureType)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    DataSetW &ds = data.dataset();
+    ColumnW column = ds[columnName];
+
+    DataType::Type oldDataType = column.dataType();
+    MeasureType::Type oldMeasureType = column.measureType();
+
+    for (auto _ : state)
+    {
+        // discard the scratch column, otherwise changing back is just a swap
+        ds.discardScratchColumn(column.id());
+        column.changeDMType(dataType, measureType);
+        ds.discardScratchColumn(column.id());
+        column.changeDMType(oldDataType, oldMeasureType);
+    }
+
+    state.SetItemsProcessed(2 * state.iterations() * rows);
+}
+// conversions of continuous columns create a level per distinct value,
+// and so are kept small
+BENCHMARK_CAPTURE(BM_ChangeDMType, int_to_nominal, "int", DataType::INTEGER, MeasureType::NOMINAL)->Apply(fewRowsAndLevels);
+BENCHMARK_CAPTURE(BM_ChangeDMType, dec_to_nominal_text, "dec", DataType::TEXT, MeasureType::NOMINAL)->Apply(fewRowsAndLevels);
+BENCHMARK_CAPTURE(BM_ChangeDMType, nom_to_continuous, "nom", DataType::INTEGER, MeasureType::CONTINUOUS)->Apply(rowsAndLevels);
+BENCHMARK_CAPTURE(BM_ChangeDMType, txt_to_decimal, "txt", DataType::DECIMAL, MeasureType::CONTINUOUS)->Apply(rowsAndLevels);
+BENCHMARK_CAPTURE(BM_ChangeDMType, txt_to_id, "txt", DataType::TEXT, MeasureType::ID)->Apply(rowsAndLevels);
+
+static void BM_ChangeDMTypes(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+    const int N = 8;
+
+    SyntheticData data(rows);
+    DataSetW &ds = data.dataset();
+
+    vector<ColumnChange> toDecimal;
+    vector<ColumnChange> toText;
+
+    for (int i = 0; i < N; i++)
+    {
+        stringstream ss;
+        ss << "txt" << i;
+        ColumnW column = data.addTextNominal(ss.str().c_str(), levels);
+        toDecimal.push_back({ column.id(), DataType::DECIMAL, MeasureType::CONTINUOUS });
+        toText.push_back({ column.id(), DataType::TEXT, MeasureType::NOMINAL });
+    }
+
+    for (auto _ : state)
+    {
+        // discard the scratch column, otherwise changing back is just a swap
+        ds.discardScratchColumn(toDecimal[0].id);
+        ds.changeDMTypes(toDecimal);
+        ds.discardScratchColumn(toText[0].id);
+        ds.changeDMTypes(toText);
+    }
+
+    state.SetItemsProcessed(2 * state.iterations() * rows * N);
+}
+// each batch leaves the old innards of all but its last column behind in
+// the memory map, and so these are kept small
+BENCHMARK(BM_ChangeDMTypes)->Apply(fewRowsAndLevels)->UseRealTime();
+
+static void BM_UpdateLevelCounts(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    ColumnW column = data.dataset()["txt"];
+
+    for (auto _ : state)
+        column.updateLevelCounts();
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_UpdateLevelCounts)->Apply(rowsAndLevels);
+
+static void BM_ScanRawDouble(benchmark::State &state)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(2);
+    ColumnW column = data.dataset()["dec"];
+
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (int i = 0; i < rows; i++)
+        {
+            double value = column.raw<double>(i);
+            if ( ! std::isnan(value))
+                sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_ScanRawDouble)->Apply(rowsOnly);
+
+static void shouldTreatAsMissing(benchmark::State &state, const char *columnName, int levels)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    ColumnW column = data.dataset()[columnName];
+
+    MissingValue mv;
+    mv.type = 2;  // integer
+    mv.optr = 0;  // ==
+    mv.value.i = 1;
+    column.setMissingValues(vector<MissingValue>{ mv });
+
+    for (auto _ : state)
+    {
+        int count = 0;
+        for (int i = 0; i < rows; i++)
+            count += column.shouldTreatAsMissing(i);
+        benchmark::DoNotOptimize(count);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+static void BM_ShouldTreatAsMissing_Continuous(benchmark::State &state, const char *columnName)
+{
+    shouldTreatAsMissing(state, columnName, 2);
+}
+BENCHMARK_CAPTURE(BM_ShouldTreatAsMissing_Continuous, int, "int")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_ShouldTreatAsMissing_Continuous, dec, "dec")->Apply(rowsOnly);
+
+static void BM_ShouldTreatAsMissing_Levels(benchmark::State &state, const char *columnName)
+{
+    shouldTreatAsMissing(state, columnName, state.range(1));
+}
+BENCHMARK_CAPTURE(BM_ShouldTreatAsMissing_Levels, nom, "nom")->Apply(rowsAndLevels);
+BENCHMARK_CAPTURE(BM_ShouldTreatAsMissing_Levels, txt, "txt")->Apply(rowsAndLevels);
+
+static void BM_SValue(benchmark::State &state, const char *columnName)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(32);
+    ColumnW column = data.dataset()[columnName];
+    char buffer[Column::FORMAT_BUFFER_SIZE];
+
+    for (auto _ : state)
+    {
+        size_t length = 0;
+        for (int i = 0; i < rows; i++)
+            length += strlen(column.svalue(i, buffer));
+        benchmark::DoNotOptimize(length);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK_CAPTURE(BM_SValue, int, "int")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValue, dec, "dec")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValue, txt, "txt")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValue, id, "id")->Apply(rowsOnly);
+
+static void BM_SValues(benchmark::State &state, const char *columnName)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(32);
+    ColumnW column = data.dataset()[columnName];
+    vector<char> arena;
+    vector<int> offsets;
+
+    for (auto _ : state)
+    {
+        column.svalues(0, rows, arena, offsets);
+        benchmark::DoNotOptimize(arena.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK_CAPTURE(BM_SValues, int, "int")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValues, dec, "dec")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValues, txt, "txt")->Apply(rowsOnly);
+BENCHMARK_CAPTURE(BM_SValues, id, "id")->Apply(rowsOnly);
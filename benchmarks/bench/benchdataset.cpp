@@ -0,0 +1,112 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include "synthetic.h"
+
+using namespace std;
+
+static void BM_RefreshFilterState(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    data.addFilter(0.3);
+    DataSetW &ds = data.dataset();
+
+    for (auto _ : state)
+        ds.refreshFilterState();
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_RefreshFilterState)->Apply(rowsAndLevels);
+
+static void BM_IsRowFiltered(benchmark::State &state)
+{
+    int rows = state.range(0);
+
+    SyntheticData data(rows);
+    data.populateMixed(2);
+    data.addFilter(0.3);
+    DataSetW &ds = data.dataset();
+
+    for (auto _ : state)
+    {
+        int count = 0;
+        for (int i = 0; i < rows; i++)
+            count += ds.isRowFiltered(i);
+        benchmark::DoNotOptimize(count);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_IsRowFiltered)->Apply(rowsOnly);
+
+static void BM_DeleteRows(benchmark::State &state)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+    const int N = 100;
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    DataSetW &ds = data.dataset();
+
+    for (auto _ : state)
+    {
+        ds.deleteRows(rows / 2, rows / 2 + N - 1);
+
+        state.PauseTiming();
+        ds.appendRows(N);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_DeleteRows)->Apply(rowsAndLevels);
+
+static void BM_InsertRows(benchmark::State &state)
+{
+    int rows = state.range(0);
+    const int N = 100;
+
+    SyntheticData data(rows);
+    data.populateMixed(2);
+    DataSetW &ds = data.dataset();
+
+    for (auto _ : state)
+    {
+        ds.insertRows(rows / 2, rows / 2 + N - 1);
+
+        state.PauseTiming();
+        ds.setRowCount(rows);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_InsertRows)->Apply(rowsOnly);
+
+static void BM_AppendRows(benchmark::State &state)
+{
+    int rows = state.range(0);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        SyntheticData *data = new SyntheticData(0);
+        data->populateMixed(2);
+        state.ResumeTiming();
+
+        data->dataset().appendRows(rows);
+
+        state.PauseTiming();
+        delete data;
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_AppendRows)->Apply(rowsOnly);
@@ -0,0 +1,42 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include "synthetic.h"
+
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+static void BM_Enlarge(benchmark::State &state)
+{
+    // enlarging a map with every page written to, as when a data set
+    // is edited after it's been loaded
+    size_t size = (size_t)state.range(0) * 1024 * 1024;
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path("jamovi-bench-%%%%%%%%.mm");
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        MemoryMapW *mm = MemoryMapW::create(path.string(), size);
+        char *data = mm->allocateSize<char>(size - 64 * 1024);
+        memset(data, 1, size - 64 * 1024);
+        state.ResumeTiming();
+
+        mm->enlarge();
+
+        state.PauseTiming();
+        delete mm;
+        state.ResumeTiming();
+    }
+
+    boost::system::error_code ec;
+    fs::remove(path, ec);
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Enlarge)->RangeMultiplier(4)->Range(16, 1024)->ArgNames({ "mb" })->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,122 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include "synthetic.h"
+
+#include <string>
+#include <vector>
+#include <climits>
+#include <cmath>
+
+#include "memorymap.h"
+#include "dataset.h"
+#include "dfvalues.h"
+
+using namespace std;
+
+/*
+ * readDF() from engine/engine/readdf.cpp, with the R vectors replaced by
+ * std::vectors. the R allocations aren't what we're interested in here,
+ * it's the reading from the memory map, which is shared with readDF()
+ * through DFValues (dfvalues.h)
+ */
+
+namespace
+{
+    const int NA_INTEGER = INT_MIN;
+    const double NA_REAL = NAN;
+
+    struct RColumn
+    {
+        string name;
+        vector<int> ivalues;
+        vector<double> dvalues;
+        vector<string> svalues;
+        vector<string> levels;
+        vector<int> values;
+    };
+}
+
+static vector<RColumn> readDF(const string &path, bool requiresMissings)
+{
+    MemoryMap *mm = MemoryMap::attach(path);
+    DataSet &dataset = *DataSet::retrieve(mm);
+
+    int columnCount = dataset.columnCount();
+    int rowCount = dataset.rowCount();
+    int rowCountExFiltered = dataset.rowCountExFiltered();
+
+    vector<int> rows = DFValues::rows(dataset, rowCount);
+
+    vector<string> rowNames(rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+        rowNames[i] = std::to_string(rows[i] + 1);
+
+    vector<RColumn> columns;
+
+    for (int i = 0; i < columnCount; i++)
+    {
+        Column column = dataset[i];
+
+        if (column.columnType() == ColumnType::FILTER)
+            continue;
+
+        columns.emplace_back();
+        RColumn &out = columns.back();
+        out.name = column.name();
+
+        if (column.dataType() == DataType::DECIMAL)
+        {
+            out.dvalues.assign(rowCountExFiltered, NA_REAL);
+            DFValues::decimals(column, rows, out.dvalues);
+        }
+        else if (column.dataType() == DataType::INTEGER && ! column.hasLevels())
+        {
+            out.ivalues.assign(rowCountExFiltered, NA_INTEGER);
+            DFValues::integers(column, rows, out.ivalues);
+        }
+        else if (column.dataType() == DataType::TEXT &&
+                 column.measureType() == MeasureType::ID)
+        {
+            out.svalues.assign(rowCountExFiltered, string());
+            DFValues::ids(column, rows, out.svalues);
+        }
+        else
+        {
+            out.ivalues.assign(rowCountExFiltered, NA_INTEGER);
+            DFValues::levels(column, rows, requiresMissings, NA_INTEGER, out.ivalues,
+                [&](int value, const char *label, bool) {
+                    out.values.push_back(value);
+                    out.levels.push_back(label);
+                });
+        }
+    }
+
+    delete &dataset;
+    delete mm;
+
+    return columns;
+}
+
+static void BM_ReadDF(benchmark::State &state, bool filtered, bool requiresMissings)
+{
+    int rows = state.range(0);
+    int levels = state.range(1);
+
+    SyntheticData data(rows);
+    data.populateMixed(levels);
+    if (filtered)
+        data.addFilter(0.3);
+
+    for (auto _ : state)
+    {
+        vector<RColumn> columns = readDF(data.path(), requiresMissings);
+        benchmark::DoNotOptimize(columns.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK_CAPTURE(BM_ReadDF, unfiltered, false, false)->Apply(rowsAndLevels);
+BENCHMARK_CAPTURE(BM_ReadDF, filtered, true, false)->Apply(rowsAndLevels);
+BENCHMARK_CAPTURE(BM_ReadDF, requires_missings, false, true)->Apply(rowsAndLevels);
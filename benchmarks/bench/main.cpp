@@ -0,0 +1,7 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
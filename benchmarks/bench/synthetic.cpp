@@ -0,0 +1,184 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#include "synthetic.h"
+
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+#include <boost/filesystem.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+SyntheticData::SyntheticData(int rowCount)
+{
+    _rowCount = rowCount;
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path("jamovi-bench-%%%%%%%%.mm");
+    _path = path.string();
+
+    // size the buffer up front, so we're not benchmarking enlarge()
+    unsigned long long size = 4 * 1024 * 1024 + (unsigned long long)rowCount * 64;
+    _mm = MemoryMapW::create(_path, size);
+    _ds = DataSetW::create(_mm);
+    _ds->setRowCount(rowCount);
+}
+
+SyntheticData::~SyntheticData()
+{
+    delete _ds;
+    delete _mm;
+
+    boost::system::error_code ec;
+    fs::remove(fs::path(_path), ec);
+}
+
+void SyntheticData::populateMixed(int levels)
+{
+    addIntegerContinuous("int");
+    addDecimal("dec");
+    addIntegerNominal("nom", levels);
+    addTextNominal("txt", levels);
+    addTextID("id");
+    _ds->refreshFilterState();
+}
+
+vector<int> SyntheticData::randomInts(size_t n, int min, int max, unsigned seed)
+{
+    mt19937 gen(seed);
+    uniform_int_distribution<int> dist(min, max);
+    vector<int> values(n);
+    for (size_t i = 0; i < n; i++)
+        values[i] = dist(gen);
+    return values;
+}
+
+ColumnW SyntheticData::addColumn(const char *name, DataType::Type dataType, MeasureType::Type measureType)
+{
+    ColumnW column = _ds->appendColumn(name, name);
+    column.setDataType(dataType);
+    column.setMeasureType(measureType);  // these allocate the appropriate space
+    return column;
+}
+
+ColumnW SyntheticData::addFilter(double proportionFiltered)
+{
+    // filters live at the start of the data set
+    ColumnW column = _ds->insertColumn(0, "Filter 1", "");
+    column.setColumnType(ColumnType::FILTER);
+    column.appendLevel(0, "false");
+    column.appendLevel(1, "true");
+
+    mt19937 gen(7);
+    bernoulli_distribution dist(proportionFiltered);
+    for (int i = 0; i < _rowCount; i++)
+        column.setIValue(i, dist(gen) ? 0 : 1, true);
+
+    _ds->refreshFilterState();
+
+    return column;
+}
+
+ColumnW SyntheticData::addIntegerContinuous(const char *name)
+{
+    ColumnW column = addColumn(name, DataType::INTEGER, MeasureType::CONTINUOUS);
+    vector<int> values = randomInts(_rowCount, -100000, 100000, 1);
+    for (int i = 0; i < _rowCount; i++)
+        column.setIValue(i, (i % 97 == 0) ? INT_MIN : values[i], true);
+    return column;
+}
+
+ColumnW SyntheticData::addDecimal(const char *name)
+{
+    ColumnW column = addColumn(name, DataType::DECIMAL, MeasureType::CONTINUOUS);
+    column.setDPs(3);
+
+    mt19937 gen(2);
+    normal_distribution<double> dist(100, 15);
+    for (int i = 0; i < _rowCount; i++)
+    {
+        double value = round(dist(gen) * 1000) / 1000;
+        column.setDValue(i, (i % 97 == 0) ? NAN : value, true);
+    }
+    return column;
+}
+
+ColumnW SyntheticData::addIntegerNominal(const char *name, int levels)
+{
+    ColumnW column = addColumn(name, DataType::INTEGER, MeasureType::NOMINAL);
+
+    for (int i = 1; i <= levels; i++)
+        column.appendLevel(i);
+
+    vector<int> values = randomInts(_rowCount, 1, levels, 3);
+    for (int i = 0; i < _rowCount; i++)
+        column.setIValue(i, (i % 97 == 0) ? INT_MIN : values[i], true);
+    return column;
+}
+
+ColumnW SyntheticData::addTextNominal(const char *name, int levels)
+{
+    ColumnW column = addColumn(name, DataType::TEXT, MeasureType::NOMINAL);
+
+    for (int i = 0; i < levels; i++)
+    {
+        stringstream ss;
+        ss << "level " << setfill('0') << setw(5) << i;
+        string label = ss.str();
+        column.appendLevel(i, label.c_str(), label.c_str());
+    }
+
+    vector<int> values = randomInts(_rowCount, 0, levels - 1, 4);
+    for (int i = 0; i < _rowCount; i++)
+        column.setIValue(i, (i % 97 == 0) ? INT_MIN : values[i], true);
+    return column;
+}
+
+ColumnW SyntheticData::addTextID(const char *name)
+{
+    ColumnW column = addColumn(name, DataType::TEXT, MeasureType::ID);
+
+    for (int i = 0; i < _rowCount; i++)
+    {
+        stringstream ss;
+        ss << "ID-" << i;
+        column.setSValue(i, ss.str().c_str(), true);
+    }
+    return column;
+}
+
+void rowsAndLevels(benchmark::internal::Benchmark *b)
+{
+    for (int rows = 10000; rows <= 10000000; rows *= 10)
+    {
+        b->Args({ rows, 2 });
+        b->Args({ rows, 32 });
+        if (rows <= 1000000)
+            b->Args({ rows, 1024 });
+    }
+    b->ArgNames({ "rows", "levels" });
+    b->Unit(benchmark::kMillisecond);
+}
+
+void fewRowsAndLevels(benchmark::internal::Benchmark *b)
+{
+    for (int rows = 10000; rows <= 100000; rows *= 10)
+    {
+        b->Args({ rows, 2 });
+        b->Args({ rows, 32 });
+    }
+    b->ArgNames({ "rows", "levels" });
+    b->Unit(benchmark::kMillisecond);
+}
+
+void rowsOnly(benchmark::internal::Benchmark *b)
+{
+    for (int rows = 10000; rows <= 10000000; rows *= 10)
+        b->Args({ rows });
+    b->ArgNames({ "rows" });
+    b->Unit(benchmark::kMillisecond);
+}
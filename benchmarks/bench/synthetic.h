@@ -0,0 +1,74 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "memorymapw.h"
+#include "datasetw.h"
+#include "columnw.h"
+
+#include <benchmark/benchmark.h>
+
+/*
+ * SyntheticData creates a buffer file in the temp directory, and populates
+ * it with a reproducible (fixed seed) dataset. the buffer file is removed
+ * when the SyntheticData is destroyed.
+ *
+ * the 'mixed' dataset contains one column of each kind:
+ *
+ *   int  - INTEGER / CONTINUOUS
+ *   dec  - DECIMAL / CONTINUOUS (3 dps)
+ *   nom  - INTEGER / NOMINAL, with `levels` levels
+ *   txt  - TEXT / NOMINAL, with `levels` levels
+ *   id   - TEXT / ID
+ */
+
+class SyntheticData
+{
+public:
+
+    SyntheticData(int rowCount);
+    ~SyntheticData();
+
+    DataSetW &dataset() { return *_ds; }
+    MemoryMapW *memoryMap() { return _mm; }
+    const std::string &path() const { return _path; }
+
+    void populateMixed(int levels);
+
+    ColumnW addFilter(double proportionFiltered);
+    ColumnW addIntegerContinuous(const char *name);
+    ColumnW addDecimal(const char *name);
+    ColumnW addIntegerNominal(const char *name, int levels);
+    ColumnW addTextNominal(const char *name, int levels);
+    ColumnW addTextID(const char *name);
+
+    static std::vector<int> randomInts(size_t n, int min, int max, unsigned seed = 42);
+
+private:
+
+    ColumnW addColumn(const char *name, DataType::Type dataType, MeasureType::Type measureType);
+
+    int _rowCount;
+    std::string _path;
+    MemoryMapW *_mm;
+    DataSetW *_ds;
+};
+
+/*
+ * the row counts and level cardinalities the benchmarks are run over.
+ * high cardinalities are only run up to 1M rows, because building those
+ * datasets is itself quadratic-ish (see ColumnW::rawLevel())
+ */
+
+void rowsAndLevels(benchmark::internal::Benchmark *b);
+void fewRowsAndLevels(benchmark::internal::Benchmark *b);
+void rowsOnly(benchmark::internal::Benchmark *b);
+
+#endif // SYNTHETIC_H
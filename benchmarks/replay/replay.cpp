@@ -0,0 +1,406 @@
+//
+// Copyright (C) 2024 Jonathon Love
+//
+
+/*
+ * jamovi-replay stands in for the server. it binds a nanomsg endpoint,
+ * launches jamovi-engine against it, and feeds the engine a recording of
+ * AnalysisRequests. the time taken for each request to complete, and the
+ * size of the responses, are written out as JSON.
+ *
+ * recordings are made by the server, when JAMOVI_ENGINE_RECORD_PATH is set.
+ * each request is stored as a 4 byte (little endian) length followed by the
+ * serialized AnalysisRequest.
+ *
+ * the engine reads data sets from PATH/sessionId/instanceId/buffer; if
+ * --buffer is provided, it is copied into place for each instance in the
+ * recording, so a recording can be replayed against a prepared buffer file.
+ *
+ *   jamovi-replay --engine=ENGINE --requests=FILE --path=PATH
+ *                 [--buffer=FILE] [--repeat=N] [--timeout=SECONDS]
+ *                 [--out=FILE]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+
+#include <nanomsg/nn.h>
+#include <nanomsg/pair.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+#include "jamovi.pb.h"
+
+using namespace std;
+using namespace jamovi::coms;
+namespace fs = boost::filesystem;
+
+typedef chrono::steady_clock Clock;
+
+struct Result
+{
+    int index;
+    int repeat;
+    string ns;
+    string name;
+    int analysisId;
+    int perform;
+    double firstMs;
+    double totalMs;
+    int messages;
+    size_t bytes;
+    size_t finalBytes;
+    bool timedOut;
+};
+
+static vector<AnalysisRequest> readRequests(const string &path)
+{
+    ifstream in(path, ios::binary);
+    if ( ! in)
+        throw runtime_error("Unable to open " + path);
+
+    vector<AnalysisRequest> requests;
+
+    while (true)
+    {
+        unsigned char header[4];
+        in.read((char*)header, 4);
+        if (in.gcount() == 0)
+            break;
+        if (in.gcount() != 4)
+            throw runtime_error("Recording is truncated");
+
+        uint32_t n = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+        string payload(n, '\0');
+        in.read(&payload[0], n);
+        if ((uint32_t)in.gcount() != n)
+            throw runtime_error("Recording is truncated");
+
+        AnalysisRequest request;
+        if ( ! request.ParseFromString(payload))
+            throw runtime_error("Recording is corrupt");
+
+        requests.push_back(request);
+    }
+
+    return requests;
+}
+
+static void prepareBuffers(const vector<AnalysisRequest> &requests, const string &path, const string &buffer)
+{
+    set<string> done;
+
+    for (const AnalysisRequest &request : requests)
+    {
+        fs::path dir = fs::path(path) / request.sessionid() / request.instanceid();
+        if (done.count(dir.string()) != 0)
+            continue;
+        done.insert(dir.string());
+
+        fs::create_directories(dir);
+        fs::remove(dir / "buffer");
+        fs::copy_file(buffer, dir / "buffer");
+    }
+}
+
+static void send(int socket, int id, const AnalysisRequest &request)
+{
+    ComsMessage message;
+    message.set_id(id);
+    message.set_payload(request.SerializeAsString());
+    message.set_payloadtype("AnalysisRequest");
+
+    string data;
+    message.SerializeToString(&data);
+    if (nn_send(socket, data.data(), data.size(), 0) < 0)
+        throw runtime_error(string("Unable to send request: ") + nn_strerror(nn_errno()));
+}
+
+static Result replay(int socket, int id, const AnalysisRequest &request, double timeout)
+{
+    Result result;
+    result.analysisId = request.analysisid();
+    result.ns = request.ns();
+    result.name = request.name();
+    result.perform = request.perform();
+    result.firstMs = -1;
+    result.totalMs = -1;
+    result.messages = 0;
+    result.bytes = 0;
+    result.finalBytes = 0;
+    result.timedOut = false;
+
+    Clock::time_point start = Clock::now();
+    send(socket, id, request);
+
+    while (true)
+    {
+        char *buf = NULL;
+        int nbytes = nn_recv(socket, &buf, NN_MSG, 0);
+        double elapsed = chrono::duration<double, milli>(Clock::now() - start).count();
+
+        if (nbytes < 0)
+        {
+            int err = nn_errno();
+            if (err != ETIMEDOUT && err != EAGAIN)
+                throw runtime_error(string("Unable to receive: ") + nn_strerror(err));
+
+            if (elapsed > timeout * 1000)
+            {
+                result.timedOut = true;
+                result.totalMs = elapsed;
+                return result;
+            }
+
+            continue;
+        }
+
+        ComsMessage message;
+        bool parsed = message.ParseFromArray(buf, nbytes);
+        nn_freemsg(buf);
+
+        if ( ! parsed)
+            throw runtime_error("Unable to parse response");
+
+        AnalysisResponse response;
+        response.ParseFromString(message.payload());
+
+        // responses to earlier requests can arrive late; ignore them
+        if (response.analysisid() != request.analysisid()
+                || response.revision() != request.revision())
+            continue;
+
+        if (result.messages == 0)
+            result.firstMs = elapsed;
+
+        result.messages++;
+        result.bytes += message.payload().size();
+
+        if (message.status() != Status::IN_PROGRESS)
+        {
+            result.finalBytes = message.payload().size();
+            result.totalMs = elapsed;
+            return result;
+        }
+    }
+}
+
+static void writeJSON(ostream &out, const string &engine, const string &requests, const vector<Result> &results)
+{
+    out << "{\n";
+    out << "  \"engine\": \"" << engine << "\",\n";
+    out << "  \"requests\": \"" << requests << "\",\n";
+    out << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        out << "    { "
+            << "\"index\": " << r.index << ", "
+            << "\"repeat\": " << r.repeat << ", "
+            << "\"ns\": \"" << r.ns << "\", "
+            << "\"name\": \"" << r.name << "\", "
+            << "\"analysisId\": " << r.analysisId << ", "
+            << "\"perform\": " << r.perform << ", "
+            << "\"firstMs\": " << r.firstMs << ", "
+            << "\"totalMs\": " << r.totalMs << ", "
+            << "\"messages\": " << r.messages << ", "
+            << "\"bytes\": " << r.bytes << ", "
+            << "\"finalBytes\": " << r.finalBytes << ", "
+            << "\"timedOut\": " << (r.timedOut ? "true" : "false")
+            << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+#ifndef _WIN32
+
+static pid_t launch(const string &engine, const string &url, const string &path, int *stdinFd)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw runtime_error("Unable to create pipe");
+
+    pid_t pid = fork();
+    if (pid < 0)
+        throw runtime_error("Unable to launch engine");
+
+    if (pid == 0)
+    {
+        // the engine ends itself when its stdin closes
+        dup2(fds[0], STDIN_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+
+        string con = "--con=" + url;
+        string pth = "--path=" + path;
+        execl(engine.c_str(), engine.c_str(), con.c_str(), pth.c_str(), (char*)NULL);
+        cerr << "Unable to execute " << engine << "\n";
+        _exit(127);
+    }
+
+    close(fds[0]);
+    *stdinFd = fds[1];
+
+    return pid;
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef _WIN32
+    cerr << "jamovi-replay is not supported on windows\n";
+    return 1;
+#else
+    string engine;
+    string requestsPath;
+    string path;
+    string buffer;
+    string out;
+    int repeat = 1;
+    double timeout = 600;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg.rfind("--engine=", 0) == 0)
+            engine = arg.substr(9);
+        else if (arg.rfind("--requests=", 0) == 0)
+            requestsPath = arg.substr(11);
+        else if (arg.rfind("--path=", 0) == 0)
+            path = arg.substr(7);
+        else if (arg.rfind("--buffer=", 0) == 0)
+            buffer = arg.substr(9);
+        else if (arg.rfind("--out=", 0) == 0)
+            out = arg.substr(6);
+        else if (arg.rfind("--repeat=", 0) == 0)
+            repeat = atoi(arg.substr(9).c_str());
+        else if (arg.rfind("--timeout=", 0) == 0)
+            timeout = atof(arg.substr(10).c_str());
+        else
+            engine = "";  // forces the usage message
+    }
+
+    if (engine == "" || requestsPath == "" || path == "" || repeat < 1)
+    {
+        cerr << "Usage: jamovi-replay --engine=ENGINE --requests=FILE --path=PATH\n"
+                "                     [--buffer=FILE] [--repeat=N] [--timeout=SECONDS]\n"
+                "                     [--out=FILE]\n";
+        return 1;
+    }
+
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    int rc = 0;
+    int socket = -1;
+    pid_t pid = -1;
+    int stdinFd = -1;
+
+    try
+    {
+        vector<AnalysisRequest> requests = readRequests(requestsPath);
+
+        if (buffer != "")
+            prepareBuffers(requests, path, buffer);
+
+        stringstream ss;
+        ss << "ipc://" << (fs::temp_directory_path() / "jamovi-replay-").string() << getpid();
+        string url = ss.str();
+
+        socket = nn_socket(AF_SP, NN_PAIR);
+        if (socket < 0)
+            throw runtime_error("Unable to create socket");
+
+        int recvTimeout = 500;
+        nn_setsockopt(socket, NN_SOL_SOCKET, NN_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+        int maxSize = -1;
+        nn_setsockopt(socket, NN_SOL_SOCKET, NN_RCVMAXSIZE, &maxSize, sizeof(maxSize));
+
+        if (nn_bind(socket, url.c_str()) < 0)
+            throw runtime_error("Unable to bind " + url);
+
+        Clock::time_point start = Clock::now();
+        pid = launch(engine, url, path, &stdinFd);
+
+        vector<Result> results;
+        int id = 0;
+
+        for (int r = 0; r < repeat; r++)
+        {
+            for (size_t i = 0; i < requests.size(); i++)
+            {
+                AnalysisRequest &request = requests[i];
+
+                Result result = replay(socket, ++id, request, timeout);
+                result.index = i;
+                result.repeat = r;
+                results.push_back(result);
+
+                // progress goes to stderr, so stdout is just the JSON
+                cerr << r << "\t" << i << "\t"
+                     << request.ns() << "::" << request.name() << "\t"
+                     << result.totalMs << " ms\t"
+                     << result.bytes << " bytes"
+                     << (result.timedOut ? "\tTIMED OUT" : "") << "\n";
+
+                if (result.timedOut)
+                    throw runtime_error("Engine timed out");
+            }
+        }
+
+        double total = chrono::duration<double, milli>(Clock::now() - start).count();
+        cerr << "total (including engine start up): " << total << " ms\n";
+
+        if (out != "")
+        {
+            ofstream file(out);
+            writeJSON(file, engine, requestsPath, results);
+        }
+        else
+        {
+            writeJSON(cout, engine, requestsPath, results);
+        }
+
+        AnalysisRequest stop;
+        stop.set_restartengines(true);
+        send(socket, ++id, stop);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << "\n";
+        rc = 1;
+        if (pid > 0)
+            kill(pid, SIGTERM);
+    }
+
+    if (stdinFd >= 0)
+        close(stdinFd);
+
+    int status = 0;
+    if (pid > 0)
+        waitpid(pid, &status, 0);
+
+    if (socket >= 0)
+        nn_close(socket);
+
+    return rc;
+#endif
+}
@@ -11,6 +11,7 @@
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
 
 #include <boost/bind.hpp>
 
@@ -38,6 +39,7 @@ Engine::Engine()
     _reflection = _runningRequest.GetReflection();
 
     _coms = NULL;
+    _batchOut = NULL;
     _R = new EngineR();
     _R->resultsReceived.connect(bind(&Engine::resultsReceived, this, _1, _2));
 }
@@ -120,6 +122,83 @@ void Engine::start()
     t.join();
 }
 
+/*
+ * batch mode runs the engine without a server. AnalysisRequests are read
+ * from `in`, each as a 4 byte (little endian) length followed by the
+ * serialized request (the same format the server records with
+ * JAMOVI_ENGINE_RECORD_PATH), and are run in turn. the final AnalysisResponse
+ * of each is written to `out` in the same framing. the data sets are read
+ * from PATH/sessionId/instanceId/buffer as usual, but are only attached the
+ * once.
+ */
+
+int Engine::batch(istream &in, ostream &out)
+{
+    _batchOut = &out;
+    _R->setKeepAttached(true);
+    _R->setCheckForAbortCB([]() { return false; });
+
+    int count = 0;
+    int failed = 0;
+
+    while (true)
+    {
+        unsigned char header[4];
+        in.read((char*)header, 4);
+        if (in.gcount() == 0)
+            break;
+        if (in.gcount() != 4)
+            throw runtime_error("Batch input is truncated");
+
+        uint32_t n = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+        string payload(n, '\0');
+        in.read(&payload[0], n);
+        if ((uint32_t)in.gcount() != n)
+            throw runtime_error("Batch input is truncated");
+
+        AnalysisRequest request;
+        if ( ! request.ParseFromString(payload))
+            throw runtime_error("Batch input is corrupt");
+
+        if (request.restartengines())
+            break;
+
+        auto start = chrono::steady_clock::now();
+
+        try
+        {
+            _R->run(request);
+        }
+        catch (const std::exception &e)
+        {
+            AnalysisResponse response;
+            response.set_instanceid(request.instanceid());
+            response.set_analysisid(request.analysisid());
+            response.set_name(request.name());
+            response.set_ns(request.ns());
+            response.set_revision(request.revision());
+            response.mutable_error()->set_message(e.what());
+            response.mutable_error()->set_cause(e.what());
+            response.set_status(AnalysisStatus::ANALYSIS_ERROR);
+
+            string result;
+            response.SerializeToString(&result);
+            resultsReceived(result, true);
+            failed++;
+        }
+
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cerr << count << "\t" << request.ns() << "::" << request.name() << "\t" << elapsed << " ms\n";
+        count++;
+    }
+
+    out.flush();
+    _R->setKeepAttached(false);
+    _batchOut = NULL;
+
+    return failed == 0 ? 0 : 1;
+}
+
 void Engine::periodicChecks()
 {
     // suicide if parent is running
@@ -143,7 +222,22 @@ bool Engine::isNewAnalysisWaiting()
 
 void Engine::resultsReceived(const string &results, bool complete)
 {
-    _coms->send(results, complete);
+    if (_batchOut == NULL)
+    {
+        _coms->send(results, complete);
+    }
+    else if (complete)
+    {
+        // in batch mode, only the final results are of interest
+        uint32_t n = results.size();
+        unsigned char header[4] = {
+            (unsigned char)(n & 0xFF),
+            (unsigned char)((n >> 8) & 0xFF),
+            (unsigned char)((n >> 16) & 0xFF),
+            (unsigned char)((n >> 24) & 0xFF) };
+        _batchOut->write((char*)header, 4);
+        _batchOut->write(results.data(), results.size());
+    }
 }
 
 void Engine::messageLoop()
@@ -8,6 +8,7 @@
 #include "engine.h"
 
 #include <string>
+#include <iostream>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -22,6 +23,7 @@ public:
     void setConnection(const std::string &conn);
     void setPath(const std::string &path);
     void start();
+    int batch(std::istream &in, std::ostream &out);
 
 private:
     void messageLoop();
@@ -34,6 +36,7 @@ private:
 
     Coms *_coms;
     EngineR *_R;
+    std::ostream *_batchOut;
 
     std::string _connPath;
     std::string _path;
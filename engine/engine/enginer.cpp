@@ -37,6 +37,7 @@ RInside *EngineR::_rInside = NULL;
 
 EngineR::EngineR()
 {
+    _keepAttached = false;
     this->initR();
 }
 
@@ -333,7 +334,23 @@ Rcpp::DataFrame EngineR::readDataset(
     for (SEXP sexp : columnsRequired)
         req[count++] = Rcpp::as<Rcpp::String>(sexp);
 
-    return readDF(path, req, headerOnly, requiresMissings);
+    if ( ! _keepAttached)
+        return readDF(path, req, headerOnly, requiresMissings);
+
+    MemoryMap *mm;
+    auto itr = _attached.find(path);
+
+    if (itr != _attached.end())
+    {
+        mm = itr->second;
+    }
+    else
+    {
+        mm = MemoryMap::attach(path);
+        _attached[path] = mm;
+    }
+
+    return readDF(mm, req, headerOnly, requiresMissings);
 }
 
 void EngineR::setCheckForAbortCB(std::function<bool()> check)
@@ -341,6 +358,18 @@ void EngineR::setCheckForAbortCB(std::function<bool()> check)
     _checkForAbort = check;
 }
 
+void EngineR::setKeepAttached(bool keep)
+{
+    _keepAttached = keep;
+
+    if ( ! keep)
+    {
+        for (auto &attached : _attached)
+            delete attached.second;
+        _attached.clear();
+    }
+}
+
 string EngineR::analysisDirPath(
     const string &sessionId,
     const string &instanceId,
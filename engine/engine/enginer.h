@@ -15,8 +15,10 @@
 
 #include <vector>
 #include <string>
+#include <map>
 
 #include "jamovi.pb.h"
+#include "memorymap.h"
 
 
 class EngineR
@@ -26,6 +28,7 @@ public:
     void run(jamovi::coms::AnalysisRequest &analysis);
     void setPath(const std::string &path);
     void setCheckForAbortCB(std::function<bool()> check);
+    void setKeepAttached(bool keep);
 
     boost::signals2::signal<void (const std::string &, bool complete)> resultsReceived;
 
@@ -72,6 +75,11 @@ private:
     static RInside *_rInside;
 
     std::string _path;
+
+    // when the data sets aren't changing underneath us (i.e. batch mode)
+    // they can stay attached across analyses
+    bool _keepAttached;
+    std::map<std::string, MemoryMap*> _attached;
 };
 
 #endif // ENGINER_H
@@ -5,13 +5,19 @@
 #include "engine.h"
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 #include <stdexcept>
 
+#include <boost/nowide/fstream.hpp>
+
 #ifdef _WIN32
 #include <windows.h>
 #include <shellapi.h>
+#include <io.h>
+#include <fcntl.h>
 #include <boost/nowide/convert.hpp>
 #endif
 
@@ -28,30 +34,29 @@ int main(int argc, char *argv[])
     // convenient alternative!
     argvw = CommandLineToArgvW(GetCommandLineW(), &argcw);
 
-    char *new_argv[3];
+    char **new_argv = (char**)malloc(sizeof(char*) * (argcw + 1));
 
-    for (i = 0; i < 3; i++)
+    for (i = 0; i < argcw; i++)
     {
-        if (i < argcw)
-        {
-            std::wstring utf16 = argvw[i];
-            // oh f@#! it's UTF-16
-            std::string utf8 = boost::nowide::narrow(utf16);
-            char *new_arg = (char*)malloc(utf8.size() + 1);
-            std::memcpy(new_arg, utf8.c_str(), utf8.size() + 1);
-            new_argv[i] = new_arg;
-        }
-        else
-        {
-            new_argv[i] = "";
-        }
+        std::wstring utf16 = argvw[i];
+        // oh f@#! it's UTF-16
+        std::string utf8 = boost::nowide::narrow(utf16);
+        char *new_arg = (char*)malloc(utf8.size() + 1);
+        std::memcpy(new_arg, utf8.c_str(), utf8.size() + 1);
+        new_argv[i] = new_arg;
     }
+    new_argv[argcw] = NULL;
     LocalFree(argvw);
 
     // an argv useful for a program!
+    argc = argcw;
     argv = new_argv;
 #endif
 
+    const char *usage =
+        "Usage: engine --con=ipc://... --path=PATH \n"
+        "       engine --batch=FILE|- --path=PATH [--out=FILE]\n";
+
     try {
 
         Engine e;
@@ -59,7 +64,51 @@ int main(int argc, char *argv[])
         char url[512];
         char path[512];
 
-        if (argc == 3)
+        if (argc >= 3 && strncmp(argv[1], "--batch=", 8) == 0)
+        {
+            // headless batch mode; requests from a file (or stdin), and
+            // results to a file (or stdout). R writes its console output
+            // to stdout as well, so --out is preferable
+            string batchPath = &argv[1][8];
+            string outPath;
+
+            if (strncmp(argv[2], "--path=", 7) != 0)
+                throw runtime_error(usage);
+            e.setPath(string(&argv[2][7]));
+
+            if (argc == 4 && strncmp(argv[3], "--out=", 6) == 0)
+                outPath = &argv[3][6];
+            else if (argc != 3)
+                throw runtime_error(usage);
+
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+            boost::nowide::ifstream inFile;
+            boost::nowide::ofstream outFile;
+
+            if (batchPath != "-")
+            {
+                inFile.open(batchPath.c_str(), ios::binary);
+                if ( ! inFile)
+                    throw runtime_error("Unable to open " + batchPath + "\n");
+            }
+
+            if (outPath != "")
+            {
+                outFile.open(outPath.c_str(), ios::binary);
+                if ( ! outFile)
+                    throw runtime_error("Unable to open " + outPath + "\n");
+            }
+
+            istream &in = (batchPath != "-") ? (istream&)inFile : cin;
+            ostream &out = (outPath != "") ? (ostream&)outFile : cout;
+
+            return e.batch(in, out);
+        }
+        else if (argc == 3)
         {
             int urlc  = sscanf(argv[1], "--con=%511s", url);
             int pathc = sscanf(argv[2], "--path=%511s", path);
@@ -73,12 +122,12 @@ int main(int argc, char *argv[])
             }
             else
             {
-                throw runtime_error("Usage: engine --con=ipc://...  --path=PATH \n");
+                throw runtime_error(usage);
             }
         }
         else
         {
-            throw runtime_error("Usage: engine --con=ipc://... --path=PATH \n");
+            throw runtime_error(usage);
         }
 
     }
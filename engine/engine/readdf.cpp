@@ -3,10 +3,12 @@
 
 #include "memorymap.h"
 #include "dataset.h"
+#include "columnview.h"
+#include "dfvalues.h"
 
 #include <string>
 #include <vector>
-#include <map>
+#include <climits>
 
 using namespace Rcpp;
 using namespace std;
@@ -33,6 +35,25 @@ DataFrame readDF(
         throw e;
     }
 
+    try
+    {
+        DataFrame df = readDF(mm, columnsReq, headerOnly, requiresMissings);
+        delete mm;
+        return df;
+    }
+    catch (...)
+    {
+        delete mm;
+        throw;
+    }
+}
+
+DataFrame readDF(
+        MemoryMap *mm,
+        SEXP columnsReq,
+        bool headerOnly,
+        bool requiresMissings)
+{
     DataSet &dataset = *DataSet::retrieve(mm);
 
     int columnCount = dataset.columnCount();
@@ -47,14 +68,13 @@ DataFrame readDF(
 
     CharacterVector rowNames(rowCountExFiltered);
 
-    int rowNo = 0;
-    int colNo = 0;
+    // the rows which aren't filtered, found once for all the columns
+    vector<int> rows = DFValues::rows(dataset, rowCount);
 
-    for (int i = 0; i < rowCount; i++)
-    {
-        if ( ! dataset.isRowFiltered(i))
-            rowNames[rowNo++] = String(std::to_string(i+1));
-    }
+    for (size_t i = 0; i < rows.size(); i++)
+        rowNames[i] = String(std::to_string(rows[i] + 1));
+
+    int colNo = 0;
 
     bool readAllColumns;
     StringVector columnsRequired;
@@ -124,17 +144,7 @@ DataFrame readDF(
         else if (column.dataType() == DataType::DECIMAL)
         {
             NumericVector v(rowCountExFiltered, NumericVector::get_na());
-            rowNo = 0;
-
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    if (column.shouldTreatAsMissing(j) == false)
-                        v[rowNo] = column.raw<double>(j);
-                    rowNo++;
-                }
-            }
+            DFValues::decimals(column, rows, v);
 
             v.attr("jmv-desc") = desc;
             columns[colNo] = v;
@@ -142,17 +152,7 @@ DataFrame readDF(
         else if (column.dataType() == DataType::INTEGER && ! column.hasLevels())
         {
             IntegerVector v(rowCountExFiltered, IntegerVector::get_na());
-            rowNo = 0;
-
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    if (column.shouldTreatAsMissing(j) == false)
-                        v[rowNo] = column.raw<int>(j);
-                    rowNo++;
-                }
-            }
+            DFValues::integers(column, rows, v);
 
             if (column.measureType() == MeasureType::ID)
                 v.attr("jmv-id") = true;
@@ -164,17 +164,7 @@ DataFrame readDF(
                  column.measureType() == MeasureType::ID)
         {
             StringVector v(rowCountExFiltered, StringVector::get_na());
-            rowNo = 0;
-
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    if (column.shouldTreatAsMissing(j) == false)
-                        v[rowNo] = String(column.raws(j));
-                    rowNo++;
-                }
-            }
+            DFValues::ids(column, rows, v);
 
             v.attr("jmv-id") = true;
             v.attr("jmv-desc") = desc;
@@ -186,10 +176,10 @@ DataFrame readDF(
 
             // populate levels
 
-            vector<LevelData> m = column.levels();
+            bool trim = column.trimLevels();
 
             int nLevels;
-            if (column.trimLevels())
+            if (trim)
                 nLevels = column.levelCountExFiltered(requiresMissings);
             else
                 nLevels = column.levelCountExTreatAsMissings(requiresMissings);
@@ -198,62 +188,21 @@ DataFrame readDF(
             IntegerVector values = IntegerVector(nLevels);
             CharacterVector missings;
 
-            map<int, int> indexes;
-            int jli = 0;
-            int rli = 0;
-
-            vector<LevelData>::iterator itr = m.begin();
-            for (; itr != m.end(); itr++)
-            {
-                LevelData &p = *itr;
-
-                if ((p.filtered() == false || column.trimLevels() == false)
-                        && (requiresMissings || p.treatAsMissing() == false))
-                {
-                    int value;
+            // populate cells
 
-                    if (column.dataType() == DataType::TEXT)
-                        value = jli;
-                    else
-                        value = p.ivalue();
+            IntegerVector v(rowCountExFiltered, MISSING);
+            int rli = 0;
 
-                    indexes[value] = rli + 1;
+            DFValues::levels(column, rows, requiresMissings, MISSING, v,
+                [&](int value, const char *label, bool treatAsMissing) {
                     values[rli] = value;
-                    levels[rli] = String(p.label());
+                    levels[rli] = String(label);
 
-                    if (requiresMissings && p.treatAsMissing())
-                        missings.push_back(String(p.label()));
+                    if (requiresMissings && treatAsMissing)
+                        missings.push_back(String(label));
 
-                    jli++;
                     rli++;
-                }
-                else
-                {
-                    jli++;
-                }
-
-            }
-
-            // populate cells
-
-            IntegerVector v(rowCountExFiltered, MISSING);
-            rowNo = 0;
-
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    int value = column.raw<int>(j);
-                    if (value != INT_MIN)
-                    {
-                        if (requiresMissings || column.shouldTreatAsMissing(j) == false)
-                            v[rowNo] = indexes[value];
-                        else
-                            v[rowNo] = MISSING;
-                    }
-                    rowNo++;
-                }
-            }
+                });
 
             // assign levels
 
@@ -303,44 +252,27 @@ DataFrame readDF(
         if (weights.dataType() == DataType::INTEGER)
         {
             IntegerVector v(rowCountExFiltered, IntegerVector::get_na());
-            rowNo = 0;
 
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    int value = weights.raw<int>(j);
-                    if (value != INT_MIN)
-                    {
-                        if (weights.shouldTreatAsMissing(j) == false)
-                            v[rowNo] = value;
-                    }
-                    rowNo++;
-                }
-            }
+            auto assign = [&](int index, int value, bool missing) {
+                if (value != INT_MIN && ! missing)
+                    v[index] = value;
+            };
+
+            if (weights.hasLevels())
+                TypedColumnView<int, ColumnKind::LEVELS>(weights).gather(rows, assign);
+            else
+                TypedColumnView<int, ColumnKind::PLAIN>(weights).gather(rows, assign);
 
             columns.attr("jmv-weights") = v;
         }
         else if (weights.dataType() == DataType::DECIMAL)
         {
             NumericVector v(rowCountExFiltered, NumericVector::get_na());
-            rowNo = 0;
-
-            for (int j = 0; j < rowCount; j++)
-            {
-                if ( ! dataset.isRowFiltered(j))
-                {
-                    if (weights.shouldTreatAsMissing(j) == false)
-                        v[rowNo] = weights.raw<double>(j);
-                    rowNo++;
-                }
-            }
+            DFValues::decimals(weights, rows, v);
 
             columns.attr("jmv-weights") = v;
         }
     }
 
-    delete mm;
-
     return columns;
 }
@@ -4,10 +4,18 @@
 
 #include <Rcpp.h>
 
+#include "memorymap.h"
+
 Rcpp::DataFrame readDF(
     Rcpp::String path,
     SEXP columnsRequired,
     bool headerOnly,
     bool requiresMissings = false);
 
+Rcpp::DataFrame readDF(
+    MemoryMap *mm,
+    SEXP columnsRequired,
+    bool headerOnly,
+    bool requiresMissings = false);
+
 #endif // READDF_H
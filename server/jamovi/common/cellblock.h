@@ -0,0 +1,47 @@
+
+#ifndef CELLBLOCK_H
+#define CELLBLOCK_H
+
+#include <vector>
+
+class CellBlock
+{
+public:
+
+    // the cells of a rectangle of the data set, as displayed in the
+    // spreadsheet; see DataSet::fetchBlock()
+
+    enum Type
+    {
+        MISSING = 0,
+        INTEGER = 1,
+        DECIMAL = 2,
+        TEXT = 3
+    };
+
+    void clear()
+    {
+        rowNums.clear();
+        filtered.clear();
+        types.clear();
+        missing.clear();
+        ivalues.clear();
+        dvalues.clear();
+        strings.clear();
+    }
+
+    // one per row
+    std::vector<int> rowNums;
+    std::vector<char> filtered;
+
+    // one per cell, column by column
+    std::vector<char> types;
+    std::vector<char> missing;
+    std::vector<int> ivalues;  // for TEXT cells, the offset into strings
+    std::vector<double> dvalues;
+
+    // the text of the TEXT cells, each nul terminated
+    std::vector<char> strings;
+};
+
+#endif // CELLBLOCK_H
@@ -9,12 +9,40 @@
 #include <sstream>
 #include <cstring>
 #include <iomanip>
-#include <regex>
+#include <charconv>
+#include <unordered_set>
+#include <unordered_map>
+#include <cerrno>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
 
 #include "dataset.h"
 
 using namespace std;
 
+// matches ^\d+(?:,\d+)?$
+static bool isEuroDecimal(const char *value)
+{
+    const char *c = value;
+
+    if ( ! isdigit((unsigned char)*c))
+        return false;
+    while (isdigit((unsigned char)*c))
+        c++;
+
+    if (*c == ',')
+    {
+        c++;
+        if ( ! isdigit((unsigned char)*c))
+            return false;
+        while (isdigit((unsigned char)*c))
+            c++;
+    }
+
+    return *c == '\0';
+}
+
 Column::Column(DataSet *parent, MemoryMap *mm, ColumnStruct *rel)
 {
     _parent = parent;
@@ -72,6 +100,11 @@ int Column::rowCountExFiltered() const {
     return _parent->rowCountExFiltered();
 }
 
+int Column::intSize() const
+{
+    return struc()->intSize;
+}
+
 int Column::dps() const
 {
     return struc()->dps;
@@ -140,6 +173,20 @@ int Column::levelCountExFiltered(bool requiresMissings) const
     return count;
 }
 
+int Column::intAt(int rowIndex)
+{
+    ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+
+    if (rowIndex >= cs->rowCount)
+        throw std::runtime_error("index out of bounds");
+
+    int perBlock = VALUES_SPACE / cs->intSize;
+    Block **blocks = _mm->resolve<Block*>(cs->blocks);
+    Block *block = _mm->resolve<Block>(blocks[rowIndex / perBlock]);
+
+    return readInt(block->values, cs->intSize, rowIndex % perBlock);
+}
+
 const char* Column::raws(int index)
 {
     const char *value = cellAt<char*>(index);
@@ -219,6 +266,268 @@ bool Column::hasUnusedLevels() const
     return false;
 }
 
+ColumnSummary Column::summary()
+{
+    ColumnStruct *s = struc();
+    if (s->summary.valid)
+        return s->summary;
+    return computeSummary();
+}
+
+ColumnSummary Column::computeSummary()
+{
+    ColumnSummary summary;
+    summary.count = 0;
+    summary.min = NAN;
+    summary.max = NAN;
+    summary.sum = 0;
+    summary.sumSq = 0;
+    summary.dps = 0;
+    summary.valid = true;
+
+    int count = rowCount();
+
+    if (dataType() == DataType::DECIMAL)
+    {
+        forEachCell<double>(0, count, [&](int, double value) {
+            if ( ! isnan(value))
+                addToSummary(summary, value, true);
+        });
+    }
+    else if (dataType() == DataType::INTEGER)
+    {
+        forEachCell<int>(0, count, [&](int, int value) {
+            if (value != INT_MIN)
+                addToSummary(summary, value, false);
+        });
+    }
+    else if (measureType() == MeasureType::ID)
+    {
+        forEachCell<char*>(0, count, [&](int, char *value) {
+            if (value != NULL)
+                summary.count++;
+        });
+    }
+    else
+    {
+        forEachCell<int>(0, count, [&](int, int value) {
+            if (value != INT_MIN)
+                summary.count++;
+        });
+    }
+
+    return summary;
+}
+
+void Column::addToSummary(ColumnSummary &summary, double value, bool decimal)
+{
+    if (summary.count == 0)
+    {
+        summary.min = value;
+        summary.max = value;
+    }
+    else if (value < summary.min)
+    {
+        summary.min = value;
+    }
+    else if (value > summary.max)
+    {
+        summary.max = value;
+    }
+
+    summary.count++;
+    summary.sum += value;
+    summary.sumSq += value * value;
+
+    if (decimal && summary.dps < 3)
+        summary.dps = max((int)summary.dps, calcDPs(value));
+}
+
+int Column::rowsPerZone() const
+{
+    if (dataType() == DataType::DECIMAL)
+        return VALUES_SPACE / sizeof(double);
+    else
+        return VALUES_SPACE / struc()->intSize;
+}
+
+BlockZone Column::zone(int blockIndex)
+{
+    ColumnStruct *s = struc();
+
+    if (blockIndex < s->zonesCapacity)
+    {
+        BlockZone *zones = _mm->resolve(s->zones);
+        if (zones[blockIndex].valid)
+            return zones[blockIndex];
+    }
+
+    return computeZone(blockIndex);
+}
+
+BlockZone Column::computeZone(int blockIndex)
+{
+    BlockZone zone;
+    zone.min = NAN;
+    zone.max = NAN;
+    zone.missing = 0;
+    zone.valid = true;
+
+    int perBlock = rowsPerZone();
+    int start = blockIndex * perBlock;
+    int count = min(perBlock, rowCount() - start);
+
+    if (count <= 0)
+        return zone;
+
+    if (dataType() == DataType::DECIMAL)
+    {
+        forEachCell<double>(start, count, [&](int, double value) {
+            if (isnan(value))
+                zone.missing++;
+            else
+                addToZone(zone, value);
+        });
+    }
+    else
+    {
+        forEachCell<int>(start, count, [&](int, int value) {
+            if (value == INT_MIN)
+                zone.missing++;
+            else
+                addToZone(zone, value);
+        });
+    }
+
+    return zone;
+}
+
+void Column::addToZone(BlockZone &zone, double value)
+{
+    if (isnan(zone.min))
+    {
+        zone.min = value;
+        zone.max = value;
+    }
+    else if (value < zone.min)
+    {
+        zone.min = value;
+    }
+    else if (value > zone.max)
+    {
+        zone.max = value;
+    }
+}
+
+bool Column::zoneRange(int start, int count, BlockZone &zone)
+{
+    if (dataType() == DataType::TEXT)
+        return false;
+
+    zone.min = NAN;
+    zone.max = NAN;
+    zone.missing = 0;
+    zone.valid = true;
+
+    if (count <= 0)
+        return true;
+
+    int perBlock = rowsPerZone();
+
+    for (int i = start / perBlock; i <= (start + count - 1) / perBlock; i++)
+    {
+        BlockZone z = this->zone(i);
+        zone.missing += z.missing;
+        if ( ! isnan(z.min))
+        {
+            addToZone(zone, z.min);
+            addToZone(zone, z.max);
+        }
+    }
+
+    return true;
+}
+
+bool Column::mayTreatAsMissing(int start, int count)
+{
+    const ColumnStruct *s = struc();
+    int mvCount = s->missingValuesUsed;
+    if (mvCount == 0)
+        return false;
+
+    BlockZone zone;
+    if ( ! zoneRange(start, count, zone))
+        return true;
+
+    // missing cells only meet text missing values
+    bool allMissing = isnan(zone.min);
+
+    const MissingValue *mvs = _mm->resolve(s->missingValues);
+
+    for (int i = 0; i < mvCount; i++)
+    {
+        const MissingValue &mv = mvs[i];
+        double lo = zone.min;
+        double hi = zone.max;
+        double c;
+
+        if (mv.type == 0)
+        {
+            // compared with the value as text
+            return true;
+        }
+        else if (allMissing)
+        {
+            continue;
+        }
+        else if (mv.type == 1)
+        {
+            c = mv.value.d;
+        }
+        else
+        {
+            // decimals are truncated, as ivalue() does
+            if (dataType() == DataType::DECIMAL)
+            {
+                lo = trunc(max(lo, (double)INT_MIN));
+                hi = trunc(min(hi, (double)INT_MAX));
+            }
+            if (lo > hi)
+                continue;
+            c = mv.value.i;
+        }
+
+        bool meets;
+
+        switch (mv.optr)
+        {
+        case 0:
+            meets = (lo <= c && c <= hi);
+            break;
+        case 1:
+            meets = ! (lo == hi && lo == c);
+            break;
+        case 2:
+            meets = (lo <= c);
+            break;
+        case 3:
+            meets = (hi >= c);
+            break;
+        case 4:
+            meets = (lo < c);
+            break;
+        default:
+            meets = (hi > c);
+            break;
+        }
+
+        if (meets)
+            return true;
+    }
+
+    return false;
+}
+
 const char *Column::getLabel(const char* value) const
 {
     if (value[0] == '\0')
@@ -380,7 +689,8 @@ bool Column::shouldTreatAsMissing(int rowIndex)
     }
     else
     {
-        const char *sv = svalue(rowIndex);
+        char buffer[FORMAT_BUFFER_SIZE];
+        const char *sv = svalue(rowIndex, buffer);
         const char *sv2 = NULL;
         int iv = ivalue(rowIndex);
         double dv = dvalue(rowIndex);
@@ -389,6 +699,25 @@ bool Column::shouldTreatAsMissing(int rowIndex)
     }
 }
 
+bool Column::shouldTreatAsMissing(const Level &level)
+{
+    const char *label = _mm->resolve(level.label);
+    const char *importValue = _mm->resolve(level.importValue);
+    if (importValue[0] == '\0')
+        importValue = label;
+
+    if (dataType() == DataType::TEXT)
+    {
+        int iv = parseIValue(importValue);
+        double dv = parseDValue(importValue);
+        return shouldTreatAsMissing(label, iv, dv, importValue);
+    }
+    else
+    {
+        return shouldTreatAsMissing(label, level.value, (double)level.value, importValue);
+    }
+}
+
 bool Column::shouldTreatAsMissing(const char *sv, const char *sv2)
 {
     return shouldTreatAsMissing(sv, INT_MIN, NAN, sv2);
@@ -508,7 +837,7 @@ int Column::ivalue(int index)
 {
     if (dataType() == DataType::INTEGER)
     {
-        return cellAt<int>(index);
+        return raw<int>(index);
     }
     else if (dataType() == DataType::DECIMAL)
     {
@@ -520,64 +849,25 @@ int Column::ivalue(int index)
     }
     else // if (dataType() == DataType::TEXT)
     {
-        const char *v = svalue(index);
-        if (v[0] == '\0')
-        {
-            return INT_MIN;
-        }
-        else
-        {
-            int value;
-            char junk;
-            double d;
-            if (sscanf(v, "%i%1c", &value, &junk) == 1)
-                return value;
-            else if (sscanf(v, "%lf%1c", &d, &junk) == 1)
-                return (int) d;
-            else
-                return INT_MIN;
-        }
+        char buffer[FORMAT_BUFFER_SIZE];
+        return parseIValue(svalue(index, buffer));
     }
 }
 
-const char *Column::svalue(int index)
+const char *Column::svalue(int index, char *buffer)
 {
-    static string tmp;
-
     if (dataType() == DataType::INTEGER)
     {
-        int value = cellAt<int>(index);
+        int value = raw<int>(index);
         if (value == INT_MIN)
-        {
             return "";
-        }
-        else
-        {
-            stringstream ss;
-            ss << value;
-            tmp = ss.str();
-            return tmp.c_str();
-        }
+        formatIValue(buffer, value);
+        return buffer;
     }
     else if (dataType() == DataType::DECIMAL)
     {
-        double value = cellAt<double>(index);
-        if (isnan(value) || value < INT64_MIN || value > INT64_MAX)
-        {
-            return "";
-        }
-        else
-        {
-            // we round and divide so it matches _transferLevels()
-            int64_t thous = (int64_t)round(value * 1000);
-
-            stringstream ss;
-            ss.setf(ios::fixed);
-            ss << setprecision(dps());
-            ss << ((double)thous) / 1000;
-            tmp = ss.str();
-            return tmp.c_str();
-        }
+        formatDValue(buffer, cellAt<double>(index), dps());
+        return buffer;
     }
     else if (dataType() == DataType::TEXT && measureType() == MeasureType::ID)
     {
@@ -589,7 +879,7 @@ const char *Column::svalue(int index)
     }
     else // if (dataType() == DataType::TEXT)
     {
-        int value = cellAt<int>(index);
+        int value = raw<int>(index);
         if (value == INT_MIN)
         {
             return "";
@@ -601,6 +891,198 @@ const char *Column::svalue(int index)
     }
 }
 
+void Column::svalues(int start, int count, vector<char> &arena, vector<int> &offsets)
+{
+    arena.clear();
+    offsets.resize(count);
+
+    auto append = [&](int rowIndex, const char *value, size_t length) {
+        offsets[rowIndex - start] = arena.size();
+        arena.insert(arena.end(), value, value + length + 1);
+    };
+
+    char buffer[FORMAT_BUFFER_SIZE];
+
+    if (dataType() == DataType::INTEGER)
+    {
+        arena.reserve(count * 8);
+        forEachCell<int>(start, count, [&](int rowIndex, int value) {
+            if (value == INT_MIN)
+                append(rowIndex, "", 0);
+            else
+                append(rowIndex, buffer, formatIValue(buffer, value));
+        });
+    }
+    else if (dataType() == DataType::DECIMAL)
+    {
+        int dps = this->dps();
+        arena.reserve(count * (dps + 8));
+        forEachCell<double>(start, count, [&](int rowIndex, double value) {
+            append(rowIndex, buffer, formatDValue(buffer, value, dps));
+        });
+    }
+    else if (dataType() == DataType::TEXT && measureType() == MeasureType::ID)
+    {
+        forEachCell<char*>(start, count, [&](int rowIndex, char *value) {
+            if (value == NULL)
+                append(rowIndex, "", 0);
+            else
+            {
+                const char *resolved = _mm->resolve(value);
+                append(rowIndex, resolved, strlen(resolved));
+            }
+        });
+    }
+    else // if (dataType() == DataType::TEXT)
+    {
+        // as getImportValue(), but without the scan for each row
+        unordered_map<int, pair<const char*, size_t>> importValues;
+
+        ColumnStruct *s = struc();
+        Level *levels = _mm->resolve(s->levels);
+        for (int i = 0; i < s->levelsUsed; i++)
+        {
+            Level &l = levels[i];
+            const char *iv = _mm->resolve(l.importValue);
+            if (iv[0] == '\0')
+                iv = _mm->resolve(l.label);
+            importValues.emplace(l.value, make_pair(iv, strlen(iv)));
+        }
+
+        forEachCell<int>(start, count, [&](int rowIndex, int value) {
+            if (value == INT_MIN)
+            {
+                append(rowIndex, "", 0);
+                return;
+            }
+
+            auto itr = importValues.find(value);
+            if (itr == importValues.end())
+            {
+                stringstream ss;
+                ss << "level " << value << " not found";
+                throw runtime_error(ss.str());
+            }
+
+            append(rowIndex, itr->second.first, itr->second.second);
+        });
+    }
+}
+
+void Column::firstRows(vector<int> &values, vector<int> &rows)
+{
+    // the distinct (integer) values of the column, in the order in which
+    // they first appear, with the row each first appears in
+
+    values.clear();
+    rows.clear();
+
+    unordered_set<int> seen;
+    bool any = false;
+    int last = 0;
+
+    forEachCell<int>(0, rowCount(), [&](int rowIndex, int value) {
+        if (any && value == last)
+            return;
+        any = true;
+        last = value;
+        if (seen.insert(value).second)
+        {
+            values.push_back(value);
+            rows.push_back(rowIndex);
+        }
+    });
+}
+
+void Column::levelCounts(vector<int> &counts, vector<int> &countsExFiltered) const
+{
+    // the counts of each level, as kept up to date as the cells are set
+
+    counts.clear();
+    countsExFiltered.clear();
+
+    forEachLevel([&](int, const Level &level, const char *) {
+        counts.push_back(level.count);
+        countsExFiltered.push_back(level.countExFiltered);
+    });
+}
+
+void Column::fetchCells(const vector<int> &rowNums, CellBlock &block)
+{
+    // appends a cell to the block for each row, as the spreadsheet
+    // displays them; rows beyond the end of the column are MISSING
+
+    int rowCount = this->rowCount();
+    DataType::Type dataType = this->dataType();
+    bool isID = (measureType() == MeasureType::ID);
+    bool checkMissings = (struc()->missingValuesUsed > 0);
+
+    // as getLabel(), but without the scan for each row
+    unordered_map<int, const char*> labels;
+
+    if (dataType == DataType::TEXT && ! isID)
+    {
+        ColumnStruct *s = struc();
+        Level *levels = _mm->resolve(s->levels);
+        for (int i = 0; i < s->levelsUsed; i++)
+            labels.emplace(levels[i].value, _mm->resolve(levels[i].label));
+    }
+
+    for (int rowNo : rowNums)
+    {
+        char type = CellBlock::MISSING;
+        int ivalue = INT_MIN;
+        double dvalue = NAN;
+        bool missing = false;
+
+        if (rowNo >= 0 && rowNo < rowCount)
+        {
+            if (dataType == DataType::DECIMAL)
+            {
+                dvalue = raw<double>(rowNo);
+                if ( ! isnan(dvalue))
+                    type = CellBlock::DECIMAL;
+            }
+            else if (dataType == DataType::TEXT)
+            {
+                const char *value;
+
+                if (isID)
+                {
+                    value = raws(rowNo);
+                }
+                else
+                {
+                    int v = raw<int>(rowNo);
+                    auto itr = labels.find(v);
+                    value = (itr != labels.end()) ? itr->second : getLabel(v);
+                }
+
+                if (value[0] != '\0')
+                {
+                    type = CellBlock::TEXT;
+                    ivalue = block.strings.size();
+                    block.strings.insert(block.strings.end(), value, value + strlen(value) + 1);
+                }
+            }
+            else
+            {
+                ivalue = raw<int>(rowNo);
+                if (ivalue != INT_MIN)
+                    type = CellBlock::INTEGER;
+            }
+
+            if (checkMissings)
+                missing = shouldTreatAsMissing(rowNo);
+        }
+
+        block.types.push_back(type);
+        block.missing.push_back(missing);
+        block.ivalues.push_back(ivalue);
+        block.dvalues.push_back(dvalue);
+    }
+}
+
 /**
  * Return the value of the cell at the given index as a double.
  *
@@ -611,7 +1093,7 @@ double Column::dvalue(int index, bool acceptEuroDecimal)
 {
     if (dataType() == DataType::INTEGER)
     {
-        int value = cellAt<int>(index);
+        int value = raw<int>(index);
         if (value == INT_MIN)
             return NAN;
         else
@@ -623,26 +1105,8 @@ double Column::dvalue(int index, bool acceptEuroDecimal)
     }
     else // if (dataType() == DataType::TEXT)
     {
-        std::string valueStr = svalue(index);
-
-        if (valueStr.empty())
-        {
-            return NAN;
-        }
-        else
-        {
-            if (acceptEuroDecimal && isEuroDecimalPattern(valueStr))
-            {
-                std::replace(valueStr.begin(), valueStr.end(), ',', '.');
-            }
-            try {
-                return std::stod(valueStr);
-            } catch (const std::invalid_argument& e) {
-                return NAN;
-            } catch (const std::out_of_range& e) {
-                return NAN;
-            }
-        }
+        char buffer[FORMAT_BUFFER_SIZE];
+        return parseDValue(svalue(index, buffer), acceptEuroDecimal);
     }
 }
 
@@ -658,17 +1122,51 @@ bool Column::isEuroDecimalTextColumn()
     if (dataType() != DataType::TEXT)
         return false;
 
-    for (int index = 0; index < rowCount(); index++)
+    if (measureType() == MeasureType::ID)
     {
-        std::string valueStr = svalue(index);
-        if (valueStr.empty())
-            continue;
-        else
+        for (int index = 0; index < rowCount(); index++)
         {
-            if (isEuroDecimalPattern(valueStr) == false)
+            const char *value = raws(index);
+            if (value[0] != '\0' && isEuroDecimal(value) == false)
                 return false;
         }
     }
+    else
+    {
+        // each level need only be checked the once
+        unordered_set<int> used;
+
+        for (int index = 0; index < rowCount(); index++)
+        {
+            int value = raw<int>(index);
+            if (value != INT_MIN)
+                used.insert(value);
+        }
+
+        ColumnStruct *s = struc();
+        Level *levels = _mm->resolve(s->levels);
+
+        for (int i = 0; i < s->levelsUsed && ! used.empty(); i++)
+        {
+            Level &level = levels[i];
+            if (used.erase(level.value) == 0)
+                continue;
+
+            const char *value = _mm->resolve(level.importValue);
+            if (value[0] == '\0')
+                value = _mm->resolve(level.label);
+            if (value[0] != '\0' && isEuroDecimal(value) == false)
+                return false;
+        }
+
+        if ( ! used.empty())
+        {
+            stringstream ss;
+            ss << "level " << *used.begin() << " not found";
+            throw runtime_error(ss.str());
+        }
+    }
+
     return true;
 }
 
@@ -687,6 +1185,145 @@ bool Column::isEuroDecimalTextColumn()
  */
 bool Column::isEuroDecimalPattern(const std::string &input) const
 {
-    std::regex euroFloatPattern(R"(^\d+(?:,\d+)?$)");
-    return std::regex_match(input, euroFloatPattern);
+    return isEuroDecimal(input.c_str()) && strlen(input.c_str()) == input.size();
+}
+
+/**
+ * Parses a value as ivalue() does for TEXT columns; i.e. sscanf's %i,
+ * falling back to %lf, where the whole string must be consumed.
+ *
+ * @param value The value to be parsed.
+ * @return The value as an int, or INT_MIN if it can't be parsed.
+ */
+int Column::parseIValue(const char *value)
+{
+    if (value[0] == '\0')
+        return INT_MIN;
+
+    // plain decimal integers are by far the most common, and from_chars()
+    // is much cheaper than sscanf(). anything else (a leading zero, which
+    // %i treats as octal, white space, hex, overflow, etc.) goes the long
+    // way around.
+
+    const char *digits = (value[0] == '-') ? value + 1 : value;
+    if ((digits[0] >= '1' && digits[0] <= '9') || (digits[0] == '0' && digits[1] == '\0'))
+    {
+        const char *end = value + strlen(value);
+        int result;
+        from_chars_result res = from_chars(value, end, result);
+        if (res.ec == errc() && res.ptr == end)
+            return result;
+    }
+
+    int result;
+    char junk;
+    double d;
+    if (sscanf(value, "%i%1c", &result, &junk) == 1)
+        return result;
+    else if (sscanf(value, "%lf%1c", &d, &junk) == 1)
+        return (int) d;
+    else
+        return INT_MIN;
+}
+
+/**
+ * Parses a value as dvalue() does for TEXT columns; i.e. as std::stod(),
+ * but returning NAN rather than throwing.
+ *
+ * @param value The value to be parsed.
+ * @param acceptEuroDecimal Whether a comma may be the decimal separator.
+ * @return The value as a double, or NAN if it can't be parsed.
+ */
+double Column::parseDValue(const char *value, bool acceptEuroDecimal)
+{
+    if (value[0] == '\0')
+        return NAN;
+
+    string euro;
+    if (acceptEuroDecimal && strchr(value, ',') != NULL && isEuroDecimal(value))
+    {
+        euro = value;
+        std::replace(euro.begin(), euro.end(), ',', '.');
+        value = euro.c_str();
+    }
+
+    char *end;
+    errno = 0;
+    double result = strtod(value, &end);
+    if (end == value || errno == ERANGE)
+        return NAN;
+    return result;
+}
+
+/**
+ * Formats an int as svalue() does for INTEGER columns.
+ *
+ * @param buffer At least FORMAT_BUFFER_SIZE chars.
+ * @return The length of the string written.
+ */
+int Column::calcDPs(double value)
+{
+    if ( ! isfinite(value))
+        return 0;
+
+    double fraction = fmod(value, 1.0);  // as python's value % 1
+    if (fraction < 0)
+        fraction += 1.0;
+    if (fraction == 0)
+        return 0;
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", fraction);
+
+    for (int dp = 3; dp > 0; dp--)
+    {
+        if (buffer[dp + 1] != '0')
+            return dp;
+    }
+
+    return 0;
+}
+
+int Column::formatIValue(char *buffer, int value)
+{
+    to_chars_result res = to_chars(buffer, buffer + FORMAT_BUFFER_SIZE - 1, value);
+    *res.ptr = '\0';
+    return res.ptr - buffer;
+}
+
+/**
+ * Formats a double as svalue() does for DECIMAL columns; rounded to the
+ * nearest thousandth, and then written with `dps` decimal places.
+ *
+ * @param buffer At least FORMAT_BUFFER_SIZE chars.
+ * @return The length of the string written; 0 for missing values.
+ */
+int Column::formatDValue(char *buffer, double value, int dps)
+{
+    if (isnan(value) || value < INT64_MIN || value > INT64_MAX)
+    {
+        buffer[0] = '\0';
+        return 0;
+    }
+
+    // we round and divide so it matches ColumnW::_findLevels()
+    int64_t thous = (int64_t)round(value * 1000);
+    value = ((double)thous) / 1000;
+
+#ifdef __cpp_lib_to_chars
+    // to_chars() produces the same as printf("%.*f"), only faster. it
+    // isn't available for doubles everywhere (i.e. older macOS)
+    if (dps >= 0)
+    {
+        to_chars_result res = to_chars(buffer, buffer + FORMAT_BUFFER_SIZE - 1, value, chars_format::fixed, dps);
+        if (res.ec == errc())
+        {
+            *res.ptr = '\0';
+            return res.ptr - buffer;
+        }
+    }
+#endif
+
+    int length = snprintf(buffer, FORMAT_BUFFER_SIZE, "%.*f", dps, value);
+    return min(length, (int)FORMAT_BUFFER_SIZE - 1);
 }
\ No newline at end of file
@@ -8,11 +8,18 @@
 #include "memorymap.h"
 #include "vartypes.h"
 #include "level.h"
+#include "cellblock.h"
 
 #include <string>
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <climits>
 
 #ifdef _WIN32
 #define ALIGN_8 alignas(8)
@@ -21,6 +28,7 @@
 #endif
 
 class DataSet;
+template<typename T, ColumnKind::Kind K> class TypedColumnView;
 
 typedef struct
 {
@@ -64,6 +72,38 @@ typedef struct
 
 } MissingValue;
 
+typedef struct
+{
+    // over the values which aren't missing (the column's missing values
+    // aren't applied). min, max, the sums and dps are for integer and
+    // decimal columns, dps being the most decimal places (up to 3) any
+    // value has. when valid is false, these are to be found again
+
+    int count;
+    double min;
+    double max;
+    double sum;
+    double sumSq;
+    char dps;
+    bool valid;
+
+} ColumnSummary;
+
+typedef struct
+{
+    // the range of the values of a block, and how many of its cells (up
+    // to the row count) are missing. the range can be wider than the
+    // values; overwriting a cell only ever widens it. kept for integer and
+    // decimal columns, a zone for each block. when valid is false, these
+    // are to be found again
+
+    double min;
+    double max;
+    int missing;
+    bool valid;
+
+} BlockZone;
+
 typedef struct
 {
     int id;
@@ -101,6 +141,20 @@ typedef struct
 
     char *description;
 
+    ColumnSummary summary;
+
+    BlockZone *zones;
+    int zonesCapacity;
+
+    // the bytes of each cell of integer and level columns; 1 or 2 where
+    // the values allow, otherwise 4 (see Column::readInt())
+    int intSize;
+
+    // blocks reserved for the column ahead of being used, contiguous
+    // with its last block (see ColumnW::_setRowCount())
+    Block *extent;
+    int extentBlocks;
+
 } ColumnStruct;
 
 namespace ColumnType
@@ -118,6 +172,9 @@ namespace ColumnType
 
 class Column
 {
+    friend class Expression;
+    friend class CSVWriter;
+    template<typename T, ColumnKind::Kind K> friend class TypedColumnView;
 public:
 
     Column(DataSet *parent = 0, MemoryMap *mm = 0, ColumnStruct *rel = 0);
@@ -128,6 +185,7 @@ public:
     const char *description() const;
     int rowCount() const;
     int rowCountExFiltered() const;
+    int intSize() const;
     int dps() const;
     bool active() const;
 
@@ -139,6 +197,19 @@ public:
     int levelCountExTreatAsMissings(bool requiresMissings = false) const;
     int levelCountExFiltered(bool requiresMissings = false) const;
     const std::vector<LevelData> levels() const;
+
+    // calls f(index, level, label) for each level, reading them in place
+    // from the memory map (where levels() copies them). label is only
+    // valid until the next allocation from the memory map
+    template<typename F> void forEachLevel(F f) const
+    {
+        ColumnStruct *s = struc();
+        const Level *levels = _mm->resolve(s->levels);
+
+        for (int i = 0; i < s->levelsUsed; i++)
+            f(i, levels[i], (const char*)_mm->resolve(levels[i].label));
+    }
+
     const std::vector<MissingValue> missingValues() const;
     const char *getLabel(int value) const;
     const char *getLabel(const char* value) const;
@@ -151,10 +222,33 @@ public:
     const char *formulaMessage() const;
     bool trimLevels() const;
     bool hasUnusedLevels() const;
+    ColumnSummary summary();
+
+    // the summary found from the cells, as summary() does where it isn't
+    // valid
+    ColumnSummary computeSummary();
+
     bool shouldTreatAsMissing(int rowIndex);
+
+    // whether the cells of a level are treated as missing, the same as
+    // shouldTreatAsMissing(rowIndex) for each of them. this can differ from
+    // Level::treatAsMissing, which isn't checked against numeric missing
+    // values for text columns
+    bool shouldTreatAsMissing(const Level &level);
+
     bool shouldTreatAsMissing(const char *sv, const char *sv2);
     bool shouldTreatAsMissing(const char *svalue, int ivalue = INT_MIN, double dvalue = NAN, const char *sv2 = NULL);
 
+    // false where none of the rows [start, start + count) can be treated
+    // as missing; the zones of their blocks fall outside the missing values
+    bool mayTreatAsMissing(int start, int count);
+
+    // the range of the values of the rows [start, start + count), from the
+    // zones of the blocks they're in (so it can be wider). zone.missing is
+    // the missing cells of those blocks, including those outside the rows.
+    // false for text columns
+    bool zoneRange(int start, int count, BlockZone &zone);
+
     const char *raws(int rowIndex);
 
     template<typename T> T raw(int rowIndex)
@@ -162,6 +256,36 @@ public:
         return cellAt<T>(rowIndex);
     }
 
+    // the bytes needed to store value in an int cell
+    static int intSizeFor(int value)
+    {
+        if (value == INT_MIN || (value >= -INT8_MAX && value <= INT8_MAX))
+            return 1;
+        else if (value >= -INT16_MAX && value <= INT16_MAX)
+            return 2;
+        else
+            return 4;
+    }
+
+    // the value of a cell as a string. numeric values are formatted into
+    // `buffer` (of at least FORMAT_BUFFER_SIZE chars), text values are
+    // returned directly from the memory map. nothing is shared between
+    // calls, so these can be called from several threads at once
+    static const size_t FORMAT_BUFFER_SIZE = 160;
+    const char *svalue(int index, char *buffer);
+
+    // formats the rows [start, start + count) into `arena` one after the
+    // other, each nul terminated; offsets[i] is the position of row start + i
+    void svalues(int start, int count, std::vector<char> &arena, std::vector<int> &offsets);
+
+    void fetchCells(const std::vector<int> &rowNums, CellBlock &block);
+    void firstRows(std::vector<int> &values, std::vector<int> &rows);
+    void levelCounts(std::vector<int> &counts, std::vector<int> &countsExFiltered) const;
+
+    // the decimal places (up to 3) needed to show value, as
+    // Column.how_many_dps() in core.pyx and calc_dps() in formatio/reader.py
+    static int calcDPs(double value);
+
 protected:
 
     ColumnStruct *struc() const;
@@ -174,6 +298,9 @@ protected:
 
     template<typename T> T& cellAt(int rowIndex)
     {
+        // int cells can be narrower than an int, so are read with raw<int>()
+        static_assert( ! std::is_same<T, int>::value, "int cells are read with raw<int>()");
+
         ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
 
         if (rowIndex >= cs->rowCount)
@@ -188,17 +315,175 @@ protected:
         return *((T*) &currentBlock->values[index * sizeof(T)]);
     }
 
+    int intAt(int rowIndex);
+
+    // int cells of intSize bytes; int8s and int16s have their smallest
+    // value for INT_MIN (missing)
+    static int readInt(const char *cells, int intSize, int index)
+    {
+        switch (intSize)
+        {
+        case 1:
+        {
+            int8_t value = ((const int8_t*)cells)[index];
+            return value == INT8_MIN ? INT_MIN : value;
+        }
+        case 2:
+        {
+            int16_t value = ((const int16_t*)cells)[index];
+            return value == INT16_MIN ? INT_MIN : value;
+        }
+        default:
+            return ((const int*)cells)[index];
+        }
+    }
+
+    static void readInts(const char *cells, int intSize, int index, int n, int *values)
+    {
+        if (intSize == 1)
+        {
+            const int8_t *c = (const int8_t*)cells + index;
+            for (int i = 0; i < n; i++)
+                values[i] = (c[i] == INT8_MIN) ? INT_MIN : c[i];
+        }
+        else if (intSize == 2)
+        {
+            const int16_t *c = (const int16_t*)cells + index;
+            for (int i = 0; i < n; i++)
+                values[i] = (c[i] == INT16_MIN) ? INT_MIN : c[i];
+        }
+        else
+        {
+            memcpy(values, (const int*)cells + index, n * sizeof(int));
+        }
+    }
+
+    // value must fit (see intSizeFor())
+    static void writeInt(char *cells, int intSize, int index, int value)
+    {
+        switch (intSize)
+        {
+        case 1:
+            ((int8_t*)cells)[index] = (value == INT_MIN) ? INT8_MIN : (int8_t)value;
+            break;
+        case 2:
+            ((int16_t*)cells)[index] = (value == INT_MIN) ? INT16_MIN : (int16_t)value;
+            break;
+        default:
+            ((int*)cells)[index] = value;
+            break;
+        }
+    }
+
+    template<typename T, typename F> void forEachSpan(int start, int count, F f)
+    {
+        // calls f(rowIndex, values, n) for each run of n cells which share
+        // a block. values points into the block, and is only valid until
+        // the next allocation from the memory map. where int cells are
+        // narrower than an int, values is a copy of them (so writing to it
+        // doesn't change them), only valid until f returns
+        forEachSpanOf(start, count, f, (T*)NULL);
+    }
+
+    template<typename T, typename F> void forEachSpanOf(int start, int count, F f, T*)
+    {
+        ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+
+        if (start < 0 || count < 0 || start + count > cs->rowCount)
+            throw std::runtime_error("index out of bounds");
+
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+        int perBlock = VALUES_SPACE / sizeof(T);
+        int end = start + count;
+        int rowIndex = start;
+
+        while (rowIndex < end)
+        {
+            Block *block = _mm->resolve<Block>(blocks[rowIndex / perBlock]);
+            T *values = (T*) block->values;
+            int blockEnd = std::min(end, (rowIndex / perBlock + 1) * perBlock);
+
+            f(rowIndex, &values[rowIndex % perBlock], blockEnd - rowIndex);
+            rowIndex = blockEnd;
+        }
+    }
+
+    template<typename F> void forEachSpanOf(int start, int count, F f, int*)
+    {
+        const int SPAN = 1024;
+
+        ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+
+        if (start < 0 || count < 0 || start + count > cs->rowCount)
+            throw std::runtime_error("index out of bounds");
+
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+        int intSize = cs->intSize;
+        int perBlock = VALUES_SPACE / intSize;
+        int end = start + count;
+        int rowIndex = start;
+        int copy[SPAN];
+
+        while (rowIndex < end)
+        {
+            Block *block = _mm->resolve<Block>(blocks[rowIndex / perBlock]);
+            int blockEnd = std::min(end, (rowIndex / perBlock + 1) * perBlock);
+
+            if (intSize == sizeof(int))
+            {
+                int *values = (int*) block->values;
+                f(rowIndex, &values[rowIndex % perBlock], blockEnd - rowIndex);
+                rowIndex = blockEnd;
+            }
+            else
+            {
+                int n = std::min(SPAN, blockEnd - rowIndex);
+                readInts(block->values, intSize, rowIndex % perBlock, n, copy);
+                f(rowIndex, copy, n);
+                rowIndex += n;
+            }
+        }
+    }
+
+    template<typename T, typename F> void forEachCell(int start, int count, F f)
+    {
+        // calls f(rowIndex, value) for each cell, a block at a time
+        forEachSpan<T>(start, count, [&](int rowIndex, T *values, int n) {
+            for (int i = 0; i < n; i++)
+                f(rowIndex + i, values[i]);
+        });
+    }
+
     int ivalue(int index);
-    const char *svalue(int index);
     double dvalue(int index, bool acceptEuroDecimal=false);
 
     bool isEuroDecimalTextColumn();
     bool isEuroDecimalPattern(const std::string &input) const;
 
+    // the conversions used by ivalue(), svalue() and dvalue(), for
+    // converting many values at once (see ColumnW::changeDMType())
+    static int parseIValue(const char *value);
+    static double parseDValue(const char *value, bool acceptEuroDecimal = false);
+    static int formatIValue(char *buffer, int value);
+    static int formatDValue(char *buffer, double value, int dps);
+
+    static void addToSummary(ColumnSummary &summary, double value, bool decimal);
+
+    // the rows of each block, and so of each zone
+    int rowsPerZone() const;
+    BlockZone zone(int blockIndex);
+    BlockZone computeZone(int blockIndex);
+    static void addToZone(BlockZone &zone, double value);
+
 
 private:
     MemoryMap *_mm;
 
 };
 
+template<> inline int Column::raw<int>(int rowIndex)
+{
+    return intAt(rowIndex);
+}
+
 #endif // COLUMN_H
@@ -0,0 +1,231 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#ifndef COLUMNVIEW_H
+#define COLUMNVIEW_H
+
+#include "column.h"
+
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+
+/*
+ * a view of the cells of a column of one kind, for the loops which visit
+ * every cell. where Column's accessors look up the column's struct and
+ * blocks, and branch on the data and measure types for each cell, these are
+ * resolved once, when the view is created. the loops are compiled for each
+ * width of cell (int cells can be 1, 2 or 4 bytes; see ColumnStruct), so
+ * the rows of a block are a constant in each, and the block and the index
+ * into it are found by constant division.
+ *
+ * the view holds pointers into the memory map, so it's only valid until
+ * the next allocation from it (as with Column::forEachSpan())
+ */
+template<typename T, ColumnKind::Kind K>
+class TypedColumnView
+{
+    static_assert(K != ColumnKind::CONTINUOUS || std::is_same<T, double>::value, "CONTINUOUS views are of double");
+    static_assert(K != ColumnKind::PLAIN || std::is_same<T, int>::value, "PLAIN views are of int");
+    static_assert(K != ColumnKind::LEVELS || std::is_same<T, int>::value, "LEVELS views are of int");
+    static_assert(K != ColumnKind::ID || std::is_same<T, char*>::value, "ID views are of char*");
+
+public:
+
+    // throws if the column isn't of kind K
+    TypedColumnView(const Column &column)
+        : _column(column)
+    {
+        if ( ! isKind(column))
+            throw std::runtime_error("column is not of this kind");
+
+        ColumnStruct *cs = _column.struc();
+        MemoryMap *mm = _column._mm;
+        Block **blocks = mm->resolve<Block*>(cs->blocks);
+
+        _rowCount = cs->rowCount;
+        _hasMissingValues = cs->missingValuesUsed > 0;
+        _cellSize = std::is_same<T, int>::value ? cs->intSize : sizeof(T);
+
+        int perBlock = VALUES_SPACE / _cellSize;
+        _cells.resize((_rowCount + perBlock - 1) / perBlock);
+
+        for (size_t i = 0; i < _cells.size(); i++)
+            _cells[i] = mm->resolve<Block>(blocks[i])->values;
+    }
+
+    static bool isKind(const Column &column)
+    {
+        DataType::Type dataType = column.dataType();
+        MeasureType::Type measureType = column.measureType();
+
+        switch (K)
+        {
+        case ColumnKind::CONTINUOUS:
+            return dataType == DataType::DECIMAL;
+        case ColumnKind::PLAIN:
+            return dataType == DataType::INTEGER && ! column.hasLevels();
+        case ColumnKind::LEVELS:
+            return dataType != DataType::DECIMAL && column.hasLevels();
+        case ColumnKind::ID:
+            return dataType == DataType::TEXT && measureType == MeasureType::ID;
+        }
+
+        return false;
+    }
+
+    int rowCount() const
+    {
+        return _rowCount;
+    }
+
+    // the value of a cell (unchecked). for ID views, the text (NULL for
+    // empty cells)
+    T operator[](int rowIndex) const
+    {
+        T value;
+        _dispatch((T*)NULL, [&](auto cell) {
+            value = _at(cell, rowIndex);
+        });
+        return value;
+    }
+
+    // calls f(rowIndex, value) for each of the rows [start, start + count),
+    // a block at a time. for ID views, value is the text (NULL for empty
+    // cells)
+    template<typename F> void forEach(int start, int count, F f) const
+    {
+        if (start < 0 || count < 0 || start + count > _rowCount)
+            throw std::runtime_error("index out of bounds");
+
+        _dispatch((T*)NULL, [&](auto cell) {
+            typedef decltype(cell) C;
+            const int PER_BLOCK = VALUES_SPACE / sizeof(C);
+
+            int end = start + count;
+            int rowIndex = start;
+
+            while (rowIndex < end)
+            {
+                int blockIndex = rowIndex / PER_BLOCK;
+                int blockEnd = std::min(end, (blockIndex + 1) * PER_BLOCK);
+                const C *cells = (const C*)_cells[blockIndex] + rowIndex % PER_BLOCK;
+
+                for (int i = 0; i < blockEnd - rowIndex; i++)
+                    f(rowIndex + i, _value(cells[i]));
+
+                rowIndex = blockEnd;
+            }
+        });
+    }
+
+    // calls f(i, value, missing) for each of rows[i]. missing is whether
+    // the value is treated as missing (by the column's missing values),
+    // which is only checked in blocks with cells which could be. the rows
+    // needn't be in order, but the blocks are only ruled out once for each
+    // run of rows within them
+    template<typename F> void gather(const std::vector<int> &rows, F f)
+    {
+        _dispatch((T*)NULL, [&](auto cell) {
+            typedef decltype(cell) C;
+            const int PER_BLOCK = VALUES_SPACE / sizeof(C);
+
+            int lastBlock = -1;
+            bool check = false;
+
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                int rowIndex = rows[i];
+
+                if (rowIndex < 0 || rowIndex >= _rowCount)
+                    throw std::runtime_error("index out of bounds");
+
+                int blockIndex = rowIndex / PER_BLOCK;
+
+                if (blockIndex != lastBlock)
+                {
+                    lastBlock = blockIndex;
+                    if (_hasMissingValues)
+                    {
+                        int blockStart = blockIndex * PER_BLOCK;
+                        int blockRows = std::min(_rowCount, blockStart + PER_BLOCK) - blockStart;
+                        check = _column.mayTreatAsMissing(blockStart, blockRows);
+                    }
+                }
+
+                T value = _value(((const C*)_cells[blockIndex])[rowIndex % PER_BLOCK]);
+                f(i, value, check && _column.shouldTreatAsMissing(rowIndex));
+            }
+        });
+    }
+
+    // calls f(i, value) for each of rows[i], as gather() but without the
+    // missing values. for LEVELS views, whether a value is treated as
+    // missing is known from its level (Level::treatAsMissing), so is better
+    // looked up once for each level than for each cell
+    template<typename F> void gatherValues(const std::vector<int> &rows, F f) const
+    {
+        _dispatch((T*)NULL, [&](auto cell) {
+            typedef decltype(cell) C;
+            const int PER_BLOCK = VALUES_SPACE / sizeof(C);
+
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                int rowIndex = rows[i];
+
+                if (rowIndex < 0 || rowIndex >= _rowCount)
+                    throw std::runtime_error("index out of bounds");
+
+                f(i, _value(((const C*)_cells[rowIndex / PER_BLOCK])[rowIndex % PER_BLOCK]));
+            }
+        });
+    }
+
+private:
+
+    // calls f with a (default) cell of the type the cells are stored as
+    template<typename U, typename F> void _dispatch(U*, F f) const
+    {
+        f(U());
+    }
+
+    template<typename F> void _dispatch(int*, F f) const
+    {
+        if (_cellSize == 1)
+            f(int8_t());
+        else if (_cellSize == 2)
+            f(int16_t());
+        else
+            f(int());
+    }
+
+    template<typename C> T _at(C, int rowIndex) const
+    {
+        const int PER_BLOCK = VALUES_SPACE / sizeof(C);
+        return _value(((const C*)_cells[rowIndex / PER_BLOCK])[rowIndex % PER_BLOCK]);
+    }
+
+    int _value(int8_t cell) const { return cell == INT8_MIN ? INT_MIN : cell; }
+    int _value(int16_t cell) const { return cell == INT16_MIN ? INT_MIN : cell; }
+    int _value(int cell) const { return cell; }
+    double _value(double cell) const { return cell; }
+
+    char *_value(char *cell) const
+    {
+        if (cell == NULL)
+            return NULL;
+        return _column._mm->resolve(cell);
+    }
+
+    Column _column;
+    int _rowCount;
+    bool _hasMissingValues;
+    int _cellSize;
+    std::vector<char*> _cells;  // the cells of each block
+};
+
+#endif // COLUMNVIEW_H
@@ -7,6 +7,7 @@
 #include <cstring>
 #include <climits>
 #include <stdexcept>
+#include <cmath>
 
 using namespace std;
 
@@ -159,3 +160,42 @@ const char* DataSet::weightsName()
 {
     return weights().name();
 }
+
+void DataSet::fetchBlock(int rowStart, int rowCount, const vector<int> &columnIds, bool exFiltered, CellBlock &block)
+{
+    block.clear();
+
+    int total = this->rowCount();
+    int totalExFiltered = rowCountExFiltered();
+
+    for (int index = rowStart; index < rowStart + rowCount; index++)
+    {
+        int rowNo = index;
+
+        if (exFiltered)
+        {
+            if (index < totalExFiltered)
+                rowNo = getIndexExFiltered(index);
+            else
+                rowNo = total - totalExFiltered + index;
+        }
+
+        block.rowNums.push_back(rowNo);
+        block.filtered.push_back( ! exFiltered && rowNo < total && isRowFiltered(rowNo));
+    }
+
+    for (int id : columnIds)
+    {
+        if (id == 0)
+        {
+            block.types.insert(block.types.end(), rowCount, CellBlock::MISSING);
+            block.missing.insert(block.missing.end(), rowCount, false);
+            block.ivalues.insert(block.ivalues.end(), rowCount, INT_MIN);
+            block.dvalues.insert(block.dvalues.end(), rowCount, NAN);
+        }
+        else
+        {
+            getColumnById(id).fetchCells(block.rowNums, block);
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #define DATASET_H
 
 #include <string>
+#include <vector>
 
 #include "memorymap.h"
 #include "column.h"
@@ -44,6 +45,10 @@ public:
     Column weights();
     const char* weightsName();
 
+    // the cells for the spreadsheet viewport; columnIds of 0 produce
+    // columns of MISSING cells (for the virtual columns)
+    void fetchBlock(int rowStart, int rowCount, const std::vector<int> &columnIds, bool exFiltered, CellBlock &block);
+
 protected:
 
     DataSet(MemoryMap *memoryMap);
@@ -0,0 +1,171 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#ifndef DFVALUES_H
+#define DFVALUES_H
+
+#include "dataset.h"
+#include "column.h"
+#include "columnview.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+
+/*
+ * the conversion of the columns of a data set to the vectors of an R data
+ * frame, for readDF() in the engine (engine/engine/readdf.cpp). this is
+ * kept free of R, so it can be benchmarked without it (see
+ * benchmarks/bench/benchreaddf.cpp); the vectors are allocated by the
+ * caller (filled with NA), and are anything which can be assigned to
+ * through operator[]
+ */
+class DFValues
+{
+public:
+
+    // the rows which aren't filtered, found once for all the columns
+    static std::vector<int> rows(DataSet &dataset, int rowCount)
+    {
+        std::vector<int> rows;
+        rows.reserve(dataset.rowCountExFiltered());
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            if ( ! dataset.isRowFiltered(i))
+                rows.push_back(i);
+        }
+
+        return rows;
+    }
+
+    // the values of a DECIMAL column. v is of rows.size(), and the cells
+    // treated as missing are left as they are
+    template<typename V> static void decimals(Column &column, const std::vector<int> &rows, V &v)
+    {
+        TypedColumnView<double, ColumnKind::CONTINUOUS> view(column);
+        view.gather(rows, [&](int index, double value, bool missing) {
+            if ( ! missing)
+                v[index] = value;
+        });
+    }
+
+    // the values of an INTEGER column without levels, as decimals()
+    template<typename V> static void integers(Column &column, const std::vector<int> &rows, V &v)
+    {
+        TypedColumnView<int, ColumnKind::PLAIN> view(column);
+        view.gather(rows, [&](int index, int value, bool missing) {
+            if ( ! missing)
+                v[index] = value;
+        });
+    }
+
+    // the text of an ID column, as decimals(). empty cells are ""
+    template<typename V> static void ids(Column &column, const std::vector<int> &rows, V &v)
+    {
+        TypedColumnView<char*, ColumnKind::ID> view(column);
+        view.gather(rows, [&](int index, const char *value, bool missing) {
+            if ( ! missing)
+                v[index] = (value != NULL ? value : "");
+        });
+    }
+
+    // the R indices (from 1) of the levels of a column with levels, as
+    // decimals(). addLevel(value, label, treatAsMissing) is called for each
+    // level of the factor, in order; those without cells (in the rows)
+    // are left out where the column trims its levels, and those treated
+    // as missing are left out unless requiresMissings. the cells of the
+    // levels left out, and of those treated as missing, are left as they
+    // are (so should be NA)
+    template<typename V, typename F> static void levels(
+        Column &column,
+        const std::vector<int> &rows,
+        bool requiresMissings,
+        int missing,
+        V &v,
+        F addLevel)
+    {
+        // the cells of text columns are the indices of their levels, of
+        // integer columns the levels' values. these are mapped to the R
+        // index of their level, or missing for the levels left out and
+        // those whose cells are treated as missing; so the missing values
+        // are checked once for each level, rather than for each cell.
+        // this is a table over the values, unless the integer values are
+        // too spread out for one
+
+        bool isText = column.dataType() == DataType::TEXT;
+        bool trim = column.trimLevels();
+
+        int lo = 0;
+        int hi = column.levelCount() - 1;
+
+        if ( ! isText)
+        {
+            lo = INT_MAX;
+            hi = INT_MIN;
+            column.forEachLevel([&](int, const Level &level, const char *) {
+                lo = std::min(lo, level.value);
+                hi = std::max(hi, level.value);
+            });
+        }
+
+        long long span = (long long)hi - lo + 1;
+        bool dense = span <= 4LL * column.levelCount() + 64;
+
+        std::vector<int> table;
+        std::unordered_map<int, int> sparse;
+
+        if (dense)
+            table.assign(std::max(span, 0LL), missing);
+
+        int nLevels = 0;
+
+        column.forEachLevel([&](int index, const Level &level, const char *label) {
+
+            int value = isText ? index : level.value;
+            int rIndex = missing;
+
+            if ((level.countExFiltered > 0 || ! trim)
+                    && (requiresMissings || ! level.treatAsMissing))
+            {
+                addLevel(value, label, (bool)level.treatAsMissing);
+                rIndex = ++nLevels;
+            }
+
+            if ( ! requiresMissings && column.shouldTreatAsMissing(level))
+                rIndex = missing;
+
+            if (dense)
+                table[value - lo] = rIndex;
+            else
+                sparse[value] = rIndex;
+        });
+
+        TypedColumnView<int, ColumnKind::LEVELS> view(column);
+
+        if (dense)
+        {
+            const int *t = table.data();
+            unsigned int n = table.size();
+
+            view.gatherValues(rows, [&](int index, int value) {
+                // missing cells (INT_MIN) fall outside the table
+                unsigned int offset = (unsigned int)value - (unsigned int)lo;
+                if (offset < n)
+                    v[index] = t[offset];
+            });
+        }
+        else
+        {
+            view.gatherValues(rows, [&](int index, int value) {
+                auto itr = sparse.find(value);
+                if (itr != sparse.end())
+                    v[index] = itr->second;
+            });
+        }
+    }
+};
+
+#endif // DFVALUES_H
@@ -10,7 +10,7 @@
 #include <boost/interprocess/mapped_region.hpp>
 
 #define MM_VERSION_MAJOR 3
-#define MM_VERSION_MINOR 0
+#define MM_VERSION_MINOR 3
 #define MM_START_OFFSET 8
 
 class MemoryMap {
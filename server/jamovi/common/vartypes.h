@@ -25,4 +25,16 @@ namespace MeasureType
     };
 }
 
+namespace ColumnKind
+{
+    // the kinds of TypedColumnView (see columnview.h)
+    enum Kind
+    {
+        CONTINUOUS = 0,  // decimal values, as double
+        PLAIN = 1,       // integers without levels, as int
+        LEVELS = 2,      // level values (integer or text), as int
+        ID = 3,          // text ids, as char*
+    };
+}
+
 #endif // VARTYPES_H
@@ -7,6 +7,10 @@ from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp.list cimport list as cpplist
 from libcpp.pair cimport pair
+from libcpp.unordered_set cimport unordered_set
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint64_t
+from libc.string cimport strlen
 
 from cython.operator cimport dereference as deref, postincrement as inc
 
@@ -17,6 +21,15 @@ import os
 import os.path
 
 from enum import Enum
+from collections import namedtuple
+from numbers import Number
+from datetime import date
+
+_EPOCH = date(1970, 1, 1).toordinal()
+
+ColumnSummary = namedtuple('ColumnSummary', 'count min max sum sum_sq dps')
+MemoryUsage = namedtuple('MemoryUsage', 'id blocks levels strings formula directory unused')
+MemoryReport = namedtuple('MemoryReport', 'size used live orphaned total columns')
 
 cdef extern from "column.h":
     cdef cppclass CLevelData "LevelData":
@@ -46,8 +59,146 @@ cdef extern from "column.h":
         int type
         int optr
         Value value
+    ctypedef struct CColumnSummary "ColumnSummary":
+        int count
+        double min
+        double max
+        double sum
+        double sumSq
+        char dps
+
+cdef extern from "cellblock.h":
+    cdef cppclass CCellBlock "CellBlock":
+        vector[int] rowNums
+        vector[char] filtered
+        vector[char] types
+        vector[char] missing
+        vector[int] ivalues
+        vector[double] dvalues
+        vector[char] strings
+
+cdef enum:
+    CELL_MISSING = 0
+    CELL_INTEGER = 1
+    CELL_DECIMAL = 2
+    CELL_TEXT = 3
+
+cdef extern from "expression.h":
+    cdef cppclass CInstruction "Instruction":
+        int opCode
+        int dataType
+        vector[int] args
+        vector[int] params
+        int64_t ivalue
+        double dvalue
+    cdef enum:
+        COpConstant     "OpCode::CONSTANT"
+        COpColumn       "OpCode::COLUMN"
+        COpRow          "OpCode::ROW"
+        COpAdd          "OpCode::ADD"
+        COpSub          "OpCode::SUB"
+        COpMul          "OpCode::MUL"
+        COpDiv          "OpCode::DIV"
+        COpFloorDiv     "OpCode::FLOOR_DIV"
+        COpMod          "OpCode::MOD"
+        COpPow          "OpCode::POW"
+        COpNegate       "OpCode::NEGATE"
+        COpPositive     "OpCode::POSITIVE"
+        COpNot          "OpCode::NOT"
+        COpInvert       "OpCode::INVERT"
+        COpCompare      "OpCode::COMPARE"
+        COpAnd          "OpCode::AND"
+        COpOr           "OpCode::OR"
+        COpIf           "OpCode::IF"
+        COpIfMissing    "OpCode::IF_MISSING"
+        COpFilter       "OpCode::FILTER"
+        COpFilterValue  "OpCode::FILTER_VALUE"
+        COpRecode       "OpCode::RECODE"
+        COpAbs          "OpCode::ABS"
+        COpRound        "OpCode::ROUND"
+        COpFloor        "OpCode::FLOOR"
+        COpCeiling      "OpCode::CEILING"
+        COpExp          "OpCode::EXP"
+        COpLn           "OpCode::LN"
+        COpLog10        "OpCode::LOG10"
+        COpSqrt         "OpCode::SQRT"
+        COpMin          "OpCode::MIN"
+        COpMax          "OpCode::MAX"
+        COpSum          "OpCode::SUM"
+    cdef enum:
+        CComparisonEq     "Comparison::EQ"
+        CComparisonNotEq  "Comparison::NOT_EQ"
+        CComparisonLt     "Comparison::LT"
+        CComparisonLtE    "Comparison::LT_E"
+        CComparisonGt     "Comparison::GT"
+        CComparisonGtE    "Comparison::GT_E"
+
+# the instructions and comparisons produced by compute/compiler.py
+_OP_CODES = {
+    'constant': COpConstant,
+    'column': COpColumn,
+    'row': COpRow,
+    'add': COpAdd,
+    'sub': COpSub,
+    'mul': COpMul,
+    'div': COpDiv,
+    'floordiv': COpFloorDiv,
+    'mod': COpMod,
+    'pow': COpPow,
+    'negate': COpNegate,
+    'positive': COpPositive,
+    'not': COpNot,
+    'invert': COpInvert,
+    'compare': COpCompare,
+    'and': COpAnd,
+    'or': COpOr,
+    'if': COpIf,
+    'ifmiss': COpIfMissing,
+    'filter': COpFilter,
+    'filter_value': COpFilterValue,
+    'recode': COpRecode,
+    'abs': COpAbs,
+    'round': COpRound,
+    'floor': COpFloor,
+    'ceiling': COpCeiling,
+    'exp': COpExp,
+    'ln': COpLn,
+    'log10': COpLog10,
+    'sqrt': COpSqrt,
+    'min': COpMin,
+    'max': COpMax,
+    'sum': COpSum,
+}
+
+_COMPARISONS = {
+    'eq': CComparisonEq,
+    'noteq': CComparisonNotEq,
+    'lt': CComparisonLt,
+    'lte': CComparisonLtE,
+    'gt': CComparisonGt,
+    'gte': CComparisonGtE,
+}
 
 cdef extern from "datasetw.h":
+    ctypedef void (*CDataSetProgressCallback "DataSetW::ProgressCallback")(void *context, float progress)
+    ctypedef struct CColumnChange "ColumnChange":
+        int id
+        CDataType dataType
+        CMeasureType measureType
+    ctypedef struct CMemoryUsage "MemoryUsage":
+        int id
+        int64_t blocks
+        int64_t levels
+        int64_t strings
+        int64_t formula
+        int64_t directory
+        int64_t unused
+    ctypedef struct CMemoryReport "MemoryReport":
+        int64_t size
+        int64_t used
+        int64_t live
+        int64_t orphaned
+        CMemoryUsage total
     cdef cppclass CDataSet "DataSetW":
         @staticmethod
         CDataSet *create(CMemoryMap *mm) except +
@@ -75,6 +226,79 @@ cdef extern from "datasetw.h":
         bool isEdited() const;
         void setBlank(bool blank);
         bool isBlank() const;
+        int64_t exportColumnData(int id, int rowStart, int rowCount, char *data, int stringsFd, int64_t stringsOffset) except +
+        void importColumnData(int id, int rowCount, int fd, int64_t offset, const char *strings, size_t stringsSize) except +
+        void fetchBlock(int rowStart, int rowCount, const vector[int] &columnIds, bool exFiltered, CCellBlock &block) except +
+        bool evaluate(int id, const vector[CInstruction] &program, bool isFilter) except +
+        void changeDMTypes(const vector[CColumnChange] &changes, CDataSetProgressCallback callback, void *context) except +
+        CMemoryReport memoryUsage(vector[CMemoryUsage] &columns) except +
+
+cdef void _put_varint(string &out, uint64_t value):
+    while value >= 0x80:
+        out.push_back(<char>((value & 0x7F) | 0x80))
+        value >>= 7
+    out.push_back(<char>value)
+
+cdef object _memory_usage(const CMemoryUsage &usage):
+    return MemoryUsage(
+        usage.id,
+        usage.blocks,
+        usage.levels,
+        usage.strings,
+        usage.formula,
+        usage.directory,
+        usage.unused)
+
+cdef object _column_summary(const CColumnSummary &summary, bool text):
+    if text:
+        return ColumnSummary(summary.count, None, None, None, None, 0)
+    return ColumnSummary(
+        summary.count,
+        summary.min if summary.count > 0 else None,
+        summary.max if summary.count > 0 else None,
+        summary.sum,
+        summary.sumSq,
+        summary.dps)
+
+cdef string _serialize_cells(CCellBlock &block):
+    # encodes the cells as the (repeated) values field of a
+    # DataSetRR.DataBlock, in the protobuf wire format. see jamovi.proto
+    cdef string out
+    cdef string cell
+    cdef const char *text
+    cdef size_t n
+    cdef double d
+    cdef size_t i
+    cdef char t
+
+    for i in range(block.types.size()):
+        cell.clear()
+        t = block.types[i]
+        if t == CELL_INTEGER:
+            cell.push_back(0x08)  # i = 1
+            _put_varint(cell, <uint64_t><int64_t>block.ivalues[i])
+        elif t == CELL_DECIMAL:
+            cell.push_back(0x11)  # d = 2
+            d = block.dvalues[i]
+            cell.append(<const char*>&d, 8)
+        elif t == CELL_TEXT:
+            cell.push_back(0x1A)  # s = 3
+            text = &block.strings[block.ivalues[i]]
+            n = strlen(text)
+            _put_varint(cell, n)
+            cell.append(text, n)
+        else:
+            cell.push_back(0x20)  # o = 4, SpecialValues.MISSING
+            cell.push_back(0x00)
+        if block.missing[i]:
+            cell.push_back(0x38)  # missing = 7
+            cell.push_back(0x01)
+
+        out.push_back(0x2A)  # values = 5
+        _put_varint(out, cell.size())
+        out.append(cell)
+
+    return out
 
 class ColumnIterator:
     def __init__(self, dataset):
@@ -181,6 +405,104 @@ cdef class DataSet:
     def refresh_filter_state(self):
         self._this.refreshFilterState()
 
+    def export_column_data(self, column_id, row_start, row_count, buffer, strings_fd=-1, strings_offset=0):
+        cdef unsigned char[::1] data = buffer
+        cdef int width = 8 if self._this.getColumnById(column_id).dataType() == CDataTypeDecimal else 4
+        if row_count <= 0:
+            return strings_offset
+        if len(data) < row_count * width:
+            raise ValueError('buffer is too small')
+        return self._this.exportColumnData(column_id, row_start, row_count, <char*>&data[0], strings_fd, strings_offset)
+
+    def fetch_block(self, row_start, row_count, column_ids, ex_filtered):
+        # returns the row numbers, the filtered state of each row, and the
+        # cells, serialized so they can be merged into a DataSetRR.DataBlock
+        cdef CCellBlock block
+        cdef vector[int] ids = column_ids
+        self._this.fetchBlock(row_start, row_count, ids, ex_filtered, block)
+        row_nums = block.rowNums
+        filtered = bytes(block.filtered)
+        return row_nums, filtered, _serialize_cells(block)
+
+    def evaluate(self, column_id, program, is_filter):
+        # evaluates a program from compute.Compiler into the column. returns
+        # False if the formula needs to be evaluated a row at a time instead
+        cdef vector[CInstruction] instructions
+        cdef CInstruction instruction
+        for op, data_type, args, params, value in program:
+            instruction.opCode = _OP_CODES[op]
+            instruction.dataType = data_type.value
+            instruction.args = args
+            if op == 'compare':
+                instruction.params = [ _COMPARISONS[p] for p in params ]
+            else:
+                instruction.params = params
+            if op == 'constant' and data_type is DataType.DECIMAL:
+                instruction.ivalue = 0
+                instruction.dvalue = value
+            else:
+                instruction.ivalue = value
+                instruction.dvalue = 0
+            instructions.push_back(instruction)
+        return self._this.evaluate(column_id, instructions, is_filter)
+
+    def change_types(self, changes, prog_cb=None):
+        # as Column.change() (without levels) for each (column, data_type,
+        # measure_type) in changes, converting the columns in parallel
+        cdef vector[CColumnChange] c_changes
+        cdef CColumnChange c_change
+        cdef Column column
+        changed = [ ]
+
+        for column, data_type, measure_type in changes:
+            if data_type is None or data_type == column.data_type:
+                data_type = DataType.NONE
+            if measure_type is None or measure_type == column.measure_type:
+                measure_type = MeasureType.NONE
+            if data_type == DataType.NONE and measure_type == MeasureType.NONE:
+                continue
+            c_change.id = column.id
+            c_change.dataType = data_type.value
+            c_change.measureType = measure_type.value
+            c_changes.push_back(c_change)
+            changed.append((column, column.id))
+
+        try:
+            if prog_cb is None:
+                self._this.changeDMTypes(c_changes, NULL, NULL)
+            else:
+                self._this.changeDMTypes(c_changes, _report_progress, <void*>prog_cb)
+        finally:
+            # the columns have new innards, or are back to their old ones
+            # where the conversion failed (and the old may now be another
+            # column's, so the ids are taken beforehand)
+            for column, column_id in changed:
+                column._this = self._this.getColumnById(column_id)
+                column.determine_dps()
+
+    def memory_usage(self):
+        # the bytes of the memory map; those live (by what they're for, in
+        # all and for each column) and those orphaned. for logging, and for
+        # deciding when the data set would be worth rewriting to a new map
+        cdef vector[CMemoryUsage] c_columns
+        cdef CMemoryReport report = self._this.memoryUsage(c_columns)
+        columns = [ _memory_usage(usage) for usage in c_columns ]
+        return MemoryReport(
+            report.size,
+            report.used,
+            report.live,
+            report.orphaned,
+            _memory_usage(report.total),
+            columns)
+
+    def import_column_data(self, column_id, row_count, fd, offset, strings=None):
+        cdef const char *c_strings = NULL
+        cdef size_t strings_size = 0
+        if strings is not None:
+            c_strings = strings
+            strings_size = len(strings)
+        self._this.importColumnData(column_id, row_count, fd, offset, c_strings, strings_size)
+
 cdef extern from "columnw.h":
     cdef cppclass CColumn "ColumnW":
         const char *name() const
@@ -222,12 +544,14 @@ cdef extern from "columnw.h":
         void trimUnusedLevels()
         const vector[CLevelData] levels()
         void setLevels(vector[CLevelData] levels)
+        void buildLevels(vector[CLevelData] levels) except +
         void setMissingValues(vector[CMissingValue] missingValues)
         const vector[CMissingValue] missingValues()
         void setDPs(int dps)
         int dps() const
         int rowCount() const;
         int rowCountExFiltered() const;
+        int intSize() const;
         int changes() const;
         const char *formula() const;
         void setFormula(const char *value);
@@ -239,6 +563,15 @@ cdef extern from "columnw.h":
         bool trimLevels() const;
         void changeDMType(CDataType dataType, CMeasureType measureType);
         bool shouldTreatAsMissing(int index);
+        void firstRows(vector[int] &values, vector[int] &rows) except +
+        void levelCounts(vector[int] &counts, vector[int] &countsExFiltered)
+        void recode(CColumn &source, const vector[int] &fromValues, const vector[int] &toValues) except +
+        void recode(CColumn &source, const vector[int] &fromValues, const vector[double] &toValues) except +
+        void setIValues(int start, const vector[int] &values) except +
+        void setDValues(int start, const vector[double] &values) except +
+        int setSValues(int start, const vector[const char*] &values, int maxLevels) except +
+        CColumnSummary summary() except +
+        CColumnSummary computeSummary() except +
 
     ctypedef enum CColumnType "ColumnType::Type":
         CColumnTypeNone       "ColumnType::NONE"
@@ -355,6 +688,11 @@ cdef class Column:
         def __set__(self, dps):
             self._this.setDPs(dps)
 
+    property int_size:
+        def __get__(self):
+            # the bytes each int cell is stored in; 1, 2 or 4
+            return self._this.intSize()
+
     property trim_levels:
         def __get__(self):
             return self._this.trimLevels()
@@ -364,13 +702,18 @@ cdef class Column:
 
     def determine_dps(self):
         if self.data_type == DataType.DECIMAL:
-            ceiling_dps = 3
-            max_dps = 0
-            for value in self:
-                max_dps = max(max_dps, Column.how_many_dps(value, ceiling_dps))
-                if max_dps == ceiling_dps:
-                    break
-            self.dps = max_dps
+            self.dps = self._this.summary().dps
+
+    property summary:
+        def __get__(self):
+            # kept up to date as the cells are set; min, max and the sums
+            # are None for text columns, and min and max where all the
+            # values are missing
+            return _column_summary(self._this.summary(), self.data_type == DataType.TEXT)
+
+    def compute_summary(self):
+        # as summary, but found afresh from the cells
+        return _column_summary(self._this.computeSummary(), self.data_type == DataType.TEXT)
 
     property active:
         def __get__(self):
@@ -429,6 +772,122 @@ cdef class Column:
     def clear_levels(self):
         self._this.clearLevels()
 
+    def first_rows(self):
+        # the distinct values of the column, and the row each first appears in
+        cdef vector[int] values
+        cdef vector[int] rows
+        self._this.firstRows(values, rows)
+        return values, rows
+
+    def level_counts(self):
+        # the (count, count ex filtered) of each level
+        cdef vector[int] counts
+        cdef vector[int] counts_ex_filtered
+        self._this.levelCounts(counts, counts_ex_filtered)
+        return list(zip(counts, counts_ex_filtered))
+
+    def recode(self, Column source, from_values, to_values):
+        # sets each row to to_values[i], where its value in source is
+        # from_values[i]
+        cdef vector[int] c_from = from_values
+        cdef vector[int] c_ito
+        cdef vector[double] c_dto
+        if self.data_type is DataType.DECIMAL:
+            c_dto = to_values
+            self._this.recode(source._this, c_from, c_dto)
+        else:
+            c_ito = to_values
+            self._this.recode(source._this, c_from, c_ito)
+
+    def import_values(self, int start, values):
+        # sets the rows from start onwards (which are yet to be set) to the
+        # values read from a data file; None, numbers, strings or dates. as
+        # when setting them a value at a time, a nominal or ordinal integer
+        # column becomes continuous decimal at the first value which isn't
+        # an int32, and a text column becomes an ID once it has more than 50
+        # levels
+        cdef vector[int] ivalues
+        cdef vector[double] dvalues
+        cdef vector[const char*] svalues
+        cdef unordered_set[int] days
+        cdef int n = len(values)
+        cdef int i = 0
+        cdef int j
+        cdef int day
+        cdef double d
+
+        while i < n:
+            data_type = self.data_type
+            measure_type = self.measure_type
+
+            if data_type is DataType.TEXT:
+                encoded = [ ]
+                svalues.clear()
+                for value in values[i:]:
+                    if value is None:
+                        svalues.push_back(NULL)
+                    else:
+                        if type(value) is not str:
+                            value = str(value)
+                        value = value.encode('utf-8')
+                        encoded.append(value)
+                        svalues.push_back(<const char*>value)
+                i += self._this.setSValues(start + i, svalues, 50)
+                if i < n:
+                    self._change_keeping_missings(measure_type=MeasureType.ID)
+
+            elif (measure_type is MeasureType.NOMINAL
+                    or measure_type is MeasureType.ORDINAL):
+                ivalues.clear()
+                j = i
+                while j < n:
+                    value = values[j]
+                    if type(value) is date:
+                        day = value.toordinal() - _EPOCH
+                        if days.count(day) == 0:
+                            days.insert(day)
+                            if not self._this.hasLevel(day):
+                                self._this.insertLevel(
+                                    day,
+                                    value.isoformat().encode('utf-8'),
+                                    str(day).encode('utf-8'),
+                                    False)
+                        ivalues.push_back(day)
+                    elif isinstance(value, Number):
+                        d = float(value)
+                        if d % 1.0 != 0.0:
+                            break
+                        value = int(value)
+                        if not is_int32(value):
+                            break
+                        ivalues.push_back(value)
+                    else:
+                        ivalues.push_back(-2147483648)
+                    j += 1
+                self._this.setIValues(start + i, ivalues)
+                i = j
+                if i < n:
+                    self._change_keeping_missings(
+                        data_type=DataType.DECIMAL,
+                        measure_type=MeasureType.CONTINUOUS)
+
+            elif data_type is DataType.DECIMAL:
+                dvalues = [ float(v) if isinstance(v, Number) else math.nan for v in values[i:] ]
+                self._this.setDValues(start + i, dvalues)
+                i = n
+
+            else:
+                ivalues = [ int(v) if isinstance(v, Number) else -2147483648 for v in values[i:] ]
+                self._this.setIValues(start + i, ivalues)
+                i = n
+
+    def _change_keeping_missings(self, **kwargs):
+        # changeDMType() leaves the column with the scratch column's missing
+        # values, which needn't be this column's
+        missing_values = self.missing_values
+        self.change(**kwargs)
+        self.set_missing_values(missing_values)
+
     def trim_unused_levels(self):
         self._this.trimUnusedLevels()
 
@@ -610,6 +1069,36 @@ cdef class Column:
 
         self._this.setLevels(new_levels)
 
+    def build_levels(self, levels):
+        # as clear_levels(), and append_level() for each of levels (as
+        # (raw, label, import_value, pinned)) in order. the levels of TEXT
+        # columns take their index as their raw value, and of INTEGER
+        # columns, str(raw) as their import value
+        cdef vector[CLevelData] new_levels
+        cdef const char* label
+        cdef const char* svalue
+        cdef int ivalue
+        cdef bool pinned
+
+        if self.data_type == DataType.TEXT:
+            for level in levels:
+                import_value = level[2] if level[2] is not None else level[1]
+                utf8_bytes = import_value.encode('utf-8')
+                svalue = utf8_bytes
+                utf8_label = level[1].encode('utf-8')
+                label = utf8_label
+                pinned = level[3]
+                new_levels.push_back(CLevelData(svalue, label, pinned))
+        else:
+            for level in levels:
+                ivalue = level[0]
+                utf8_bytes = level[1].encode('utf-8')
+                label = utf8_bytes
+                pinned = level[3]
+                new_levels.push_back(CLevelData(ivalue, label, pinned))
+
+        self._this.buildLevels(new_levels)
+
     def _parse_missing_value(self, missing_value):
         optr = 0
         new_value = missing_value.strip()
@@ -803,6 +1292,90 @@ cdef class MemoryMap:
         self._this.close()
 
 
+cdef extern from "csvreader.h":
+    ctypedef void (*CProgressCallback "CSVReader::ProgressCallback")(void *context, float progress)
+    cdef cppclass CColumnStats "CSVReader::ColumnStats":
+        bool isEmpty
+        bool onlyIntegers
+        bool onlyFloats
+        bool onlyEuroFloats
+        bool manyUniques
+        int dps
+        unordered_set[string] uniqueValues
+    cdef cppclass CCSVReader "CSVReader":
+        CCSVReader(string path, char delimiter, char quoteChar, bool skipInitialSpace, const char *missings) except +
+        bool scan(CProgressCallback callback, void *context) except +
+        void read(CDataSet &dataset, const vector[int] &ids, CProgressCallback callback, void *context) except +
+        vector[string] columnNames() const
+        int rowCount() const
+        const CColumnStats &columnStats(int index) except +
+
+cdef void _report_progress(void *context, float progress) noexcept:
+    (<object>context)(progress)
+
+cdef class CSVReader:
+    cdef CCSVReader *_this
+
+    def __cinit__(self, path, delimiter, quotechar, skip_initial_space, missings):
+        # the file must be utf-8, and not empty
+        self._this = new CCSVReader(
+            path.encode('utf-8'),
+            ord(delimiter),
+            ord(quotechar),
+            skip_initial_space,
+            missings.encode('utf-8'))
+
+    def __dealloc__(self):
+        del self._this
+
+    def scan(self, prog_cb):
+        # returns False if the file needs to be read in python
+        return self._this.scan(_report_progress, <void*>prog_cb)
+
+    def read_into(self, DataSet dataset, ids, prog_cb):
+        cdef vector[int] c_ids = ids
+        self._this.read(deref(dataset._this), c_ids, _report_progress, <void*>prog_cb)
+
+    @property
+    def column_names(self):
+        return [ name.decode('utf-8') for name in self._this.columnNames() ]
+
+    @property
+    def row_count(self):
+        return self._this.rowCount()
+
+    def column_stats(self, index):
+        # as reader.ColumnReader's examine_row() leaves them
+        cdef CColumnStats stats = self._this.columnStats(index)
+        return {
+            'is_empty': stats.isEmpty,
+            'only_integers': stats.onlyIntegers,
+            'only_floats': stats.onlyFloats,
+            'only_euro_floats': stats.onlyEuroFloats,
+            'unique_values': set([ value.decode('utf-8') for value in stats.uniqueValues ]),
+            'many_uniques': stats.manyUniques,
+            'dps': stats.dps,
+        }
+
+cdef extern from "csvwriter.h":
+    cdef cppclass CCSVWriter "CSVWriter":
+        CCSVWriter(CDataSet &dataset, const vector[int] &ids, string newline) except +
+        void write(int fd, CProgressCallback callback, void *context) except +
+
+cdef class CSVWriter:
+    cdef CCSVWriter *_this
+
+    def __cinit__(self, DataSet dataset, ids, newline):
+        cdef vector[int] c_ids = ids
+        self._this = new CCSVWriter(deref(dataset._this), c_ids, newline.encode('utf-8'))
+
+    def __dealloc__(self):
+        del self._this
+
+    def write(self, fd, prog_cb):
+        self._this.write(fd, _report_progress, <void*>prog_cb)
+
+
 def decode(string str):
     return str.c_str().decode('utf-8')
 
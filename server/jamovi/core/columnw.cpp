@@ -3,13 +3,16 @@
 //
 
 #include "columnw.h"
+#include "columnview.h"
 
 #include <stdexcept>
 #include <climits>
 #include <map>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <iomanip>
 #include <cmath>
+#include <cstdio>
 
 #include "dataset.h"
 
@@ -77,11 +80,14 @@ void ColumnW::setDataType(DataType::Type dataType)
     ColumnStruct *s = struc();
     s->dataType = (char)dataType;
     s->changes++;
+    _invalidateSummary();
 
     if (dataType == DataType::DECIMAL)
         _setRowCount<double>(rowCount()); // keeps the row count the same, but allocates space
     else if (dataType == DataType::TEXT && measureType() == MeasureType::ID)
         _setRowCount<char*>(rowCount()); // keeps the row count the same, but allocates space
+
+    _invalidateZones();
 }
 
 void ColumnW::setMeasureType(MeasureType::Type measureType)
@@ -89,9 +95,12 @@ void ColumnW::setMeasureType(MeasureType::Type measureType)
     ColumnStruct *s = struc();
     s->measureType = (char)measureType;
     s->changes++;
+    _invalidateSummary();
 
     if (dataType() == DataType::TEXT && measureType == MeasureType::ID)
         _setRowCount<char*>(rowCount()); // keeps the row count the same, but allocates space
+
+    _invalidateZones();
 }
 
 void ColumnW::setAutoMeasure(bool yes)
@@ -128,17 +137,13 @@ void ColumnW::setTrimLevels(bool trim)
 void ColumnW::trimUnusedLevels()
 {
     ColumnStruct *s = struc();
-
     Level *levels = _mm->resolve(s->levels);
+
+    vector<bool> remove(s->levelsUsed);
     for (int i = 0; i < s->levelsUsed; i++)
-    {
-        Level &level = levels[i];
-        if (level.count == 0 && level.pinned == false)
-        {
-            removeLevel(level.value);
-            i--;
-        }
-    }
+        remove[i] = (levels[i].count == 0 && levels[i].pinned == false);
+
+    _removeLevels(remove);
 }
 
 void ColumnW::setFormula(const char *value)
@@ -192,6 +197,9 @@ void ColumnW::setDValue(int rowIndex, double value, bool initing)
     if ( ! initing)
         _discardScratchColumn();
 
+    double oldValue = cellAt<double>(rowIndex);
+    _updateSummary(oldValue, value);
+    _updateZone(rowIndex, oldValue, value);
     cellAt<double>(rowIndex) = value;
 }
 
@@ -203,7 +211,12 @@ void ColumnW::setSValue(int rowIndex, const char *value, bool initing)
     assert(dataType() == DataType::TEXT);
     assert(measureType() == MeasureType::ID);
 
-    if (value == NULL || value[0] == '\0')
+    // only the count is kept for text
+    bool wasMissing = cellAt<char*>(rowIndex) == NULL;
+    bool isMissing = value == NULL || value[0] == '\0';
+    _updateSummary(wasMissing ? NAN : 0, isMissing ? NAN : 0);
+
+    if (isMissing)
     {
         cellAt<char*>(rowIndex) = NULL;
     }
@@ -264,7 +277,116 @@ void ColumnW::setIValue(int rowIndex, int value, bool initing)
         }
     }
 
-    cellAt<int>(rowIndex) = value;
+    double oldValue = _summaryValue(raw<int>(rowIndex));
+    _updateSummary(oldValue, _summaryValue(value));
+    _updateZone(rowIndex, oldValue, _summaryValue(value));
+    _setInt(rowIndex, value);
+}
+
+void ColumnW::_setInt(int rowIndex, int value)
+{
+    ColumnStruct *cs = struc();
+
+    if (intSizeFor(value) > cs->intSize)
+    {
+        _setIntSize(intSizeFor(value));
+        cs = struc();
+    }
+
+    int perBlock = VALUES_SPACE / cs->intSize;
+    Block **blocks = _mm->resolve<Block*>(cs->blocks);
+    Block *block = _mm->resolve<Block>(blocks[rowIndex / perBlock]);
+
+    writeInt(block->values, cs->intSize, rowIndex % perBlock, value);
+}
+
+void ColumnW::_setIntSize(int size, bool keepValues)
+{
+    ColumnStruct *cs = struc();
+    int oldSize = cs->intSize;
+    int count = cs->rowCount;
+
+    if (size == oldSize)
+        return;
+
+    if (size > oldSize)
+    {
+        // further blocks for the wider cells
+        cs->intSize = size;
+        _setRowCount<int>(count);
+        cs = struc();
+    }
+
+    if (keepValues)
+    {
+        // the cells are moved within the blocks, from the end when they're
+        // widening, from the start when narrowing, so each is read before
+        // it's overwritten. VALUES_SPACE is a multiple of each size, so a
+        // cell's place across the blocks is rowIndex * size
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+
+        auto cells = [&](int rowIndex, int cellSize) {
+            return _mm->resolve<Block>(blocks[(int64_t)rowIndex * cellSize / VALUES_SPACE])->values;
+        };
+
+        int oldPerBlock = VALUES_SPACE / oldSize;
+        int newPerBlock = VALUES_SPACE / size;
+
+        if (size > oldSize)
+        {
+            for (int i = count - 1; i >= 0; i--)
+            {
+                int value = readInt(cells(i, oldSize), oldSize, i % oldPerBlock);
+                writeInt(cells(i, size), size, i % newPerBlock, value);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < count; i++)
+            {
+                int value = readInt(cells(i, oldSize), oldSize, i % oldPerBlock);
+                writeInt(cells(i, size), size, i % newPerBlock, value);
+            }
+        }
+    }
+
+    cs->intSize = size;
+    _invalidateZones();
+}
+
+void ColumnW::_reserveBlocks(int count)
+{
+    // 8 MB; beyond this, the runs are long enough, and the blocks left
+    // unused in the last extent would be too many
+    const int MAX_EXTENT_BLOCKS = 256;
+
+    ColumnStruct *cs = struc();
+    int blocks = min(max(cs->blocksUsed, 1), MAX_EXTENT_BLOCKS);
+    blocks = max(blocks, count);
+
+    Block *extent = _mm->allocateSize<Block>((size_t)blocks * BLOCK_SIZE);
+
+    cs = struc();
+    cs->extent = _mm->base(extent);
+    cs->extentBlocks = blocks;
+}
+
+int ColumnW::_intSizeFor(const vector<int> &values)
+{
+    int size = 1;
+
+    for (size_t i = 0; i < values.size() && size < 4; i++)
+        size = max(size, intSizeFor(values[i]));
+
+    if (hasLevels())
+    {
+        ColumnStruct *s = struc();
+        Level *levels = _mm->resolve(s->levels);
+        for (int i = 0; i < s->levelsUsed && size < 4; i++)
+            size = max(size, intSizeFor(levels[i].value));
+    }
+
+    return size;
 }
 
 void ColumnW::insertRows(int insStart, int insEnd)
@@ -298,11 +420,13 @@ void ColumnW::insertRows(int insStart, int insEnd)
         setRowCount<int>(finalCount);
 
         for (int j = finalCount - 1; j > insEnd; j--)
-            cellAt<int>(j) = cellAt<int>(j - insCount);
+            _setInt(j, raw<int>(j - insCount));
 
         for (int j = insStart; j <= insEnd; j++)
-            cellAt<int>(j) = INT_MIN;
+            _setInt(j, INT_MIN);
     }
+
+    _invalidateZones(insStart, finalCount);
 }
 
 void ColumnW::appendLevel(int value, const char *label, const char *importValue, bool pinned)
@@ -392,24 +516,28 @@ void ColumnW::updateLevelCounts() {
         Level *levels = _mm->resolve(s->levels);
         int levelCount = s->levelsUsed;
 
+        // the level of each value, rather than rawLevel()'s search for each cell
+        unordered_map<int, Level*> byValue;
+
         for (int i = 0; i < levelCount; i++)
         {
             Level &level = levels[i];
             level.count = 0;
             level.countExFiltered = 0;
+            byValue.emplace(level.value, &level);
         }
 
-        for (int i = 0; i < rowCount(); i++)
-        {
-            int &v = this->cellAt<int>(i);
-            if (v == INT_MIN)
-                continue;
-            Level *level = rawLevel(v);
-            assert(level != NULL);
+        TypedColumnView<int, ColumnKind::LEVELS> view(*this);
+        view.forEach(0, view.rowCount(), [&](int rowIndex, int value) {
+            if (value == INT_MIN)
+                return;
+            auto itr = byValue.find(value);
+            assert(itr != byValue.end());
+            Level *level = itr->second;
             level->count++;
-            if ( ! this->_parent->isRowFiltered(i))
+            if ( ! this->_parent->isRowFiltered(rowIndex))
                 level->countExFiltered++;
-        }
+        });
     }
 }
 
@@ -421,7 +549,10 @@ void ColumnW::insertLevel(int value, const char *label, const char *importValue,
     Level *levels = _mm->resolve(s->levels);
     int lastIndex = s->levelsUsed - 1;
     char *baseLabel = levels[lastIndex].label;
+    int baseCapacity = levels[lastIndex].capacity;
     char *baseImportValue = levels[lastIndex].importValue;
+    int baseImportCapacity = levels[lastIndex].importCapacity;
+    bool baseTreatAsMissing = levels[lastIndex].treatAsMissing;
 
     bool ascending = true;
     bool descending = true;
@@ -441,10 +572,13 @@ void ColumnW::insertLevel(int value, const char *label, const char *importValue,
 
         Level &level = levels[lastIndex];
         level.value = value;
+        level.capacity = baseCapacity;
         level.label = baseLabel;
+        level.importCapacity = baseImportCapacity;
         level.importValue = baseImportValue;
         level.count = 0;
         level.countExFiltered = 0;
+        level.treatAsMissing = baseTreatAsMissing;
         level.pinned = pinned;
     }
     else
@@ -469,10 +603,13 @@ void ColumnW::insertLevel(int value, const char *label, const char *importValue,
             else
             {
                 nextLevel.value = value;
+                nextLevel.capacity = baseCapacity;
                 nextLevel.label = baseLabel;
+                nextLevel.importCapacity = baseImportCapacity;
                 nextLevel.importValue = baseImportValue;
                 nextLevel.count = 0;
                 nextLevel.countExFiltered = 0;
+                nextLevel.treatAsMissing = baseTreatAsMissing;
                 nextLevel.pinned = pinned;
                 inserted = true;
                 break;
@@ -483,10 +620,13 @@ void ColumnW::insertLevel(int value, const char *label, const char *importValue,
         {
             Level &level = levels[0];
             level.value = value;
+            level.capacity = baseCapacity;
             level.label = baseLabel;
+            level.importCapacity = baseImportCapacity;
             level.importValue = baseImportValue;
             level.count = 0;
             level.countExFiltered = 0;
+            level.treatAsMissing = baseTreatAsMissing;
             level.pinned = pinned;
         }
     }
@@ -509,28 +649,82 @@ void ColumnW::removeLevel(int value)
 
     assert(i != s->levelsUsed); // level not found
 
-    int index = i;
+    vector<bool> remove(s->levelsUsed, false);
+    remove[i] = true;
+    _removeLevels(remove);
+}
 
-    for (; i < s->levelsUsed - 1; i++)
-        levels[i] = levels[i+1];
+void ColumnW::_removeLevels(const vector<bool> &remove)
+{
+    ColumnStruct *s = struc();
+    Level *levels = _mm->resolve(s->levels);
+    int n = s->levelsUsed;
 
-    s->levelsUsed--;
+    // the levels are compacted in place
+    vector<int> removed;
+    int used = 0;
 
-    if (dataType() == DataType::TEXT)
+    for (int i = 0; i < n; i++)
     {
-        // consolidate levels
+        if (remove[i])
+            removed.push_back(levels[i].value);
+        else
+            levels[used++] = levels[i];
+    }
 
-        for (int i = index; i < s->levelsUsed; i++)
-            levels[i].value--;
+    if (removed.empty())
+        return;
 
-        for (int i = 0; i < rowCount(); i++) {
-            int &v = this->cellAt<int>(i);
-            if (v > value)
-                v--;
-        }
+    s->levelsUsed = used;
+    s->changes++;
+
+    if (dataType() != DataType::TEXT)
+        return;
+
+    // consolidate levels; each value comes down by the number of removed
+    // values below it
+
+    sort(removed.begin(), removed.end());
+    int lo = removed.front();
+    int hi = removed.back();
+
+    vector<int> table(hi - lo + 1);
+    size_t below = 0;
+
+    for (int value = lo; value <= hi; value++)
+    {
+        table[value - lo] = below;
+        while (below < removed.size() && removed[below] == value)
+            below++;
     }
 
-    s->changes++;
+    auto recode = [&](int value) {
+        if (value <= lo)
+            return value;
+        else if (value > hi)
+            return value - (int)removed.size();
+        else
+            return value - table[value - lo];
+    };
+
+    bool shifted = false;
+    for (int i = 0; i < used; i++)
+    {
+        int value = recode(levels[i].value);
+        shifted |= (value != levels[i].value);
+        levels[i].value = value;
+    }
+
+    if ( ! shifted)
+        return;
+
+    // the cells are rewritten in one pass
+
+    vector<int> values = _rawValues<int>();
+    for (int &value : values)
+        value = recode(value);
+
+    _setRawValues(values);
 }
 
 void ColumnW::clearLevels()
@@ -540,6 +734,149 @@ void ColumnW::clearLevels()
     s->changes++;
 }
 
+ColumnSummary ColumnW::summary()
+{
+    ColumnStruct *s = struc();
+    if ( ! s->summary.valid)
+        s->summary = computeSummary();
+    return s->summary;
+}
+
+void ColumnW::_updateSummary(double oldValue, double newValue)
+{
+    ColumnStruct *s = struc();
+    ColumnSummary &summary = s->summary;
+
+    if ( ! summary.valid)
+        return;
+
+    bool numeric = dataType() != DataType::TEXT;
+    bool decimal = dataType() == DataType::DECIMAL;
+
+    if ( ! isnan(oldValue))
+    {
+        if (numeric)
+        {
+            // the min or max would have to be found again, and the sums
+            // of decimals (or of integers past 2^53) would drift
+            if (decimal ||
+                oldValue == summary.min ||
+                oldValue == summary.max ||
+                summary.sumSq >= 9007199254740992.0)
+            {
+                summary.valid = false;
+                return;
+            }
+
+            summary.sum -= oldValue;
+            summary.sumSq -= oldValue * oldValue;
+        }
+
+        summary.count--;
+    }
+
+    if ( ! isnan(newValue))
+    {
+        if (numeric)
+            addToSummary(summary, newValue, decimal);
+        else
+            summary.count++;
+    }
+}
+
+void ColumnW::_invalidateSummary()
+{
+    struc()->summary.valid = false;
+}
+
+void ColumnW::refreshZones()
+{
+    if (dataType() == DataType::TEXT)
+        return;
+
+    int perBlock = rowsPerZone();
+    int count = min((rowCount() + perBlock - 1) / perBlock, struc()->zonesCapacity);
+
+    for (int i = 0; i < count; i++)
+    {
+        ColumnStruct *s = struc();
+        BlockZone *zones = _mm->resolve(s->zones);
+        if ( ! zones[i].valid)
+            zones[i] = computeZone(i);
+    }
+}
+
+void ColumnW::_updateZone(int rowIndex, double oldValue, double newValue)
+{
+    if (dataType() == DataType::TEXT)
+        return;
+
+    ColumnStruct *s = struc();
+    int blockIndex = rowIndex / rowsPerZone();
+
+    if (blockIndex >= s->zonesCapacity)
+        return;
+
+    BlockZone &zone = _mm->resolve(s->zones)[blockIndex];
+
+    if ( ! zone.valid)
+        return;
+
+    if (isnan(oldValue))
+        zone.missing--;
+
+    if (isnan(newValue))
+        zone.missing++;
+    else
+        addToZone(zone, newValue);
+}
+
+void ColumnW::_invalidateZones(int start, int end)
+{
+    ColumnStruct *s = struc();
+
+    if (start >= end || s->zonesCapacity == 0)
+        return;
+
+    int perBlock = rowsPerZone();
+    int last = min((end - 1) / perBlock, s->zonesCapacity - 1);
+    BlockZone *zones = _mm->resolve(s->zones);
+
+    for (int i = start / perBlock; i <= last; i++)
+        zones[i].valid = false;
+}
+
+void ColumnW::_invalidateZones()
+{
+    ColumnStruct *s = struc();
+    BlockZone *zones = _mm->resolve(s->zones);
+
+    for (int i = 0; i < s->zonesCapacity; i++)
+        zones[i].valid = false;
+}
+
+void ColumnW::_growZones(int oldCount, int count)
+{
+    // the new cells are missing
+    if (dataType() == DataType::TEXT)
+        return;
+
+    ColumnStruct *s = struc();
+    BlockZone *zones = _mm->resolve(s->zones);
+    int perBlock = rowsPerZone();
+
+    for (int rowIndex = oldCount; rowIndex < count; )
+    {
+        int blockIndex = rowIndex / perBlock;
+        int blockEnd = min(count, (blockIndex + 1) * perBlock);
+
+        if (blockIndex < s->zonesCapacity && zones[blockIndex].valid)
+            zones[blockIndex].missing += blockEnd - rowIndex;
+
+        rowIndex = blockEnd;
+    }
+}
+
 int ColumnW::changes() const
 {
     return struc()->changes;
@@ -618,54 +955,40 @@ void ColumnW::setLevels(const vector<LevelData> &newLevels)
 
     if (dataType() == DataType::INTEGER)
     {
-        clearLevels();
-
-        for (int i = 0; i < newLevels.size(); i++)
-        {
-            const LevelData &newLevel = newLevels[i];
-            appendLevel(newLevel.ivalue(), newLevel.label(), newLevel.svalue(), newLevel.pinned());
-        }
-
-        for (int i = 0; i < rowCount(); i++)
-        {
-            int value = cellAt<int>(i);
-            if (value != INT_MIN)
-                setIValue(i, value, true);
-        }
+        buildLevels(newLevels);
     }
     else if (dataType() == DataType::TEXT)
     {
-        map<int, int> recode;
         const vector<LevelData> oldLevels = levels();
+        unordered_map<string, int> oldIndices;
 
-        for (int i = 0; i < newLevels.size(); i++)
-        {
-            const LevelData &newLevel = newLevels[i];
-            for (int j = 0; j < oldLevels.size(); j++)
-            {
-                const LevelData &oldLevel = oldLevels[j];
-                if (strcmp(oldLevel.svalue(), newLevel.svalue()) == 0)
-                {
-                    recode[j] = i;
-                    break;
-                }
-            }
-        }
+        for (int j = 0; j < (int)oldLevels.size(); j++)
+            oldIndices.emplace(oldLevels[j].svalue(), j);  // the first
 
-        clearLevels();
+        // rows with levels not among the new levels become 0
+        vector<int> recode(oldLevels.size(), 0);
 
-        for (int i = 0; i < newLevels.size(); i++)
+        for (int i = 0; i < (int)newLevels.size(); i++)
         {
-            const LevelData &newLevel = newLevels[i];
-            appendLevel(i, newLevel.label(), newLevel.svalue(), newLevel.pinned());
+            auto itr = oldIndices.find(newLevels[i].svalue());
+            if (itr != oldIndices.end())
+                recode[itr->second] = i;
         }
 
-        for (int i = 0; i < rowCount(); i++)
-        {
-            int value = cellAt<int>(i);
-            if (value != INT_MIN)
-                setIValue(i, recode[value], true);
-        }
+        TypedColumnView<int, ColumnKind::LEVELS> view(*this);
+        vector<int> values(view.rowCount());
+
+        view.forEach(0, view.rowCount(), [&](int rowIndex, int value) {
+            if (value == INT_MIN)
+                values[rowIndex] = INT_MIN;
+            else if (value >= 0 && value < (int)recode.size())
+                values[rowIndex] = recode[value];
+            else
+                values[rowIndex] = 0;
+        });
+
+        _setRawValues(values);
+        buildLevels(newLevels);
     }
     else
     {
@@ -675,11 +998,171 @@ void ColumnW::setLevels(const vector<LevelData> &newLevels)
     trimUnusedLevels();
 }
 
+void ColumnW::buildLevels(const vector<LevelData> &newLevels)
+{
+    int n = newLevels.size();
+    bool text = dataType() == DataType::TEXT;
+
+    vector<int> values(n);
+    int minValue = INT_MAX;
+    int maxValue = INT_MIN;
+
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = text ? i : newLevels[i].ivalue();
+        minValue = min(minValue, values[i]);
+        maxValue = max(maxValue, values[i]);
+    }
+
+    // the index of the level of each value (the first, as rawLevel()), in
+    // a table where the values are close together, as they usually are
+    vector<int> table;
+    unordered_map<int, int> indices;
+    bool dense = n > 0 && (long long)maxValue - minValue < 4LL * n + 64;
+
+    if (dense)
+        table.resize(maxValue - minValue + 1, -1);
+
+    for (int i = n - 1; i >= 0; i--)
+    {
+        if (dense)
+            table[values[i] - minValue] = i;
+        else
+            indices[values[i]] = i;
+    }
+
+    auto indexOf = [&](int value) {
+        if (dense)
+            return (value < minValue || value > maxValue) ? -1 : table[value - minValue];
+        auto itr = indices.find(value);
+        return itr != indices.end() ? itr->second : -1;
+    };
+
+    // the levels are counted in one pass of the cells. cells with values
+    // without a level are given one afterwards, as setIValue() would
+
+    bool countExFiltered = columnType() != ColumnType::FILTER;
+    vector<int> counts(n, 0);
+    vector<int> countsExFiltered(n, 0);
+    vector<int> unlevelled;
+    unordered_map<int, pair<int, int>> unlevelledCounts;
+
+    TypedColumnView<int, ColumnKind::LEVELS> view(*this);
+    view.forEach(0, view.rowCount(), [&](int rowIndex, int value) {
+        if (value == INT_MIN)
+            return;
+
+        bool exFiltered = countExFiltered && ! this->_parent->isRowFiltered(rowIndex);
+        int index = indexOf(value);
+
+        if (index != -1)
+        {
+            counts[index]++;
+            if (exFiltered)
+                countsExFiltered[index]++;
+        }
+        else
+        {
+            auto counted = unlevelledCounts.emplace(value, make_pair(0, 0));
+            if (counted.second)
+                unlevelled.push_back(value);
+            counted.first->second.first++;
+            if (exFiltered)
+                counted.first->second.second++;
+        }
+    });
+
+    // the levels, and then their text, are each allocated at once
+
+    ColumnStruct *s = struc();
+
+    if (n > s->levelsCapacity)
+    {
+        Level *levels = _mm->allocateBase<Level>(n);
+        s = struc();
+        s->levels = levels;
+        s->levelsCapacity = n;
+    }
+
+    size_t size = 0;
+    for (const LevelData &level : newLevels)
+        size += strlen(level.label()) + strlen(level.svalue()) + 2;
+
+    size_t allocated = 0;
+    char *chars = size > 0 ? _mm->allocateSizeBase<char>(size, &allocated) : NULL;
+    bool missingValues = struc()->missingValuesUsed > 0;
+
+    s = struc();
+    s->levelsUsed = n;
+
+    for (int i = 0; i < n; i++)
+    {
+        const LevelData &newLevel = newLevels[i];
+        const char *label = newLevel.label();
+        const char *importValue = newLevel.svalue();
+        int labelLength = strlen(label) + 1;
+        int importLength = strlen(importValue) + 1;
+
+        // the padding of the allocation is after the last import value
+        int importCapacity = importLength;
+        if (i == n - 1)
+            importCapacity += allocated - size;
+
+        bool treatAsMissing = false;
+        if (missingValues && text)
+            treatAsMissing = shouldTreatAsMissing(label, importValue);
+        else if (missingValues)
+            treatAsMissing = shouldTreatAsMissing(label, values[i]);
+
+        char *labelChars = _mm->resolve(chars);
+        memcpy(labelChars, label, labelLength);
+        memcpy(labelChars + labelLength, importValue, importLength);
+
+        Level &level = _mm->resolve(struc()->levels)[i];
+        level.value = values[i];
+        level.capacity = labelLength;
+        level.label = chars;
+        level.importCapacity = importCapacity;
+        level.importValue = chars + labelLength;
+        level.count = counts[i];
+        level.countExFiltered = countsExFiltered[i];
+        level.treatAsMissing = treatAsMissing;
+        level.pinned = newLevel.pinned();
+
+        chars += labelLength + importLength;
+    }
+
+    for (int value : unlevelled)
+    {
+        char buffer[FORMAT_BUFFER_SIZE];
+        formatIValue(buffer, value);
+        insertLevel(value, buffer, buffer);
+
+        Level *level = rawLevel(value);
+        level->count = unlevelledCounts[value].first;
+        level->countExFiltered = unlevelledCounts[value].second;
+    }
+
+    struc()->changes++;
+}
+
 void ColumnW::changeDMType(DataType::Type dataType, MeasureType::Type measureType)
 {
-    if (measureType == MeasureType::NONE && dataType == DataType::NONE)
+    ColumnW old;
+
+    if ( ! _beginChangeDMType(dataType, measureType, old, true))
         return;
 
+    Conversion conversion;
+    _convert(old, conversion);
+    _applyConversion(conversion);
+}
+
+bool ColumnW::_beginChangeDMType(DataType::Type dataType, MeasureType::Type measureType, ColumnW &old, bool useScratch)
+{
+    if (measureType == MeasureType::NONE && dataType == DataType::NONE)
+        return false;
+
     /*
      * when changing the data/measure type, the innards of the column are
      * exchanged with a 'scratch' column. the old values are then copied to the
@@ -690,7 +1173,7 @@ void ColumnW::changeDMType(DataType::Type dataType, MeasureType::Type measureTyp
      */
 
     DataSetW *ds = (DataSetW*)_parent;
-    ColumnW old = ds->swapWithScratchColumn(*this);
+    old = useScratch ? ds->swapWithScratchColumn(*this) : ds->swapWithNewColumn(*this);
 
     if (measureType != MeasureType::NONE)
     {
@@ -731,7 +1214,7 @@ void ColumnW::changeDMType(DataType::Type dataType, MeasureType::Type measureTyp
         dataType = old.dataType();
 
     if (id() == old.id() && dataType == this->dataType() && measureType == this->measureType())
-        return;
+        return false;
 
     if (id() == old.id() && this->dataType() == DataType::TEXT)
     {
@@ -762,163 +1245,656 @@ void ColumnW::changeDMType(DataType::Type dataType, MeasureType::Type measureTyp
     else
         _setRowCount<int>(_parent->rowCount());
 
-    ColumnW::_transferLevels(*this, old);
+    return true;
+}
+
+void ColumnW::_convert(ColumnW &src, Conversion &conversion)
+{
+    _findLevels(src, conversion.levels);
+
+    if (dataType() == DataType::INTEGER)
+        _convertToInteger(src, conversion);
+    else if (dataType() == DataType::TEXT && measureType() == MeasureType::ID)
+        _convertToID(src, conversion);
+    else if (dataType() == DataType::TEXT)
+        _convertToText(src, conversion);
+    else if (dataType() == DataType::DECIMAL)
+        _convertToDecimal(src, conversion);
+}
 
-    if (dataType == DataType::INTEGER)
+void ColumnW::_applyConversion(Conversion &conversion)
+{
+    clearLevels();
+
+    if (hasLevels())
     {
-        for (int rowNo = 0; rowNo < old.rowCount(); rowNo++)
-        {
-            int value = old.ivalue(rowNo);
-            setIValue(rowNo, value, true);
-        }
+        for (NewLevel &level : conversion.levels)
+            appendLevel(level.value, level.label.c_str(), level.importValue.c_str());
     }
-    else if (dataType == DataType::TEXT)
+
+    if (dataType() == DataType::DECIMAL)
     {
-        if (measureType == MeasureType::ID)
-        {
-            for (int rowNo = 0; rowNo < rowCount(); rowNo++)
-            {
-                const char *value = old.svalue(rowNo);
-                string copy = string(value);
-                // value is in shared memory, which may move if setSValue
-                // results in a segment enlargement, so we make a copy
-                setSValue(rowNo, copy.c_str(), true);
-            }
-        }
-        else
+        _setRawValues(conversion.dvalues);
+    }
+    else if (dataType() == DataType::TEXT && measureType() == MeasureType::ID)
+    {
+        // the text is in conversion, so isn't moved by setSValue()
+        for (int i = 0; i < (int)conversion.ivalues.size(); i++)
         {
-            for (int rowNo = 0; rowNo < rowCount(); rowNo++)
-            {
-                const char *value = old.svalue(rowNo);
-
-                if (value[0] != '\0')
-                {
-                    int levelIndex = valueForLabel(value);
-                    setIValue(rowNo, levelIndex, true);
-                }
-                else
-                {
-                    setIValue(rowNo, INT_MIN, true);
-                }
-            }
+            int offset = conversion.ivalues[i];
+            setSValue(i, offset == -1 ? "" : &conversion.text[offset], true);
         }
     }
-    else if (dataType == DataType::DECIMAL)
+    else if (hasLevels())
+    {
+        _setLevelValues(conversion.ivalues);
+    }
+    else
     {
-        bool isEuroFloatColumn = old.isEuroDecimalTextColumn();
+        _setRawValues(conversion.ivalues);
+    }
+}
 
-        for (int rowNo = 0; rowNo < old.rowCount(); rowNo++)
-            setDValue(rowNo, old.dvalue(rowNo, isEuroFloatColumn), true);
+namespace
+{
+    // sorts the levels into the order that successive insertLevel()s into
+    // an empty column would leave them; ascending, unless the second level
+    // inserted is less than the first, in which case descending
+    template<typename L> void sortAsInserted(vector<L> &levels)
+    {
+        if (levels.size() > 1)
+        {
+            bool descending = levels[1].value < levels[0].value;
+            sort(levels.begin(), levels.end(), [descending](const L &a, const L &b) {
+                return descending ? a.value > b.value : a.value < b.value;
+            });
+        }
     }
 }
 
-void ColumnW::_transferLevels(ColumnW &dest, ColumnW &src)
+void ColumnW::_findLevels(ColumnW &src, vector<NewLevel> &newLevels)
 {
-    dest.clearLevels();
+    // the levels for the column, in the order they're appended
+
+    ColumnW &dest = *this;
+
+    newLevels.clear();
     if ( ! dest.hasLevels())
         return;
 
-    int count = 0;
+    char buffer[FORMAT_BUFFER_SIZE];
 
     if (src.hasLevels())
     {
         vector<LevelData> levels = src.levels();
-        vector<LevelData>::iterator itr;
 
-        for (itr = levels.begin(); itr != levels.end(); itr++)
+        if (dest.dataType() == DataType::TEXT)
         {
-            LevelData &level = *itr;
+            int count = 0;
 
-            if (dest.dataType() == DataType::TEXT)
+            for (LevelData &level : levels)
             {
                 const char *value = level.svalue();
                 if (value[0] != '\0')
-                    dest.appendLevel(count++, level.label(), level.svalue());
+                    newLevels.push_back({ count++, level.label(), level.svalue() });
             }
-            else
+        }
+        else
+        {
+            unordered_set<int> seen;
+
+            for (LevelData &level : levels)
             {
                 int value = level.ivalue();
-                if (value != INT_MIN && ! dest.hasLevel(value))
+                if (value == INT_MIN || ! seen.insert(value).second)
+                    continue;
+
+                if (level.hasLabelChanged())
                 {
-                    if (level.hasLabelChanged())
-                        dest.insertLevel(value, level.label(), level.svalue());
-                    else
-                        dest.insertLevel(value);
+                    newLevels.push_back({ value, level.label(), level.svalue() });
+                }
+                else
+                {
+                    formatIValue(buffer, value);
+                    newLevels.push_back({ value, buffer, buffer });
                 }
             }
+
+            sortAsInserted(newLevels);
         }
     }
-    else
+    else if (dest.dataType() == DataType::TEXT)
     {
-        if (dest.dataType() == DataType::TEXT)
+        if (src.dataType() == DataType::DECIMAL)
         {
-            if (src.dataType() == DataType::DECIMAL)
+            vector<double> values = src._rawValues<double>();
+            vector<int64_t> thous;
+            unordered_set<int64_t> seen;
+
+            for (double value : values)
             {
-                set<int64_t> values;
+                if (isnan(value))
+                    continue;
+                int64_t t = (int64_t)round(value * 1000);
+                if (seen.insert(t).second)
+                    thous.push_back(t);
+            }
 
-                for (int i = 0; i < src.rowCount(); i++)
-                {
-                    double value = src.dvalue(i);
-                    if ( ! isnan(value))
-                        values.insert((int64_t)round(value * 1000));
-                }
+            sort(thous.begin(), thous.end());
 
-                int count = 0;
-                set<int64_t>::iterator itr;
-                for (itr = values.begin(); itr != values.end(); itr++)
-                {
-                    int64_t value = *itr;
-                    stringstream ss;
-                    ss.setf(ios::fixed);
-                    ss << setprecision(src.dps());
-                    ss << ((double)value) / 1000;
-                    string v = ss.str();
-                    dest.insertLevel(count++, v.c_str(), v.c_str());
-                }
+            int count = 0;
+            int dps = src.dps();
+
+            for (int64_t value : thous)
+            {
+                snprintf(buffer, FORMAT_BUFFER_SIZE, "%.*f", dps, ((double)value) / 1000);
+                newLevels.push_back({ count++, buffer, buffer });
             }
-            else if (src.dataType() == DataType::INTEGER)
+        }
+        else if (src.dataType() == DataType::INTEGER)
+        {
+            vector<int> values = src._rawValues<int>();
+            unordered_set<int> seen;
+
+            for (int value : values)
             {
-                int value;
-                for (int i = 0; i < src.rowCount(); i++)
+                if (value != INT_MIN && seen.insert(value).second)
                 {
-                    value = src.ivalue(i);
-                    if (value != INT_MIN && ! dest.hasLevel(value))
-                        dest.insertLevel(value, src.svalue(i));
+                    formatIValue(buffer, value);
+                    newLevels.push_back({ value, buffer, buffer });
                 }
+            }
 
-                ColumnStruct *s = dest.struc();
-                Level *levels = dest._mm->resolve(s->levels);
-                for (int i = 0; i < s->levelsUsed; i++)
-                    levels[i].value = i;
+            sortAsInserted(newLevels);
+
+            for (int i = 0; i < (int)newLevels.size(); i++)
+                newLevels[i].value = i;
+        }
+        else
+        {
+            unordered_set<string> seen;
+            int count = 0;
+
+            for (int i = 0; i < src.rowCount(); i++)
+            {
+                const char *value = src.raws(i);
+                if (value[0] != '\0' && seen.insert(value).second)
+                    newLevels.push_back({ count++, value, value });
+            }
+        }
+    }
+    else if (dest.dataType() == DataType::INTEGER)
+    {
+        vector<int> values = src._ivalues();
+        unordered_set<int> seen;
+
+        for (int i = 0; i < (int)values.size(); i++)
+        {
+            int value = values[i];
+            if (value == INT_MIN || ! seen.insert(value).second)
+                continue;
+
+            if (src.dataType() == DataType::TEXT)
+            {
+                const char *label = src.raws(i);
+                newLevels.push_back({ value, label, label });
             }
             else
             {
-                int count = 0;
-                for (int i = 0; i < src.rowCount(); i++)
-                {
-                    const char *value = src.svalue(i);
-                    if (value[0] != '\0' && ! dest.hasLevel(value))
-                        dest.appendLevel(count++, value);
-                }
+                // src.svalue() would return a decimal string for DECIMAL
+                formatIValue(buffer, value);
+                newLevels.push_back({ value, buffer, buffer });
             }
         }
-        else if (dest.dataType() == DataType::INTEGER)
+
+        sortAsInserted(newLevels);
+    }
+}
+
+/*
+ * the conversion kernels read the whole of the source column a block at a
+ * time, and convert each distinct level (rather than each row) where they
+ * can. they only read from the memory map, and _applyConversion() then
+ * writes the whole of the destination column. together they produce the
+ * same results as converting each row with ivalue(), svalue() or dvalue()
+ * and setIValue(), setSValue() or setDValue().
+ */
+
+void ColumnW::_convertToInteger(ColumnW &src, Conversion &conversion)
+{
+    conversion.ivalues = src._ivalues();
+    conversion.ivalues.resize(rowCount(), INT_MIN);
+}
+
+void ColumnW::_convertToDecimal(ColumnW &src, Conversion &conversion)
+{
+    bool isEuroFloatColumn = src.isEuroDecimalTextColumn();
+
+    conversion.dvalues = src._dvalues(isEuroFloatColumn);
+    conversion.dvalues.resize(rowCount(), NAN);
+}
+
+void ColumnW::_convertToText(ColumnW &src, Conversion &conversion)
+{
+    // as valueForLabel() once the levels are appended; the first level
+    // with a matching label or import value
+    unordered_map<string, int> lookup;
+    for (NewLevel &level : conversion.levels)
+    {
+        lookup.emplace(level.label, level.value);
+        lookup.emplace(level.importValue, level.value);
+    }
+
+    auto valueForLabel = [&lookup](const char *label) {
+        if (label[0] == '\0')
+            return INT_MIN;
+        auto itr = lookup.find(label);
+        if (itr == lookup.end())
         {
-            for (int i = 0; i < src.rowCount(); i++)
+            stringstream ss;
+            ss << "level '" << label << "' not found";
+            throw runtime_error(ss.str());
+        }
+        return itr->second;
+    };
+
+    int rowCount = min(this->rowCount(), src.rowCount());
+    vector<int> &values = conversion.ivalues;
+    values.assign(this->rowCount(), INT_MIN);
+    char buffer[FORMAT_BUFFER_SIZE];
+
+    if (src.dataType() == DataType::INTEGER)
+    {
+        vector<int> ivalues = src._rawValues<int>();
+        unordered_map<int, int> converted;
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            int ivalue = ivalues[i];
+            if (ivalue == INT_MIN)
+                continue;
+
+            auto itr = converted.find(ivalue);
+            if (itr == converted.end())
             {
-                int value = src.ivalue(i);
-                if (value != INT_MIN && ! dest.hasLevel(value))
-                {
-                    if (src.dataType() == DataType::DECIMAL)
-                        dest.insertLevel(value); // src.svalue() would return a decimal string
-                    else
-                        dest.insertLevel(value, src.svalue(i));
-                }
+                formatIValue(buffer, ivalue);
+                itr = converted.emplace(ivalue, valueForLabel(buffer)).first;
+            }
+
+            values[i] = itr->second;
+        }
+    }
+    else if (src.dataType() == DataType::DECIMAL)
+    {
+        vector<double> dvalues = src._rawValues<double>();
+        int dps = src.dps();
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            formatDValue(buffer, dvalues[i], dps);
+            values[i] = valueForLabel(buffer);
+        }
+    }
+    else if (src.measureType() == MeasureType::ID)
+    {
+        for (int i = 0; i < rowCount; i++)
+            values[i] = valueForLabel(src.raws(i));
+    }
+    else
+    {
+        vector<string> svalues;
+        vector<int> indices = src._levelIndices(svalues);
+        vector<int> converted(svalues.size());
+        vector<bool> done(svalues.size(), false);
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            int index = indices[i];
+            if (index == -1)
+                continue;
+
+            if ( ! done[index])
+            {
+                converted[index] = valueForLabel(svalues[index].c_str());
+                done[index] = true;
             }
+
+            values[i] = converted[index];
         }
     }
 }
 
+void ColumnW::_convertToID(ColumnW &src, Conversion &conversion)
+{
+    // the text of each row is appended to conversion.text, and its offset
+    // kept in conversion.ivalues (-1 for empty cells)
+
+    int rowCount = min(this->rowCount(), src.rowCount());
+    char buffer[FORMAT_BUFFER_SIZE];
+
+    vector<int> &offsets = conversion.ivalues;
+    string &text = conversion.text;
+    offsets.assign(rowCount, -1);
+
+    auto append = [&](int rowIndex, const char *value) {
+        if (value[0] == '\0')
+            return;
+        offsets[rowIndex] = text.size();
+        text.append(value);
+        text.push_back('\0');
+    };
+
+    if (src.dataType() == DataType::INTEGER)
+    {
+        vector<int> ivalues = src._rawValues<int>();
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            if (ivalues[i] != INT_MIN)
+            {
+                formatIValue(buffer, ivalues[i]);
+                append(i, buffer);
+            }
+        }
+    }
+    else if (src.dataType() == DataType::DECIMAL)
+    {
+        vector<double> dvalues = src._rawValues<double>();
+        int dps = src.dps();
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            formatDValue(buffer, dvalues[i], dps);
+            append(i, buffer);
+        }
+    }
+    else if (src.measureType() == MeasureType::ID)
+    {
+        for (int i = 0; i < rowCount; i++)
+            append(i, src.raws(i));
+    }
+    else
+    {
+        vector<string> svalues;
+        vector<int> indices = src._levelIndices(svalues);
+
+        for (int i = 0; i < rowCount; i++)
+        {
+            int index = indices[i];
+            if (index != -1)
+                append(i, svalues[index].c_str());
+        }
+    }
+}
+
+void ColumnW::recode(ColumnW &source, const vector<int> &from, const vector<int> &to)
+{
+    vector<int> values = _recodeValues<int>(source, from, to, INT_MIN);
+
+    if (hasLevels())
+        _setLevelValues(values);
+    else
+        _setRawValues(values);
+}
+
+void ColumnW::recode(ColumnW &source, const vector<int> &from, const vector<double> &to)
+{
+    vector<double> values = _recodeValues<double>(source, from, to, NAN);
+
+    _discardScratchColumn();
+    _setRawValues(values);
+}
+
+void ColumnW::_setLevelValues(const vector<int> &values, int start)
+{
+    // equivalent to setIValue(start + i, values[i], true) for each value
+
+    unordered_map<int, int> indices;
+
+    auto index = [&]() {
+        indices.clear();
+        ColumnStruct *s = struc();
+        Level *levels = _mm->resolve(s->levels);
+        for (int i = 0; i < s->levelsUsed; i++)
+            indices.emplace(levels[i].value, i);  // the first, as rawLevel()
+    };
+
+    index();
+
+    bool countExFiltered = columnType() != ColumnType::FILTER;
+
+    for (int i = 0; i < (int)values.size(); i++)
+    {
+        int value = values[i];
+        if (value == INT_MIN)
+            continue;
+
+        auto itr = indices.find(value);
+        if (itr == indices.end())
+        {
+            char buffer[FORMAT_BUFFER_SIZE];
+            formatIValue(buffer, value);
+            insertLevel(value, buffer, buffer);
+            index();
+            itr = indices.find(value);
+        }
+
+        Level &level = _mm->resolve(struc()->levels)[itr->second];
+        level.count++;
+        if (countExFiltered && ! _parent->isRowFiltered(start + i))
+            level.countExFiltered++;
+    }
+
+    _setRawValues(values, start);
+}
+
+void ColumnW::setIValues(int start, const vector<int> &values)
+{
+    _discardScratchColumn();
+
+    if (hasLevels())
+        _setLevelValues(values, start);
+    else
+        _setRawValues(values, start);
+}
+
+void ColumnW::setDValues(int start, const vector<double> &values)
+{
+    _discardScratchColumn();
+    _setRawValues(values, start);
+}
+
+int ColumnW::setSValues(int start, const vector<const char*> &values, int maxLevels)
+{
+    if (measureType() == MeasureType::ID)
+    {
+        _discardScratchColumn();
+        for (int i = 0; i < (int)values.size(); i++)
+            setSValue(start + i, values[i], true);
+        return values.size();
+    }
+
+    // the first level with the label or import value, as valueForLabel()
+    unordered_map<string, int> levelValues;
+    ColumnStruct *s = struc();
+    Level *levels = _mm->resolve(s->levels);
+    for (int i = 0; i < s->levelsUsed; i++)
+    {
+        Level &level = levels[i];
+        levelValues.emplace(_mm->resolve(level.label), level.value);
+        levelValues.emplace(_mm->resolve(level.importValue), level.value);
+    }
+
+    vector<int> ivalues;
+    ivalues.reserve(values.size());
+
+    for (const char *value : values)
+    {
+        if (value != NULL)
+        {
+            if (levelValues.find(value) == levelValues.end())
+            {
+                int v = levelCount();
+                appendLevel(v, value, value, false);
+                levelValues.emplace(value, v);
+            }
+
+            if (levelCount() > maxLevels)
+                break;
+        }
+
+        if (value == NULL || value[0] == '\0')
+            ivalues.push_back(INT_MIN);
+        else
+            ivalues.push_back(levelValues[value]);
+    }
+
+    setIValues(start, ivalues);
+
+    return ivalues.size();
+}
+
+vector<int> ColumnW::_ivalues()
+{
+    // equivalent to ivalue() for each row
+
+    if (dataType() == DataType::INTEGER)
+        return _rawValues<int>();
+
+    vector<int> values(rowCount(), INT_MIN);
+
+    if (dataType() == DataType::DECIMAL)
+    {
+        vector<double> dvalues = _rawValues<double>();
+
+        for (size_t i = 0; i < dvalues.size(); i++)
+        {
+            double value = dvalues[i];
+            if ( ! (isnan(value) || value < INT_MIN || value > INT_MAX))
+                values[i] = (int)value;
+        }
+    }
+    else if (measureType() == MeasureType::ID)
+    {
+        for (int i = 0; i < (int)values.size(); i++)
+            values[i] = parseIValue(raws(i));
+    }
+    else
+    {
+        vector<string> svalues;
+        vector<int> indices = _levelIndices(svalues);
+        vector<int> converted(svalues.size());
+
+        for (size_t i = 0; i < svalues.size(); i++)
+            converted[i] = parseIValue(svalues[i].c_str());
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            if (indices[i] != -1)
+                values[i] = converted[indices[i]];
+        }
+    }
+
+    return values;
+}
+
+vector<double> ColumnW::_dvalues(bool acceptEuroDecimal)
+{
+    // equivalent to dvalue() for each row
+
+    if (dataType() == DataType::DECIMAL)
+        return _rawValues<double>();
+
+    vector<double> values(rowCount(), NAN);
+
+    if (dataType() == DataType::INTEGER)
+    {
+        vector<int> ivalues = _rawValues<int>();
+
+        for (size_t i = 0; i < ivalues.size(); i++)
+        {
+            if (ivalues[i] != INT_MIN)
+                values[i] = (double)ivalues[i];
+        }
+    }
+    else if (measureType() == MeasureType::ID)
+    {
+        for (int i = 0; i < (int)values.size(); i++)
+            values[i] = parseDValue(raws(i), acceptEuroDecimal);
+    }
+    else
+    {
+        vector<string> svalues;
+        vector<int> indices = _levelIndices(svalues);
+        vector<double> converted(svalues.size());
+
+        for (size_t i = 0; i < svalues.size(); i++)
+            converted[i] = parseDValue(svalues[i].c_str(), acceptEuroDecimal);
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            if (indices[i] != -1)
+                values[i] = converted[indices[i]];
+        }
+    }
+
+    return values;
+}
+
+vector<int> ColumnW::_levelIndices(vector<string> &svalues)
+{
+    // for each row of a TEXT column with levels, the index of its svalue()
+    // in `svalues`, or -1 if it's missing
+
+    ColumnStruct *s = struc();
+    Level *levels = _mm->resolve(s->levels);
+    unordered_map<int, int> indexOf;
+    bool dense = true;
+
+    svalues.clear();
+
+    for (int i = 0; i < s->levelsUsed; i++)
+    {
+        Level &level = levels[i];
+        const char *importValue = _mm->resolve(level.importValue);
+        if (importValue[0] != '\0')
+            svalues.push_back(importValue);
+        else
+            svalues.push_back(_mm->resolve(level.label));
+
+        // where there are duplicates, getImportValue() takes the first
+        indexOf.emplace(level.value, i);
+        dense = dense && (level.value == i);
+    }
+
+    vector<int> indices = _rawValues<int>();
+
+    for (int &value : indices)
+    {
+        if (value == INT_MIN)
+        {
+            value = -1;
+        }
+        else if (dense && value >= 0 && value < (int)svalues.size())
+        {
+            // value is already the index
+        }
+        else
+        {
+            auto itr = indexOf.find(value);
+            if (itr == indexOf.end())
+            {
+                stringstream ss;
+                ss << "level " << value << " not found";
+                throw runtime_error(ss.str());
+            }
+            value = itr->second;
+        }
+    }
+
+    return indices;
+}
+
 void ColumnW::_discardScratchColumn()
 {
     DataSetW *ds = (DataSetW*)_parent;
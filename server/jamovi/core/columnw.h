@@ -10,8 +10,11 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 #include <cmath>
 #include <climits>
+#include <unordered_map>
 
 #include <cassert>
 
@@ -20,6 +23,7 @@ class DataSetW;
 class ColumnW : public Column
 {
     friend class DataSetW;
+    friend class CSVReader;
 public:
 
     ColumnW(DataSetW *parent = 0, MemoryMapW *mm = 0, ColumnStruct *rel = 0);
@@ -49,10 +53,38 @@ public:
     void setSValue(int rowIndex, const char *value, bool initing = false);
     void changeDMType(DataType::Type dataType, MeasureType::Type measureType);
     void setLevels(const std::vector<LevelData> &levels);
+
+    // replaces the levels with these, in this order, as clearLevels() and
+    // appendLevel() for each, and counts the rows of each. the levels of
+    // TEXT columns take their index as their value
+    void buildLevels(const std::vector<LevelData> &levels);
     void setMissingValues(const std::vector<MissingValue> &missingValues);
 
+    // sets each row to to[i], where the row's value in source is from[i];
+    // as setIValue(rowNo, value, true) or setDValue() for each row
+    void recode(ColumnW &source, const std::vector<int> &from, const std::vector<int> &to);
+    void recode(ColumnW &source, const std::vector<int> &from, const std::vector<double> &to);
+
+    // set the rows from start onwards, which are yet to be set (as when
+    // importing), a block at a time rather than a cell at a time
+    void setIValues(int start, const std::vector<int> &values);
+    void setDValues(int start, const std::vector<double> &values);
+
+    // as setIValues() with the value of the level whose label or import
+    // value matches, appending a level for each value which doesn't match
+    // one (NULLs are missing values). stops short, returning the number of
+    // values set, where the column comes to have more than maxLevels
+    // levels. for ID columns, as setSValue() for each row
+    int setSValues(int start, const std::vector<const char*> &values, int maxLevels);
+
     int changes() const;
 
+    // as Column::summary(), keeping the summary found in the column
+    ColumnSummary summary();
+
+    // finds the zones which are to be found again, and keeps them
+    void refreshZones();
+
     template<typename T> void setRowCount(size_t count)
     {
         _discardScratchColumn();
@@ -66,26 +98,239 @@ public:
         setRowCount<T>(cs->rowCount + 1);
 
         cs = _mm->resolve<ColumnStruct>(_rel);
-        int blockIndex = cs->rowCount * sizeof(T) / VALUES_SPACE;
-        Block **blocks = _mm->resolve<Block*>(cs->blocks);
-        Block *currentBlock = _mm->resolve<Block>(blocks[blockIndex]);
+        int rowIndex = cs->rowCount - 1;
+        _setCell(rowIndex, value);
 
-        int index = cs->rowCount % (VALUES_SPACE / sizeof(T));
-
-        T* p = (T*) &currentBlock->values[index * sizeof(T)];
-        *p = value;
+        _updateSummary(NAN, _summaryValue(value));
+        _updateZone(rowIndex, NAN, _summaryValue(value));
     }
 
 private:
 
     MemoryMapW *_mm;
-    static void _transferLevels(ColumnW &dest, ColumnW &src);
     void _discardScratchColumn();
 
+    struct NewLevel
+    {
+        int value;
+        std::string label;
+        std::string importValue;
+    };
+
+    // the levels and cells converted from the old column, to be written by
+    // _applyConversion(). for ID columns, ivalues are offsets into text
+    // (or -1 for empty cells)
+    struct Conversion
+    {
+        std::vector<NewLevel> levels;
+        std::vector<int> ivalues;
+        std::vector<double> dvalues;
+        std::string text;
+    };
+
+    // changeDMType() is in three steps, so DataSetW::changeDMTypes() can
+    // run the second for many columns at once. _beginChangeDMType() swaps
+    // the column's innards for the new ones (from the scratch column, or
+    // new innards where ! useScratch), leaving the old ones in old, and
+    // returns false where there's nothing to convert. _convert() only
+    // reads from the memory map, so it can run alongside other
+    // _convert()s, and _applyConversion() writes what it found
+    bool _beginChangeDMType(DataType::Type dataType, MeasureType::Type measureType, ColumnW &old, bool useScratch);
+    void _convert(ColumnW &src, Conversion &conversion);
+    void _applyConversion(Conversion &conversion);
+
+    // keeps the summary up to date as a cell changes from oldValue to
+    // newValue (NAN for missing), or marks it as to be found again
+    void _updateSummary(double oldValue, double newValue);
+    void _invalidateSummary();
+
+    // as _updateSummary() for the zone of the row's block. the zones of
+    // the rows [start, end) are marked as to be found again, or all of them
+    void _updateZone(int rowIndex, double oldValue, double newValue);
+    void _invalidateZones(int start, int end);
+    void _invalidateZones();
+    void _growZones(int oldCount, int count);
+    // int cells are written with _setInt(), which widens the cells (see
+    // _setIntSize()) where value doesn't fit
+    void _setInt(int rowIndex, int value);
+    void _setCell(int rowIndex, int value) { _setInt(rowIndex, value); }
+    template<typename T> void _setCell(int rowIndex, const T &value) { cellAt<T>(rowIndex) = value; }
+
+    // lays the int cells out in size bytes each, moving them where
+    // keepValues, otherwise leaving them to be written
+    void _setIntSize(int size, bool keepValues = true);
+
+    // the narrowest int cells for the values, and the column's levels
+    int _intSizeFor(const std::vector<int> &values);
+
+    // reserves an extent of at least count blocks for the column; as many
+    // as it already has (up to MAX_EXTENT_BLOCKS), so where columns grow
+    // together, each still has its blocks in long contiguous runs
+    void _reserveBlocks(int count);
+
+    static double _summaryValue(int value) { return value == INT_MIN ? NAN : value; }
+    static double _summaryValue(double value) { return value; }
+    static double _summaryValue(const char *value) { return value == NULL ? NAN : 0; }
+
+    // the conversion kernels used by _convert()
+    void _findLevels(ColumnW &src, std::vector<NewLevel> &levels);
+    void _convertToInteger(ColumnW &src, Conversion &conversion);
+    void _convertToDecimal(ColumnW &src, Conversion &conversion);
+    void _convertToText(ColumnW &src, Conversion &conversion);
+    void _convertToID(ColumnW &src, Conversion &conversion);
+    void _setLevelValues(const std::vector<int> &values, int start = 0);
+
+    // removes the levels where remove[i], in one pass of the levels (and
+    // of the cells, for TEXT columns)
+    void _removeLevels(const std::vector<bool> &remove);
+
+    std::vector<int> _ivalues();
+    std::vector<double> _dvalues(bool acceptEuroDecimal);
+    std::vector<int> _levelIndices(std::vector<std::string> &svalues);
+
+    template<typename T> std::vector<T> _rawValues()
+    {
+        // copies the cells out a block at a time, rather than resolving
+        // the block for each cell as cellAt() does
+        ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+        int count = cs->rowCount;
+        int perBlock = VALUES_SPACE / sizeof(T);
+
+        std::vector<T> values(count);
+
+        for (int i = 0, blockIndex = 0; i < count; i += perBlock, blockIndex++)
+        {
+            Block *block = _mm->resolve<Block>(blocks[blockIndex]);
+            int n = std::min(perBlock, count - i);
+            memcpy(&values[i], block->values, n * sizeof(T));
+        }
+
+        return values;
+    }
+
+    template<typename T> std::vector<T> _recodeValues(ColumnW &source, const std::vector<int> &from, const std::vector<T> &to, T missing)
+    {
+        // level values are usually compact, so a table indexed by the
+        // value serves as the lookup; otherwise a hash map
+        int count = source.rowCount();
+        std::vector<T> values(count, missing);
+
+        if (from.empty())
+            return values;
+
+        auto range = std::minmax_element(from.begin(), from.end());
+        int64_t min = *range.first;
+        int64_t span = (int64_t)*range.second - min + 1;
+
+        if (span <= 4 * (int64_t)from.size() + 1024)
+        {
+            std::vector<T> table(span, missing);
+            std::vector<char> present(span, false);
+            for (size_t i = 0; i < from.size(); i++)
+            {
+                table[from[i] - min] = to[i];
+                present[from[i] - min] = true;
+            }
+
+            source.forEachCell<int>(0, count, [&](int rowIndex, int value) {
+                int64_t index = value - min;
+                if (index >= 0 && index < span && present[index])
+                    values[rowIndex] = table[index];
+            });
+        }
+        else
+        {
+            std::unordered_map<int, T> map;
+            for (size_t i = 0; i < from.size(); i++)
+                map[from[i]] = to[i];
+
+            source.forEachCell<int>(0, count, [&](int rowIndex, int value) {
+                auto itr = map.find(value);
+                if (itr != map.end())
+                    values[rowIndex] = itr->second;
+            });
+        }
+
+        return values;
+    }
+
+    void _setRawValues(const std::vector<int> &values, int start = 0)
+    {
+        // the int cells are narrowed to fit where every row is set, or
+        // widened where the values don't fit
+        ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+        int count = std::min((int)values.size(), cs->rowCount - start);
+        bool all = (start == 0 && count == cs->rowCount);
+        int intSize = all ? _intSizeFor(values) : 0;
+
+        if ( ! all)
+        {
+            for (int i = 0; i < count && intSize < 4; i++)
+                intSize = std::max(intSize, intSizeFor(values[i]));
+        }
+
+        if (all || intSize > cs->intSize)
+            _setIntSize(intSize, ! all);
+
+        _invalidateSummary();
+
+        cs = _mm->resolve<ColumnStruct>(_rel);
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+        intSize = cs->intSize;
+
+        _invalidateZones(start, start + count);
+        int perBlock = VALUES_SPACE / intSize;
+
+        for (int i = 0; i < count; )
+        {
+            int rowNo = start + i;
+            int offset = rowNo % perBlock;
+            Block *block = _mm->resolve<Block>(blocks[rowNo / perBlock]);
+            int n = std::min(perBlock - offset, count - i);
+
+            if (intSize == sizeof(int))
+            {
+                memcpy(&block->values[offset * sizeof(int)], &values[i], n * sizeof(int));
+            }
+            else
+            {
+                for (int j = 0; j < n; j++)
+                    writeInt(block->values, intSize, offset + j, values[i + j]);
+            }
+
+            i += n;
+        }
+    }
+
+    template<typename T> void _setRawValues(const std::vector<T> &values, int start = 0)
+    {
+        // sets the rows from start onwards
+        _invalidateSummary();
+
+        ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+        Block **blocks = _mm->resolve<Block*>(cs->blocks);
+        int count = std::min((int)values.size(), cs->rowCount - start);
+
+        _invalidateZones(start, start + count);
+        int perBlock = VALUES_SPACE / sizeof(T);
+
+        for (int i = 0; i < count; )
+        {
+            int rowNo = start + i;
+            int offset = rowNo % perBlock;
+            Block *block = _mm->resolve<Block>(blocks[rowNo / perBlock]);
+            int n = std::min(perBlock - offset, count - i);
+            memcpy(&block->values[offset * sizeof(T)], &values[i], n * sizeof(T));
+            i += n;
+        }
+    }
+
     template<typename T> void _setRowCount(size_t count)
     {
         ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
-        int blocksRequired = count * sizeof(T) / VALUES_SPACE + 1;
+        size_t cellSize = std::is_same<T, int>::value ? cs->intSize : sizeof(T);
+        int blocksRequired = count * cellSize / VALUES_SPACE + 1;
 
         if (blocksRequired > cs->blockCapacity)
         {
@@ -103,16 +348,54 @@ private:
 
         for (int i = cs->blocksUsed; i < blocksRequired; i++)
         {
-            Block *block = _mm->allocateSize<Block>(BLOCK_SIZE);
+            if (cs->extentBlocks == 0)
+                _reserveBlocks(blocksRequired - i);
+
             cs = _mm->resolve<ColumnStruct>(_rel);
             Block **blocks = _mm->resolve<Block*>(cs->blocks);
-            blocks[i] = _mm->base(block);
+            Block *block = cs->extent;
+            blocks[i] = block;
+            cs->extent = (Block*)((char*)block + BLOCK_SIZE);
+            cs->extentBlocks--;
             cs->blocksUsed++;
         }
 
+        if (cs->blocksUsed > cs->zonesCapacity)
+        {
+            int newCapacity = std::max(2 * cs->zonesCapacity, cs->blocksUsed);
+            BlockZone *newZones = _mm->allocate<BlockZone>(newCapacity);
+            cs = _mm->resolve<ColumnStruct>(_rel);
+
+            if (cs->zonesCapacity > 0)
+                memcpy(newZones, _mm->resolve(cs->zones), cs->zonesCapacity * sizeof(BlockZone));
+
+            for (int i = cs->zonesCapacity; i < newCapacity; i++)
+            {
+                BlockZone &zone = newZones[i];
+                zone.min = NAN;
+                zone.max = NAN;
+                zone.missing = 0;
+                zone.valid = true;
+            }
+
+            cs->zones = _mm->base(newZones);
+            cs->zonesCapacity = newCapacity;
+        }
+
         int oldCount = cs->rowCount;
         cs->rowCount = count;
 
+        // new cells are missing, and leave the summary as it is
+        if ((int)count < oldCount)
+        {
+            _invalidateSummary();
+            _invalidateZones(count, oldCount);
+        }
+        else
+        {
+            _growZones(oldCount, count);
+        }
+
         if (dataType() == DataType::DECIMAL)
         {
             for (size_t i = oldCount; i < count; i++)
@@ -126,11 +409,36 @@ private:
         }
         else
         {
+            Block **blocks = _mm->resolve<Block*>(cs->blocks);
+            int intSize = cs->intSize;
+            int perBlock = VALUES_SPACE / intSize;
+
             for (size_t i = oldCount; i < count; i++)
-                cellAt<int>(i) = INT_MIN;
+                writeInt(_mm->resolve<Block>(blocks[i / perBlock])->values, intSize, i % perBlock, INT_MIN);
         }
     }
 
 };
 
+template<> inline std::vector<int> ColumnW::_rawValues<int>()
+{
+    // int cells may be narrower than an int
+    ColumnStruct *cs = _mm->resolve<ColumnStruct>(_rel);
+    Block **blocks = _mm->resolve<Block*>(cs->blocks);
+    int count = cs->rowCount;
+    int intSize = cs->intSize;
+    int perBlock = VALUES_SPACE / intSize;
+
+    std::vector<int> values(count);
+
+    for (int i = 0, blockIndex = 0; i < count; i += perBlock, blockIndex++)
+    {
+        Block *block = _mm->resolve<Block>(blocks[blockIndex]);
+        int n = std::min(perBlock, count - i);
+        readInts(block->values, intSize, 0, n, &values[i]);
+    }
+
+    return values;
+}
+
 #endif // COLUMNW_H
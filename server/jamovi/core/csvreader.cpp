@@ -0,0 +1,1156 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#include "csvreader.h"
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <unordered_map>
+#include <string_view>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+#include "boost/nowide/convert.hpp"
+
+using namespace std;
+using namespace boost;
+
+namespace
+{
+    // csv.field_size_limit()
+    const size_t FIELD_LIMIT = 131072;
+
+    // python limits the digits int() converts (sys.get_int_max_str_digits(),
+    // 4300 by default) where it has a limit at all, so longer numbers are
+    // left to python
+    const int MAX_INT_DIGITS = 4000;
+
+    const size_t CHUNK_SIZE = 1 << 20;
+    const int MAX_CHUNKS = 1024;
+
+    // the non-ascii characters python's int() and float() accept; white
+    // space, and the first (zero) digit of each run of decimal digits (as
+    // of unicode 14)
+
+    const uint32_t SPACES[] = {
+        0x85, 0xA0, 0x1680, 0x2000, 0x2001, 0x2002, 0x2003, 0x2004, 0x2005,
+        0x2006, 0x2007, 0x2008, 0x2009, 0x200A, 0x2028, 0x2029, 0x202F,
+        0x205F, 0x3000 };
+
+    const uint32_t ZEROS[] = {
+        0x660, 0x6F0, 0x7C0, 0x966, 0x9E6, 0xA66, 0xAE6, 0xB66, 0xBE6, 0xC66,
+        0xCE6, 0xD66, 0xDE6, 0xE50, 0xED0, 0xF20, 0x1040, 0x1090, 0x17E0,
+        0x1810, 0x1946, 0x19D0, 0x1A80, 0x1A90, 0x1B50, 0x1BB0, 0x1C40,
+        0x1C50, 0xA620, 0xA8D0, 0xA900, 0xA9D0, 0xA9F0, 0xAA50, 0xABF0,
+        0xFF10, 0x104A0, 0x10D30, 0x11066, 0x110F0, 0x11136, 0x111D0,
+        0x112F0, 0x11450, 0x114D0, 0x11650, 0x116C0, 0x11730, 0x118E0,
+        0x11950, 0x11C50, 0x11D50, 0x11DA0, 0x16A60, 0x16AC0, 0x16B50,
+        0x1D7CE, 0x1D7D8, 0x1D7E2, 0x1D7EC, 0x1D7F6, 0x1E140, 0x1E2F0,
+        0x1E950, 0x1FBF0 };
+
+    enum NumberType
+    {
+        INTEGER,        // int() produces an int32
+        LARGE_INTEGER,  // int() produces something larger
+        DECIMAL,        // int() fails, float() doesn't
+        NOT_A_NUMBER,
+        UNSUPPORTED,
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool isValidUTF8(const char *data, size_t size)
+    {
+        // as python's utf-8 decoder accepts it, and without NULs
+
+        const unsigned char *p = (const unsigned char*)data;
+        const unsigned char *end = p + size;
+
+        while (p < end)
+        {
+            if (end - p >= 8)
+            {
+                uint64_t word;
+                memcpy(&word, p, 8);
+                bool ascii = (word & 0x8080808080808080ULL) == 0;
+                bool nul = ((word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL) != 0;
+                if (ascii && ! nul)
+                {
+                    p += 8;
+                    continue;
+                }
+            }
+
+            unsigned char c = *p;
+
+            if (c < 0x80)
+            {
+                if (c == 0)
+                    return false;
+                p++;
+                continue;
+            }
+
+            int n;
+            uint32_t cp;
+            uint32_t min;
+
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                n = 1;
+                cp = c & 0x1F;
+                min = 0x80;
+            }
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                n = 2;
+                cp = c & 0x0F;
+                min = 0x800;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                n = 3;
+                cp = c & 0x07;
+                min = 0x10000;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (end - p <= n)
+                return false;
+
+            for (int k = 1; k <= n; k++)
+            {
+                unsigned char b = p[k];
+                if ((b & 0xC0) != 0x80)
+                    return false;
+                cp = (cp << 6) | (b & 0x3F);
+            }
+
+            if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+                return false;
+
+            p += n + 1;
+        }
+
+        return true;
+    }
+
+    bool toASCII(const char *value, size_t length, string &ascii)
+    {
+        // replaces non-ascii white space and digits with their ascii
+        // equivalents, as int() and float() do before parsing. returns
+        // false if value contains other non-ascii characters (and so
+        // isn't a number)
+
+        ascii.clear();
+
+        const unsigned char *p = (const unsigned char*)value;
+        const unsigned char *end = p + length;
+
+        while (p < end)
+        {
+            unsigned char c = *p;
+
+            if (c < 0x80)
+            {
+                ascii.push_back((char)c);
+                p++;
+                continue;
+            }
+
+            int n = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : 1;
+            if (end - p <= n)
+                return false;
+
+            uint32_t cp = c & (0x3F >> n);
+            for (int k = 1; k <= n; k++)
+                cp = (cp << 6) | (p[k] & 0x3F);
+            p += n + 1;
+
+            if (binary_search(std::begin(SPACES), std::end(SPACES), cp))
+            {
+                ascii.push_back(' ');
+                continue;
+            }
+
+            const uint32_t *zero = upper_bound(std::begin(ZEROS), std::end(ZEROS), cp);
+            if (zero == std::begin(ZEROS))
+                return false;
+            uint32_t digit = cp - *(zero - 1);
+            if (digit > 9)
+                return false;
+
+            ascii.push_back('0' + digit);
+        }
+
+        return true;
+    }
+
+    void strip(const char *&s, size_t &n)
+    {
+        while (n > 0 && isSpace(s[0]))
+        {
+            s++;
+            n--;
+        }
+        while (n > 0 && isSpace(s[n - 1]))
+            n--;
+    }
+
+    int copyDigits(const char *s, size_t n, size_t &i, string &out)
+    {
+        // digits, with (single) underscores between them
+        int count = 0;
+        while (i < n)
+        {
+            if (isDigit(s[i]))
+            {
+                out.push_back(s[i]);
+                count++;
+                i++;
+            }
+            else if (s[i] == '_' && count > 0 && i + 1 < n && isDigit(s[i + 1]))
+            {
+                i++;
+            }
+            else
+            {
+                break;
+            }
+        }
+        return count;
+    }
+
+    bool equalsIgnoreCase(const char *s, size_t n, const char *word)
+    {
+        if (strlen(word) != n)
+            return false;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (tolower((unsigned char)s[i]) != word[i])
+                return false;
+        }
+        return true;
+    }
+
+    NumberType parseInt(const char *s, size_t n, int &value)
+    {
+        // as int(), where s is ascii and stripped
+
+        size_t i = 0;
+        bool negative = false;
+        if (i < n && (s[i] == '+' || s[i] == '-'))
+        {
+            negative = s[i] == '-';
+            i++;
+        }
+
+        int64_t v = 0;
+        int digits = 0;
+
+        while (i < n)
+        {
+            char c = s[i];
+            if (isDigit(c))
+            {
+                if (v <= 2147483648LL)
+                    v = v * 10 + (c - '0');
+                digits++;
+                i++;
+            }
+            else if (c == '_' && digits > 0 && i + 1 < n && isDigit(s[i + 1]))
+            {
+                i++;
+            }
+            else
+            {
+                return NOT_A_NUMBER;
+            }
+        }
+
+        if (digits == 0)
+            return NOT_A_NUMBER;
+        if (digits > MAX_INT_DIGITS)
+            return UNSUPPORTED;
+
+        if (negative)
+            v = -v;
+        if (v < INT_MIN || v > INT_MAX)
+            return LARGE_INTEGER;
+
+        value = (int)v;
+        return INTEGER;
+    }
+
+    NumberType parseFloat(const char *s, size_t n, double &value, string &buffer)
+    {
+        // as float(), where s is ascii and stripped
+
+        size_t i = 0;
+        bool negative = false;
+        if (i < n && (s[i] == '+' || s[i] == '-'))
+        {
+            negative = s[i] == '-';
+            i++;
+        }
+
+        if (equalsIgnoreCase(s + i, n - i, "inf") || equalsIgnoreCase(s + i, n - i, "infinity"))
+        {
+            value = negative ? -INFINITY : INFINITY;
+            return DECIMAL;
+        }
+        else if (equalsIgnoreCase(s + i, n - i, "nan"))
+        {
+            value = negative ? -NAN : NAN;
+            return DECIMAL;
+        }
+
+        buffer.clear();
+        if (negative)
+            buffer.push_back('-');
+
+        int digits = copyDigits(s, n, i, buffer);
+        if (i < n && s[i] == '.')
+        {
+            buffer.push_back('.');
+            i++;
+            digits += copyDigits(s, n, i, buffer);
+        }
+        if (digits == 0)
+            return NOT_A_NUMBER;
+
+        if (i < n && (s[i] == 'e' || s[i] == 'E'))
+        {
+            buffer.push_back('e');
+            i++;
+            if (i < n && (s[i] == '+' || s[i] == '-'))
+                buffer.push_back(s[i++]);
+            if (copyDigits(s, n, i, buffer) == 0)
+                return NOT_A_NUMBER;
+        }
+
+        if (i != n)
+            return NOT_A_NUMBER;
+
+        const char *start = buffer.c_str();
+        char *end;
+        value = strtod(start, &end);
+
+        // strtod() follows the locale's decimal point
+        if (end != start + buffer.size())
+            return UNSUPPORTED;
+
+        return DECIMAL;
+    }
+
+    NumberType parseNumber(const char *value, size_t length, int &ivalue, double &dvalue, string &scratch, string &buffer)
+    {
+        // as int(), and then float() if that fails
+
+        const char *s = value;
+        size_t n = length;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if ((unsigned char)value[i] >= 0x80)
+            {
+                if ( ! toASCII(value, length, scratch))
+                    return NOT_A_NUMBER;
+                s = scratch.c_str();
+                n = scratch.size();
+                break;
+            }
+        }
+
+        strip(s, n);
+
+        NumberType type = parseInt(s, n, ivalue);
+        if (type != NOT_A_NUMBER)
+            return type;
+
+        return parseFloat(s, n, dvalue, buffer);
+    }
+
+    bool parseDecimal(const char *value, size_t length, double &dvalue, string &scratch, string &buffer)
+    {
+        // as float()
+
+        const char *s = value;
+        size_t n = length;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if ((unsigned char)value[i] >= 0x80)
+            {
+                if ( ! toASCII(value, length, scratch))
+                    return false;
+                s = scratch.c_str();
+                n = scratch.size();
+                break;
+            }
+        }
+
+        strip(s, n);
+
+        return parseFloat(s, n, dvalue, buffer) == DECIMAL;
+    }
+
+    bool parseEuroFloat(const char *value, size_t length, double &dvalue, string &buffer)
+    {
+        // as reader.py's euro_float_pattern, ^(-)?([0-9]*),([0-9]+)$,
+        // and _parse_euro_float()
+
+        size_t n = length;
+        if (n > 0 && value[n - 1] == '\n')  // $ matches before a final \n
+            n--;
+
+        buffer.clear();
+
+        size_t i = 0;
+        if (i < n && value[i] == '-')
+            buffer.push_back(value[i++]);
+        while (i < n && isDigit(value[i]))
+            buffer.push_back(value[i++]);
+        if (i == n || value[i] != ',')
+            return false;
+        buffer.push_back('.');
+        i++;
+        size_t fraction = i;
+        while (i < n && isDigit(value[i]))
+            buffer.push_back(value[i++]);
+        if (i == fraction || i != n)
+            return false;
+
+        char *end;
+        dvalue = strtod(buffer.c_str(), &end);
+        return end == buffer.c_str() + buffer.size();
+    }
+
+    class RecordParser
+    {
+    public:
+
+        // parses records as python's csv.reader() does (Modules/_csv.c),
+        // reading the file in universal newlines mode (as TextIOWrapper
+        // does), so \r\n and \r are read as \n
+
+        RecordParser(const char *data, size_t size, char delimiter, char quoteChar, bool skipInitialSpace)
+        {
+            _data = data;
+            _size = size;
+            _delimiter = delimiter;
+            _quoteChar = quoteChar;
+            _skipInitialSpace = skipInitialSpace;
+        }
+
+        // parses the record starting at pos, and advances pos to the start
+        // of the next. returns false if a field is longer than the field
+        // size limit (python raises an exception)
+        bool next(size_t &pos)
+        {
+            _buffer.clear();
+            _ends.clear();
+            _fieldStart = 0;
+            _state = START_RECORD;
+
+            const char *p = _data + pos;
+            const char *end = _data + _size;
+
+            while (true)
+            {
+                if (p == end)
+                {
+                    // the end of the file, in a quoted field
+                    saveField();
+                    break;
+                }
+
+                char c = *p++;
+                bool newline = false;
+
+                if (c == '\n')
+                {
+                    newline = true;
+                }
+                else if (c == '\r')
+                {
+                    c = '\n';
+                    newline = true;
+                    if (p != end && *p == '\n')
+                        p++;
+                }
+
+                if ( ! process(c))
+                    return false;
+
+                // the last line needn't end with a new line
+                if (newline || p == end)
+                {
+                    process(EOL);
+                    if (_state == START_RECORD)
+                        break;
+                }
+            }
+
+            pos = p - _data;
+            return true;
+        }
+
+        int fieldCount() const
+        {
+            return (int)_ends.size();
+        }
+
+        const char *field(int index, size_t &length) const
+        {
+            size_t start = (index == 0) ? 0 : _ends[index - 1];
+            length = _ends[index] - start;
+            return _buffer.data() + start;
+        }
+
+    private:
+
+        enum State
+        {
+            START_RECORD,
+            START_FIELD,
+            IN_FIELD,
+            IN_QUOTED_FIELD,
+            QUOTE_IN_QUOTED_FIELD,
+            EAT_CRNL,
+        };
+
+        static const int EOL = -1;
+
+        bool process(int c)
+        {
+            switch (_state)
+            {
+            case START_RECORD:
+                if (c == EOL)
+                    break;
+                if (c == '\n')
+                {
+                    _state = EAT_CRNL;
+                    break;
+                }
+                _state = START_FIELD;
+                // fall through
+            case START_FIELD:
+                if (c == '\n' || c == EOL)
+                {
+                    saveField();
+                    _state = (c == EOL) ? START_RECORD : EAT_CRNL;
+                }
+                else if (c == _quoteChar)
+                {
+                    _state = IN_QUOTED_FIELD;
+                }
+                else if (c == ' ' && _skipInitialSpace)
+                {
+                    ;
+                }
+                else if (c == _delimiter)
+                {
+                    saveField();
+                }
+                else
+                {
+                    if ( ! addChar(c))
+                        return false;
+                    _state = IN_FIELD;
+                }
+                break;
+            case IN_FIELD:
+                if (c == '\n' || c == EOL)
+                {
+                    saveField();
+                    _state = (c == EOL) ? START_RECORD : EAT_CRNL;
+                }
+                else if (c == _delimiter)
+                {
+                    saveField();
+                    _state = START_FIELD;
+                }
+                else if ( ! addChar(c))
+                {
+                    return false;
+                }
+                break;
+            case IN_QUOTED_FIELD:
+                if (c == EOL)
+                    ;
+                else if (c == _quoteChar)
+                    _state = QUOTE_IN_QUOTED_FIELD;
+                else if ( ! addChar(c))
+                    return false;
+                break;
+            case QUOTE_IN_QUOTED_FIELD:
+                if (c == _quoteChar)
+                {
+                    if ( ! addChar(c))
+                        return false;
+                    _state = IN_QUOTED_FIELD;
+                }
+                else if (c == _delimiter)
+                {
+                    saveField();
+                    _state = START_FIELD;
+                }
+                else if (c == '\n' || c == EOL)
+                {
+                    saveField();
+                    _state = (c == EOL) ? START_RECORD : EAT_CRNL;
+                }
+                else
+                {
+                    if ( ! addChar(c))
+                        return false;
+                    _state = IN_FIELD;
+                }
+                break;
+            case EAT_CRNL:
+                if (c == EOL)
+                    _state = START_RECORD;
+                break;
+            }
+
+            return true;
+        }
+
+        bool addChar(char c)
+        {
+            // the limit is in characters, which is no more than the bytes
+            if (_buffer.size() - _fieldStart >= FIELD_LIMIT)
+                return false;
+            _buffer.push_back(c);
+            return true;
+        }
+
+        void saveField()
+        {
+            _ends.push_back(_buffer.size());
+            _fieldStart = _buffer.size();
+        }
+
+        const char *_data;
+        size_t _size;
+        char _delimiter;
+        char _quoteChar;
+        bool _skipInitialSpace;
+
+        State _state;
+        string _buffer;
+        vector<size_t> _ends;
+        size_t _fieldStart;
+    };
+}
+
+CSVReader::CSVReader(const string &path, char delimiter, char quoteChar, bool skipInitialSpace, const char *missings)
+{
+#ifdef _WIN32
+    _file = new interprocess::file_mapping(nowide::widen(path).c_str(), interprocess::read_only);
+#else
+    _file = new interprocess::file_mapping(path.c_str(), interprocess::read_only);
+#endif
+
+    _region = new interprocess::mapped_region(*_file, interprocess::read_only);
+    _data = (const char*)_region->get_address();
+    _size = _region->get_size();
+
+    _delimiter = delimiter;
+    _quoteChar = quoteChar;
+    _skipInitialSpace = skipInitialSpace;
+    _missings = missings;
+    _rowCount = 0;
+    _progress = 0;
+}
+
+CSVReader::~CSVReader()
+{
+    delete _region;
+    delete _file;
+}
+
+const vector<string> &CSVReader::columnNames() const
+{
+    return _columnNames;
+}
+
+int CSVReader::rowCount() const
+{
+    return _rowCount;
+}
+
+const CSVReader::ColumnStats &CSVReader::columnStats(int index) const
+{
+    return _stats.at(index);
+}
+
+bool CSVReader::scan(ProgressCallback callback, void *context)
+{
+    size_t start = 0;
+    if (_size >= 3 && memcmp(_data, "\xEF\xBB\xBF", 3) == 0)  // utf-8-sig
+        start = 3;
+
+    if (start == _size)
+        return false;  // no header; python raises StopIteration
+
+    RecordParser parser(_data, _size, _delimiter, _quoteChar, _skipInitialSpace);
+
+    size_t headerEnd = start;
+    if ( ! parser.next(headerEnd))
+        return false;
+    if ( ! isValidUTF8(_data + start, headerEnd - start))
+        return false;
+
+    _columnNames.clear();
+    for (int i = 0; i < parser.fieldCount(); i++)
+    {
+        size_t length;
+        const char *name = parser.field(i, length);
+        _columnNames.push_back(string(name, length));
+    }
+    if (_columnNames.empty())
+        _columnNames.push_back("A");
+
+    // the chunks start at the first line after evenly spaced offsets, on
+    // the assumption that a record starts there (rather than a quoted field
+    // continuing). once they're parsed, any chunk where that was wrong is
+    // parsed again from where the previous chunk actually stopped
+
+    int nChunks = (int)max((size_t)1, min(_size / CHUNK_SIZE, (size_t)MAX_CHUNKS));
+    _chunks.assign(nChunks, Chunk());
+
+    for (int i = 0; i < nChunks; i++)
+    {
+        size_t pos = max(headerEnd, _size / nChunks * i);
+        if (i > 0 && pos > headerEnd)
+        {
+            const char *p = _data + pos;
+            const char *end = _data + _size;
+            while (p != end && *p != '\n' && *p != '\r')
+                p++;
+            if (p != end && *p++ == '\r' && p != end && *p == '\n')
+                p++;
+            pos = p - _data;
+        }
+        if (i > 0)
+            pos = max(pos, _chunks[i - 1].start);
+        _chunks[i].start = pos;
+    }
+
+    for (int i = 0; i < nChunks; i++)
+        _chunks[i].end = (i == nChunks - 1) ? _size : _chunks[i + 1].start;
+
+    _progress = 0;
+    _run(nChunks, [&](int i) {
+        Chunk &chunk = _chunks[i];
+        _scanChunk(chunk);
+        _progress += chunk.end - chunk.start;
+    }, callback, context);
+
+    size_t prevStop = headerEnd;
+    int64_t rowOffset = 0;
+    int64_t rowCount = 0;
+
+    _stats.assign(_columnNames.size(), ColumnStats());
+
+    for (Chunk &chunk : _chunks)
+    {
+        if (chunk.start != prevStop)
+        {
+            chunk.start = prevStop;
+            _scanChunk(chunk);
+        }
+
+        if (chunk.unsupported)
+            return false;
+
+        prevStop = chunk.stop;
+
+        chunk.rowOffset = rowOffset;
+        if (chunk.lastNotEmpty != -1)
+            rowCount = rowOffset + chunk.lastNotEmpty + 1;
+        rowOffset += chunk.recordCount;
+
+        // merged in order, because the euro floats' dps depend on it
+        for (size_t i = 0; i < _stats.size(); i++)
+        {
+            ColumnStats &stats = _stats[i];
+            ColumnStats &chunkStats = chunk.stats[i];
+
+            stats.isEmpty = stats.isEmpty && chunkStats.isEmpty;
+            stats.onlyIntegers = stats.onlyIntegers && chunkStats.onlyIntegers;
+            stats.onlyFloats = stats.onlyFloats && chunkStats.onlyFloats;
+            stats.dps = max(stats.dps, chunkStats.dps);
+            if (stats.onlyEuroFloats)
+                stats.dps = max(stats.dps, chunk.euroDps[i]);
+            stats.onlyEuroFloats = stats.onlyEuroFloats && chunkStats.onlyEuroFloats;
+
+            if ( ! stats.manyUniques)
+            {
+                for (const string &value : chunkStats.uniqueValues)
+                {
+                    stats.uniqueValues.insert(value);
+                    if (stats.uniqueValues.size() > 49)
+                    {
+                        stats.manyUniques = true;
+                        break;
+                    }
+                }
+                if (chunkStats.manyUniques)
+                    stats.manyUniques = true;
+            }
+        }
+
+        chunk.stats.clear();
+        chunk.euroDps.clear();
+    }
+
+    if (rowCount >= INT_MAX)
+        return false;
+
+    _rowCount = (int)rowCount;
+
+    return true;
+}
+
+void CSVReader::_scanChunk(Chunk &chunk)
+{
+    // as reader.ColumnReader's examine_row() for each record
+
+    int columnCount = (int)_columnNames.size();
+
+    chunk.stats.assign(columnCount, ColumnStats());
+    chunk.euroDps.assign(columnCount, 0);
+    chunk.recordCount = 0;
+    chunk.lastNotEmpty = -1;
+    chunk.unsupported = false;
+
+    RecordParser parser(_data, _size, _delimiter, _quoteChar, _skipInitialSpace);
+    string scratch;
+    string buffer;
+    int ivalue;
+    double dvalue;
+
+    size_t pos = chunk.start;
+
+    while (pos < chunk.end)
+    {
+        if ( ! parser.next(pos))
+        {
+            chunk.unsupported = true;
+            return;
+        }
+
+        bool empty = true;
+        int n = min(columnCount, parser.fieldCount());
+
+        for (int i = 0; i < n; i++)
+        {
+            size_t length;
+            const char *value = parser.field(i, length);
+
+            if (length == 0 ||
+                (length == 1 && value[0] == ' ') ||
+                (length == _missings.size() && memcmp(value, _missings.data(), length) == 0))
+                continue;
+
+            empty = false;
+
+            ColumnStats &stats = chunk.stats[i];
+            stats.isEmpty = false;
+
+            if ( ! stats.manyUniques)
+            {
+                if (stats.uniqueValues.emplace(value, length).second &&
+                        stats.uniqueValues.size() > 49)
+                    stats.manyUniques = true;
+            }
+
+            switch (parseNumber(value, length, ivalue, dvalue, scratch, buffer))
+            {
+            case INTEGER:
+                break;
+            case LARGE_INTEGER:
+                stats.onlyIntegers = false;
+                break;
+            case DECIMAL:
+                // the dps are always determined, in case the column is
+                // changed to continuous later
+                stats.onlyIntegers = false;
+                stats.dps = max(stats.dps, Column::calcDPs(dvalue));
+                stats.onlyEuroFloats = false;
+                break;
+            case NOT_A_NUMBER:
+                stats.onlyIntegers = false;
+                stats.onlyFloats = false;
+                if (stats.onlyEuroFloats && parseEuroFloat(value, length, dvalue, buffer))
+                    chunk.euroDps[i] = max(chunk.euroDps[i], Column::calcDPs(dvalue));
+                else
+                    stats.onlyEuroFloats = false;
+                break;
+            case UNSUPPORTED:
+                chunk.unsupported = true;
+                return;
+            }
+        }
+
+        if ( ! empty)
+            chunk.lastNotEmpty = chunk.recordCount;
+        chunk.recordCount++;
+    }
+
+    chunk.stop = pos;
+
+    if ( ! isValidUTF8(_data + chunk.start, chunk.stop - chunk.start))
+        chunk.unsupported = true;
+}
+
+void CSVReader::read(DataSetW &dataset, const vector<int> &ids, ProgressCallback callback, void *context)
+{
+    // as reader.ColumnReader's parse_row() for each row
+
+    enum Kind { INTEGER_VALUES, DECIMAL_VALUES, LEVEL_INDICES, TEXT_VALUES };
+
+    class Buffer
+    {
+    public:
+        Kind kind;
+        bool euro;
+        vector<int> ivalues;
+        vector<double> dvalues;
+        vector<string> labels;
+        unordered_map<string_view, int> levelIndices;
+        vector<vector<char>> arenas;  // the text of each chunk
+    };
+
+    int columnCount = min((int)ids.size(), (int)_columnNames.size());
+    int nChunks = (int)_chunks.size();
+    vector<Buffer> buffers(columnCount);
+
+    for (int i = 0; i < columnCount; i++)
+    {
+        ColumnW column = dataset.getColumnById(ids[i]);
+        const ColumnStats &stats = _stats[i];
+        Buffer &buffer = buffers[i];
+
+        buffer.euro = stats.onlyEuroFloats && ! stats.onlyFloats;
+
+        if (column.dataType() == DataType::DECIMAL)
+        {
+            buffer.kind = DECIMAL_VALUES;
+            buffer.dvalues.assign(_rowCount, NAN);
+        }
+        else if (column.dataType() == DataType::TEXT && column.measureType() == MeasureType::ID)
+        {
+            buffer.kind = TEXT_VALUES;
+            buffer.ivalues.assign(_rowCount, -1);
+            buffer.arenas.resize(nChunks);
+        }
+        else if (column.dataType() == DataType::TEXT)
+        {
+            // the levels are the sorted unique values
+            buffer.kind = LEVEL_INDICES;
+            buffer.ivalues.assign(_rowCount, INT_MIN);
+            buffer.labels.assign(stats.uniqueValues.begin(), stats.uniqueValues.end());
+            sort(buffer.labels.begin(), buffer.labels.end());
+            for (size_t j = 0; j < buffer.labels.size(); j++)
+                buffer.levelIndices[buffer.labels[j]] = (int)j;
+        }
+        else
+        {
+            buffer.kind = INTEGER_VALUES;
+            buffer.ivalues.assign(_rowCount, INT_MIN);
+        }
+    }
+
+    _progress = 0;
+    _run(nChunks, [&](int chunkIndex) {
+
+        Chunk &chunk = _chunks[chunkIndex];
+        RecordParser parser(_data, _size, _delimiter, _quoteChar, _skipInitialSpace);
+        string scratch;
+        string buffer;
+        int ivalue;
+        double dvalue;
+
+        size_t pos = chunk.start;
+        int64_t rowNo = chunk.rowOffset;
+
+        while (pos < chunk.stop && rowNo < _rowCount)
+        {
+            parser.next(pos);
+
+            int n = min(columnCount, parser.fieldCount());
+
+            for (int i = 0; i < n; i++)
+            {
+                size_t length;
+                const char *value = parser.field(i, length);
+
+                if (length == 0 ||
+                    (length == 1 && value[0] == ' ') ||
+                    (length == _missings.size() && memcmp(value, _missings.data(), length) == 0))
+                    continue;
+
+                Buffer &b = buffers[i];
+
+                switch (b.kind)
+                {
+                case INTEGER_VALUES:
+                    if (parseNumber(value, length, ivalue, dvalue, scratch, buffer) == INTEGER)
+                        b.ivalues[rowNo] = ivalue;
+                    break;
+                case DECIMAL_VALUES:
+                    if (b.euro && parseEuroFloat(value, length, dvalue, buffer))
+                    {
+                        b.dvalues[rowNo] = dvalue;
+                    }
+                    else if (parseDecimal(value, length, dvalue, scratch, buffer))
+                    {
+                        b.dvalues[rowNo] = dvalue;
+                    }
+                    break;
+                case LEVEL_INDICES:
+                {
+                    auto itr = b.levelIndices.find(string_view(value, length));
+                    if (itr != b.levelIndices.end())
+                        b.ivalues[rowNo] = itr->second;
+                    break;
+                }
+                case TEXT_VALUES:
+                {
+                    vector<char> &arena = b.arenas[chunkIndex];
+                    b.ivalues[rowNo] = (int)arena.size();
+                    arena.insert(arena.end(), value, value + length);
+                    arena.push_back('\0');
+                    break;
+                }
+                }
+            }
+
+            rowNo++;
+        }
+
+        _progress += chunk.stop - chunk.start;
+
+    }, callback, context);
+
+    for (int i = 0; i < columnCount; i++)
+    {
+        ColumnW column = dataset.getColumnById(ids[i]);
+        Buffer &buffer = buffers[i];
+
+        column._discardScratchColumn();
+
+        if (buffer.kind == DECIMAL_VALUES)
+        {
+            column._setRawValues(buffer.dvalues);
+        }
+        else if (buffer.kind == TEXT_VALUES)
+        {
+            for (int c = 0; c < nChunks; c++)
+            {
+                const Chunk &chunk = _chunks[c];
+                const vector<char> &arena = buffer.arenas[c];
+                int64_t end = min((int64_t)_rowCount, chunk.rowOffset + chunk.recordCount);
+
+                for (int64_t rowNo = chunk.rowOffset; rowNo < end; rowNo++)
+                {
+                    int offset = buffer.ivalues[rowNo];
+                    if (offset != -1)
+                        column.setSValue((int)rowNo, &arena[offset], true);
+                }
+            }
+        }
+        else if (column.hasLevels())
+        {
+            // as setIValue() for each row
+            column._setLevelValues(buffer.ivalues);
+        }
+        else
+        {
+            column._setRawValues(buffer.ivalues);
+        }
+    }
+}
+
+void CSVReader::_run(int n, const function<void(int)> &task, ProgressCallback callback, void *context)
+{
+    // runs task(0) ... task(n - 1) on a thread for each core, reporting
+    // the progress (from this thread) as it goes
+
+    atomic<int> next(0);
+    int done = 0;
+    exception_ptr error;
+    mutex m;
+    condition_variable finished;
+
+    auto worker = [&]() {
+        int i;
+        while ((i = next++) < n)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(m);
+                if ( ! error)
+                    error = current_exception();
+            }
+
+            lock_guard<mutex> lock(m);
+            done++;
+            finished.notify_one();
+        }
+    };
+
+    int nThreads = max(1, min(n, (int)thread::hardware_concurrency()));
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.emplace_back(worker);
+
+    {
+        unique_lock<mutex> lock(m);
+        while (done < n)
+        {
+            finished.wait_for(lock, chrono::milliseconds(100));
+            if (callback != NULL)
+            {
+                float progress = (float)_progress / _size;
+                lock.unlock();
+                callback(context, progress);
+                lock.lock();
+            }
+        }
+    }
+
+    for (thread &t : threads)
+        t.join();
+
+    if (error)
+        rethrow_exception(error);
+}
@@ -0,0 +1,103 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "datasetw.h"
+
+class CSVReader
+{
+public:
+
+    // reads a csv file as formatio/csv.py and formatio/reader.py do (the
+    // dialect is that of python's csv module, with doublequote and
+    // QUOTE_MINIMAL), but parses the file a chunk at a time on several
+    // threads. scan() makes a first pass, determining the column names,
+    // the row count and what reader.ColumnReader needs to choose each
+    // column's type; read() makes the second, into the columns
+
+    typedef void (*ProgressCallback)(void *context, float progress);
+
+    class ColumnStats
+    {
+    public:
+
+        // as reader.ColumnReader's examine_row() leaves them
+
+        bool isEmpty = true;
+        bool onlyIntegers = true;
+        bool onlyFloats = true;
+        bool onlyEuroFloats = true;
+        bool manyUniques = false;
+        int dps = 0;
+        std::unordered_set<std::string> uniqueValues;
+    };
+
+    // the file must not be empty
+    CSVReader(const std::string &path, char delimiter, char quoteChar, bool skipInitialSpace, const char *missings);
+    ~CSVReader();
+
+    // returns false if the file contains something which python reads
+    // differently to this (invalid utf-8, NULs, overly long fields, etc.),
+    // in which case it needs to be read in python
+    bool scan(ProgressCallback callback, void *context);
+
+    // reads the cells into the columns with ids (in the order of the
+    // file's columns), which have been set up from the column stats
+    void read(DataSetW &dataset, const std::vector<int> &ids, ProgressCallback callback, void *context);
+
+    const std::vector<std::string> &columnNames() const;
+    int rowCount() const;
+    const ColumnStats &columnStats(int index) const;
+
+private:
+
+    class Chunk
+    {
+    public:
+        size_t start;
+        size_t end;             // where the next chunk (probably) starts
+        size_t stop;            // where this chunk's last record ends
+        int64_t recordCount;
+        int64_t lastNotEmpty;   // the last record with a value, or -1
+        int64_t rowOffset;
+        bool unsupported;
+        std::vector<ColumnStats> stats;
+        std::vector<int> euroDps;   // the dps of the euro floats preceding
+                                    // the first value which rules them out
+    };
+
+    void _scanChunk(Chunk &chunk);
+    void _run(int n, const std::function<void(int)> &task, ProgressCallback callback, void *context);
+
+    boost::interprocess::file_mapping *_file;
+    boost::interprocess::mapped_region *_region;
+    const char *_data;
+    size_t _size;
+
+    char _delimiter;
+    char _quoteChar;
+    bool _skipInitialSpace;
+    std::string _missings;
+
+    std::vector<std::string> _columnNames;
+    std::vector<ColumnStats> _stats;
+    std::vector<Chunk> _chunks;
+    int _rowCount;
+
+    std::atomic<int64_t> _progress;
+};
+
+#endif // CSVREADER_H
@@ -0,0 +1,404 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#include "csvwriter.h"
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    // the rows formatted by each task, and how many chunks can be formatted
+    // ahead of those written (for each thread)
+    const int CHUNK_ROWS = 8192;
+    const int CHUNKS_AHEAD = 2;
+
+    void writeAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            int written = _write(fd, data, (unsigned int)min(size, (size_t)1 << 20));
+#else
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            if (written <= 0)
+                throw runtime_error("Unable to write the file");
+            data += written;
+            size -= written;
+        }
+    }
+
+    /**
+     * Formats a double as python's str() does; the fewest digits which
+     * read back as the same value, positionally where the exponent is from
+     * -4 to 15 (with a .0 if there's no point), otherwise as 1.5e+16.
+     *
+     * @param buffer At least Column::FORMAT_BUFFER_SIZE chars.
+     * @return The length of the string written.
+     */
+    int formatDouble(char *buffer, double value)
+    {
+        char *out = buffer;
+
+        if (signbit(value))
+        {
+            *out++ = '-';
+            value = -value;
+        }
+
+        if (isinf(value))
+        {
+            memcpy(out, "inf", 4);
+            return out + 3 - buffer;
+        }
+
+        char sci[32];
+
+#ifdef __cpp_lib_to_chars
+        to_chars_result res = to_chars(sci, sci + sizeof(sci) - 1, value, chars_format::scientific);
+        *res.ptr = '\0';
+#else
+        // the shortest of 15, 16 or 17 significant digits which reads back
+        // the same. 15 digits rounded (with the trailing 0s removed) is the
+        // shortest, where fewer digits would do
+        for (int precision = 14; precision <= 16; precision++)
+        {
+            snprintf(sci, sizeof(sci), "%.*e", precision, value);
+            if (precision == 16 || strtod(sci, NULL) == value)
+                break;
+        }
+#endif
+
+        // sci is d[.ddd]e[+-]dd
+        char digits[32];
+        int nDigits = 0;
+        const char *c = sci;
+        for (; *c != 'e'; c++)
+        {
+            if (*c >= '0' && *c <= '9')
+                digits[nDigits++] = *c;
+        }
+        int exponent = atoi(c + 1);
+
+        while (nDigits > 1 && digits[nDigits - 1] == '0')
+            nDigits--;
+
+        int point = exponent + 1;  // the digits before the point
+
+        if (point <= -4 || point > 16)
+        {
+            *out++ = digits[0];
+            if (nDigits > 1)
+            {
+                *out++ = '.';
+                memcpy(out, &digits[1], nDigits - 1);
+                out += nDigits - 1;
+            }
+            out += snprintf(out, 8, "e%c%02d", exponent < 0 ? '-' : '+', abs(exponent));
+        }
+        else if (point <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = 0; i < -point; i++)
+                *out++ = '0';
+            memcpy(out, digits, nDigits);
+            out += nDigits;
+        }
+        else if (point >= nDigits)
+        {
+            memcpy(out, digits, nDigits);
+            out += nDigits;
+            for (int i = nDigits; i < point; i++)
+                *out++ = '0';
+            *out++ = '.';
+            *out++ = '0';
+        }
+        else
+        {
+            memcpy(out, digits, point);
+            out += point;
+            *out++ = '.';
+            memcpy(out, &digits[point], nDigits - point);
+            out += nDigits - point;
+        }
+
+        *out = '\0';
+        return out - buffer;
+    }
+}
+
+CSVWriter::CSVWriter(DataSet &dataset, const vector<int> &ids, const string &newline)
+    : _dataset(dataset),
+      _newline(newline)
+{
+    for (int id : ids)
+    {
+        Column column = dataset.getColumnById(id);
+
+        // the labels, quoted, as getLabel() would find them
+        unordered_map<int, string> labels;
+
+        if (column.dataType() == DataType::TEXT && column.measureType() != MeasureType::ID)
+        {
+            ColumnStruct *s = column.struc();
+            Level *levels = column._mm->resolve(s->levels);
+            for (int i = 0; i < s->levelsUsed; i++)
+            {
+                if (labels.find(levels[i].value) != labels.end())
+                    continue;
+                string label;
+                _appendText(label, column._mm->resolve(levels[i].label));
+                labels.emplace(levels[i].value, label);
+            }
+        }
+
+        _columns.push_back(column);
+        _labels.push_back(labels);
+    }
+}
+
+void CSVWriter::write(int fd, ProgressCallback callback, void *context)
+{
+    // the names are quoted, but their quotes aren't doubled
+    string header;
+
+    for (size_t i = 0; i < _columns.size(); i++)
+    {
+        if (i > 0)
+            header.push_back(',');
+        header.push_back('"');
+        for (const char *c = _columns[i].name(); *c != '\0'; c++)
+        {
+            if (*c == '\n')
+                header.append(_newline);
+            else
+                header.push_back(*c);
+        }
+        header.push_back('"');
+    }
+
+    header.append(_newline);
+
+    writeAll(fd, header.c_str(), header.size());
+
+    int rowCount = _dataset.rowCount();
+    int nChunks = (rowCount + CHUNK_ROWS - 1) / CHUNK_ROWS;
+
+    if (nChunks == 0)
+        return;
+
+    int nThreads = max(1, min(nChunks, (int)thread::hardware_concurrency()));
+    int ahead = nThreads * CHUNKS_AHEAD;
+
+    vector<string> chunks(nChunks);
+    vector<char> formatted(nChunks, false);
+    int next = 0;
+    int written = 0;
+    bool stop = false;
+    exception_ptr error;
+    mutex m;
+    condition_variable changed;
+
+    auto worker = [&]() {
+        while (true)
+        {
+            int i;
+
+            {
+                unique_lock<mutex> lock(m);
+                while ( ! stop && next < nChunks && next >= written + ahead)
+                    changed.wait(lock);
+                if (stop || next >= nChunks)
+                    return;
+                i = next++;
+            }
+
+            string chunk;
+
+            try
+            {
+                int rowStart = i * CHUNK_ROWS;
+                int rowEnd = min(rowCount, rowStart + CHUNK_ROWS);
+                _formatRows(rowStart, rowEnd, chunk);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(m);
+                if ( ! error)
+                    error = current_exception();
+                stop = true;
+                changed.notify_all();
+                return;
+            }
+
+            lock_guard<mutex> lock(m);
+            chunks[i] = std::move(chunk);
+            formatted[i] = true;
+            changed.notify_all();
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.emplace_back(worker);
+
+    // the chunks are written out in order, as they're formatted
+    try
+    {
+        for (int i = 0; i < nChunks; i++)
+        {
+            string chunk;
+
+            {
+                unique_lock<mutex> lock(m);
+                while ( ! formatted[i] && ! stop)
+                    changed.wait_for(lock, chrono::milliseconds(100));
+                if (stop)
+                    break;
+                chunk = std::move(chunks[i]);
+                written++;
+                changed.notify_all();
+            }
+
+            writeAll(fd, chunk.c_str(), chunk.size());
+
+            if (callback != NULL)
+                callback(context, (float)(i + 1) / nChunks);
+        }
+    }
+    catch (...)
+    {
+        lock_guard<mutex> lock(m);
+        if ( ! error)
+            error = current_exception();
+        stop = true;
+        changed.notify_all();
+    }
+
+    for (thread &t : threads)
+        t.join();
+
+    if (error)
+        rethrow_exception(error);
+}
+
+void CSVWriter::_formatRows(int rowStart, int rowEnd, string &out)
+{
+    vector<Cells> cells(_columns.size());
+    for (int i = 0; i < (int)_columns.size(); i++)
+        _formatCells(i, rowStart, rowEnd, cells[i]);
+
+    for (int rowNo = rowStart; rowNo < rowEnd; rowNo++)
+    {
+        if (_dataset.isRowFiltered(rowNo))
+            continue;
+
+        int index = rowNo - rowStart;
+
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            if (i > 0)
+                out.push_back(',');
+            Cells &c = cells[i];
+            size_t start = (index == 0) ? 0 : c.ends[index - 1];
+            out.append(c.text, start, c.ends[index] - start);
+        }
+
+        out.append(_newline);
+    }
+}
+
+void CSVWriter::_formatCells(int index, int rowStart, int rowEnd, Cells &cells)
+{
+    Column &column = _columns[index];
+    int count = rowEnd - rowStart;
+    char buffer[Column::FORMAT_BUFFER_SIZE];
+
+    cells.ends.reserve(count);
+
+    if (column.dataType() == DataType::INTEGER)
+    {
+        cells.text.reserve(count * 4);
+        column.forEachCell<int>(rowStart, count, [&](int, int value) {
+            if (value != INT_MIN)
+                cells.text.append(buffer, Column::formatIValue(buffer, value));
+            cells.ends.push_back(cells.text.size());
+        });
+    }
+    else if (column.dataType() == DataType::DECIMAL)
+    {
+        cells.text.reserve(count * 8);
+        column.forEachCell<double>(rowStart, count, [&](int, double value) {
+            if ( ! isnan(value))
+                cells.text.append(buffer, formatDouble(buffer, value));
+            cells.ends.push_back(cells.text.size());
+        });
+    }
+    else if (column.measureType() == MeasureType::ID)
+    {
+        column.forEachCell<char*>(rowStart, count, [&](int, char *value) {
+            if (value != NULL)
+                _appendText(cells.text, column._mm->resolve(value));
+            cells.ends.push_back(cells.text.size());
+        });
+    }
+    else
+    {
+        const unordered_map<int, string> &labels = _labels[index];
+        column.forEachCell<int>(rowStart, count, [&](int, int value) {
+            if (value != INT_MIN)
+            {
+                auto itr = labels.find(value);
+                if (itr != labels.end())
+                    cells.text.append(itr->second);
+                else
+                    _appendText(cells.text, column.getLabel(value));  // throws
+            }
+            cells.ends.push_back(cells.text.size());
+        });
+    }
+}
+
+void CSVWriter::_appendText(string &out, const char *value)
+{
+    // quoted, with the quotes doubled; empty text isn't quoted
+    if (value[0] == '\0')
+        return;
+
+    out.push_back('"');
+    for (const char *c = value; *c != '\0'; c++)
+    {
+        if (*c == '"')
+            out.append("\"\"");
+        else if (*c == '\n')
+            out.append(_newline);
+        else
+            out.push_back(*c);
+    }
+    out.push_back('"');
+}
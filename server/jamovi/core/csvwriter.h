@@ -0,0 +1,53 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "dataset.h"
+#include "column.h"
+
+class CSVWriter
+{
+public:
+
+    // writes columns to a csv file as formatio/csv.py's write() did; the
+    // column names quoted, then a line for each row which isn't filtered,
+    // with numbers formatted as python's str() formats them, and text
+    // (level labels for levels) quoted. the rows are formatted a chunk at
+    // a time on several threads, and written out in order
+
+    typedef void (*ProgressCallback)(void *context, float progress);
+
+    // the columns with ids, in that order. newline is written at the end
+    // of each line, and in place of the \n's in the text
+    CSVWriter(DataSet &dataset, const std::vector<int> &ids, const std::string &newline);
+
+    // fd must be open for writing
+    void write(int fd, ProgressCallback callback, void *context);
+
+private:
+
+    class Cells
+    {
+    public:
+        std::string text;
+        std::vector<size_t> ends;   // where each cell ends in text
+    };
+
+    void _formatRows(int rowStart, int rowEnd, std::string &out);
+    void _formatCells(int index, int rowStart, int rowEnd, Cells &cells);
+    void _appendText(std::string &out, const char *value);
+
+    DataSet &_dataset;
+    std::vector<Column> _columns;
+    std::vector<std::unordered_map<int, std::string>> _labels;
+    std::string _newline;
+};
+
+#endif // CSVWRITER_H
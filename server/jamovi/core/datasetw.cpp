@@ -3,14 +3,76 @@
 //
 
 #include "datasetw.h"
+#include "columnview.h"
 
 #include <cstring>
 #include <climits>
 #include <stdexcept>
 #include <cmath>
+#include <cerrno>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+namespace
+{
+    const size_t CHUNK_SIZE = 1 << 20;
+
+    void writeAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            int written = _write(fd, data, (unsigned int)min(size, CHUNK_SIZE));
+#else
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            if (written <= 0)
+                throw runtime_error("Unable to write column data");
+            data += written;
+            size -= written;
+        }
+    }
+
+    void readAll(int fd, int64_t offset, char *data, size_t size)
+    {
+#ifdef _WIN32
+        if (_lseeki64(fd, offset, SEEK_SET) != offset)
+            throw runtime_error("Unable to read column data");
+#endif
+        while (size > 0)
+        {
+#ifdef _WIN32
+            int n = _read(fd, data, (unsigned int)min(size, CHUNK_SIZE));
+#else
+            ssize_t n = ::pread(fd, data, size, offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+#endif
+            if (n < 0)
+                throw runtime_error("Unable to read column data");
+            if (n == 0)
+                throw runtime_error("Column data is truncated");
+            data += n;
+            size -= n;
+            offset += n;
+        }
+    }
+}
+
 DataSetW *DataSetW::create(MemoryMapW *mm)
 {
     DataSetW *ds = new DataSetW(mm);
@@ -61,6 +123,145 @@ DataSetW::DataSetW(MemoryMapW *mm)
     _blank = false;
 }
 
+MemoryReport DataSetW::memoryUsage(vector<MemoryUsage> &columns)
+{
+    MemoryReport report;
+    MemoryUsage &total = report.total;
+    memset(&total, 0, sizeof(MemoryUsage));
+
+    DataSetStruct *dss = struc();
+
+    // the header, the data set struct and the array of its columns
+    total.directory += MM_START_OFFSET;
+    total.directory += MemoryMapW::padded(sizeof(DataSetStruct));
+    total.directory += MemoryMapW::padded((size_t)dss->capacity * sizeof(ColumnStruct*));
+    total.unused += (int64_t)(dss->capacity - dss->columnCount) * sizeof(ColumnStruct*);
+
+    columns.clear();
+
+    for (int i = 0; i < columnCount(); i++)
+    {
+        MemoryUsage usage;
+        memset(&usage, 0, sizeof(MemoryUsage));
+        addMemoryUsage(strucC(i), false, usage);
+        columns.push_back(usage);
+
+        total.blocks += usage.blocks;
+        total.levels += usage.levels;
+        total.strings += usage.strings;
+        total.formula += usage.formula;
+        total.directory += usage.directory;
+        total.unused += usage.unused;
+    }
+
+    // the filter indices, and the scratch column; the latter shares its
+    // name, description and formula with the column it was swapped with
+    addMemoryUsage(_mm->resolve(dss->indices), false, total);
+    if (dss->scratch != NULL)
+        addMemoryUsage(_mm->resolve(dss->scratch), true, total);
+    total.id = 0;
+
+    report.size = _mm->size();
+    report.used = _mm->used();
+    report.live = total.blocks + total.levels + total.strings + total.formula + total.directory;
+    report.orphaned = report.used - report.live;
+
+    return report;
+}
+
+void DataSetW::addMemoryUsage(ColumnStruct *column, bool innardsOnly, MemoryUsage &usage)
+{
+    ColumnStruct *cs = column;
+
+    usage.id = cs->id;
+    usage.directory += MemoryMapW::padded(sizeof(ColumnStruct));
+
+    // the blocks, and the arrays of them and of their zones
+
+    usage.blocks += (int64_t)(cs->blocksUsed + cs->extentBlocks) * BLOCK_SIZE;
+    usage.unused += (int64_t)cs->extentBlocks * BLOCK_SIZE;
+
+    usage.directory += MemoryMapW::padded((size_t)cs->blockCapacity * sizeof(Block*));
+    usage.unused += (int64_t)(cs->blockCapacity - cs->blocksUsed) * sizeof(Block*);
+
+    if (cs->zonesCapacity > 0)
+    {
+        usage.directory += MemoryMapW::padded((size_t)cs->zonesCapacity * sizeof(BlockZone));
+        usage.unused += (int64_t)max(cs->zonesCapacity - cs->blocksUsed, 0) * sizeof(BlockZone);
+    }
+
+    // the levels. the text of each level is in allocations of capacity
+    // bytes (or packed into one allocation, with capacities adding up to
+    // its size; see ColumnW::buildLevels())
+
+    if (cs->levelsCapacity > 0)
+    {
+        usage.levels += MemoryMapW::padded((size_t)cs->levelsCapacity * sizeof(Level));
+        usage.unused += (int64_t)(cs->levelsCapacity - cs->levelsUsed) * sizeof(Level);
+
+        Level *levels = _mm->resolve(cs->levels);
+
+        for (int i = 0; i < cs->levelsUsed; i++)
+        {
+            Level &level = levels[i];
+            usage.strings += level.capacity + level.importCapacity;
+            usage.unused += level.capacity - (int64_t)strlen(_mm->resolve(level.label)) - 1;
+            usage.unused += level.importCapacity - (int64_t)strlen(_mm->resolve(level.importValue)) - 1;
+        }
+    }
+
+    // the missing values
+
+    if (cs->missingValuesCapacity > 0)
+    {
+        usage.directory += MemoryMapW::padded((size_t)cs->missingValuesCapacity * sizeof(MissingValue));
+        usage.unused += (int64_t)(cs->missingValuesCapacity - cs->missingValuesUsed) * sizeof(MissingValue);
+
+        MissingValue *missingValues = _mm->resolve(cs->missingValues);
+
+        for (int i = 0; i < cs->missingValuesUsed; i++)
+        {
+            if (missingValues[i].type == 0)
+                usage.strings += MemoryMapW::padded(strlen(_mm->resolve(missingValues[i].value.s)) + 1);
+        }
+    }
+
+    // the text of ID cells, each allocated separately
+
+    ColumnW wrapper(this, _mm, _mm->base(cs));
+
+    if (TypedColumnView<char*, ColumnKind::ID>::isKind(wrapper))
+    {
+        TypedColumnView<char*, ColumnKind::ID> view(wrapper);
+        view.forEach(0, view.rowCount(), [&](int, const char *value) {
+            if (value != NULL)
+                usage.strings += MemoryMapW::padded(strlen(value) + 1);
+        });
+    }
+
+    if (innardsOnly)
+        return;
+
+    const char *strings[] = { cs->name, cs->importName, cs->description };
+    for (const char *string : strings)
+    {
+        if (string != NULL)
+            usage.strings += MemoryMapW::padded(strlen(_mm->resolve(string)) + 1);
+    }
+
+    if (cs->formulaCapacity > 0)
+    {
+        usage.formula += cs->formulaCapacity;
+        usage.unused += cs->formulaCapacity - (int64_t)strlen(_mm->resolve(cs->formula)) - 1;
+    }
+
+    if (cs->formulaMessageCapacity > 0)
+    {
+        usage.formula += cs->formulaMessageCapacity;
+        usage.unused += cs->formulaMessageCapacity - (int64_t)strlen(_mm->resolve(cs->formulaMessage)) - 1;
+    }
+}
+
 void DataSetW::setEdited(bool edited)
 {
     _edited = edited;
@@ -214,6 +415,23 @@ void DataSetW::initColumn(MemoryMapW *mm, ColumnStruct *&columnp)
     column->missingValuesUsed = 0;
     column->missingValuesCapacity = 0;
 
+    column->summary.count = 0;
+    column->summary.min = NAN;
+    column->summary.max = NAN;
+    column->summary.sum = 0;
+    column->summary.sumSq = 0;
+    column->summary.dps = 0;
+    column->summary.valid = true;
+
+    column->zones = NULL;
+    column->zonesCapacity = 0;
+
+    // the int cells start narrow, and are widened as the values need
+    column->intSize = 1;
+
+    column->extent = NULL;
+    column->extentBlocks = 0;
+
     ColumnStruct *rel = mm->base(column);
     Block** blocks = mm->allocateBase<Block*>(column->blockCapacity);
 
@@ -350,6 +568,9 @@ void DataSetW::deleteRows(int delStart, int delEnd)
 
             column.setRowCount<int>(finalCount);
         }
+
+        // the rows moved only widened the zones
+        column._invalidateZones(delStart, finalCount);
     }
 
     dss->rowCount = finalCount;
@@ -478,6 +699,207 @@ ColumnW DataSetW::swapWithScratchColumn(ColumnW &column)
     return ColumnW(this, _mm, tmp);
 }
 
+ColumnW DataSetW::swapWithNewColumn(ColumnW &column)
+{
+    ColumnStruct *scratch = struc()->scratch;
+    struc()->scratch = NULL;
+
+    ColumnW old = swapWithScratchColumn(column);
+
+    struc()->scratch = scratch;
+    return old;
+}
+
+void DataSetW::restoreColumn(ColumnW &column, ColumnW &old)
+{
+    ColumnStruct *rel = column._rel;
+
+    ColumnStruct **columns = _mm->resolve(struc()->columns);
+    for (int i = 0; i < columnCount(); i++)
+    {
+        if (columns[i] == rel)
+        {
+            columns[i] = old._rel;
+            break;
+        }
+    }
+
+    if (struc()->scratch == old._rel)
+    {
+        // the new innards become the scratch column, but can't be returned to
+        struc()->scratch = rel;
+        _mm->resolve(rel)->id = -1;
+    }
+
+    column._rel = old._rel;
+}
+
+void DataSetW::changeDMTypes(const vector<ColumnChange> &changes, ProgressCallback callback, void *context)
+{
+    /*
+     * as with changeDMType() for each column in turn, only the first column
+     * can return to old innards held in the scratch column, and the scratch
+     * column is left with the old innards of the last. the old innards of
+     * the others need to stay as they are until they're converted, so
+     * these are swapped with new innards rather than the scratch column.
+     */
+
+    unordered_set<int> ids;
+    for (const ColumnChange &change : changes)
+    {
+        if ( ! ids.insert(change.id).second)
+            throw runtime_error("column changed more than once");
+    }
+
+    int first = 0;
+    ColumnStruct *scratch = struc()->scratch;
+
+    if ( ! changes.empty() && scratch != NULL && _mm->resolve(scratch)->id == changes[0].id)
+    {
+        const ColumnChange &change = changes[0];
+        getColumnById(change.id).changeDMType(change.dataType, change.measureType);
+        first = 1;
+    }
+    else if ( ! changes.empty() && scratch != NULL)
+    {
+        // the first column would take the scratch column's innards
+        _mm->resolve(scratch)->id = -1;
+    }
+
+    vector<ColumnW> columns;
+    vector<ColumnW> olds;
+    vector<char> converted;
+
+    // where a column can't be converted, it and the columns not yet
+    // converted are returned to their old innards before the error is
+    // passed on, so their values are as they were
+    auto restore = [&]() {
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            if ( ! converted[i])
+                restoreColumn(columns[i], olds[i]);
+        }
+    };
+
+    for (int i = first; i < (int)changes.size(); i++)
+    {
+        const ColumnChange &change = changes[i];
+        ColumnW column = getColumnById(change.id);
+        ColumnW old;
+        bool last = (i == (int)changes.size() - 1);
+
+        try
+        {
+            if (column._beginChangeDMType(change.dataType, change.measureType, old, last))
+            {
+                columns.push_back(column);
+                olds.push_back(old);
+                converted.push_back(false);
+            }
+        }
+        catch (...)
+        {
+            if (old._rel != NULL)
+                restoreColumn(column, old);
+            restore();
+            throw;
+        }
+    }
+
+    int n = columns.size();
+    int nThreads = max(1, min(n, (int)thread::hardware_concurrency()));
+
+    if (nThreads == 1)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            try
+            {
+                ColumnW::Conversion conversion;
+                columns[i]._convert(olds[i], conversion);
+                columns[i]._applyConversion(conversion);
+                converted[i] = true;
+            }
+            catch (...)
+            {
+                restore();
+                throw;
+            }
+
+            if (callback != NULL)
+                callback(context, (float)(first + i + 1) / (first + n));
+        }
+        return;
+    }
+
+    // the columns are converted on worker threads, each with an arena to
+    // write to the memory map from. the progress is reported from this
+    // thread, as the callback mightn't be callable from the others
+
+    atomic<int> next(0);
+    int done = 0;
+    exception_ptr error;
+    mutex m;
+    condition_variable finished;
+
+    auto worker = [&]() {
+        MemoryMapW::Arena arena(_mm);
+        int i;
+        while ((i = next++) < n)
+        {
+            try
+            {
+                ColumnW::Conversion conversion;
+                columns[i]._convert(olds[i], conversion);
+                columns[i]._applyConversion(conversion);
+                converted[i] = true;
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(m);
+                if ( ! error)
+                    error = current_exception();
+                next = n;
+            }
+
+            lock_guard<mutex> lock(m);
+            done++;
+            finished.notify_one();
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.emplace_back(worker);
+
+    {
+        unique_lock<mutex> lock(m);
+        int reported = 0;
+
+        while (reported < n && ! error)
+        {
+            finished.wait(lock, [&]() { return done > reported || error; });
+            reported = done;
+
+            if (callback != NULL && ! error)
+            {
+                lock.unlock();
+                callback(context, (float)(first + reported) / (first + n));
+                lock.lock();
+            }
+        }
+    }
+
+    for (thread &t : threads)
+        t.join();
+
+    if (error)
+    {
+        restore();
+        rethrow_exception(error);
+    }
+}
+
 void DataSetW::discardScratchColumn(int id)
 {
     ColumnStruct *scratch = struc()->scratch;
@@ -516,3 +938,197 @@ void DataSetW::setWeights(int id)
 {
     _mm->resolve<DataSetStruct>(_rel)->weights = id;
 }
+
+int64_t DataSetW::exportColumnData(int id, int rowStart, int rowCount, char *data, int stringsFd, int64_t stringsOffset)
+{
+    // copies the cells [rowStart, rowStart + rowCount) into data, a block
+    // at a time, as they are laid out in memory; int32s, or doubles for
+    // decimal columns (we only run little endian). ID columns write their
+    // text to stringsFd, nul terminated, and the cells become offsets into
+    // it. returns the new end of stringsFd
+
+    ColumnW column = getColumnById(id);
+
+    if (column.dataType() == DataType::DECIMAL)
+    {
+        column.forEachSpan<double>(rowStart, rowCount, [&](int, double *values, int n) {
+            memcpy(data, values, n * sizeof(double));
+            data += n * sizeof(double);
+        });
+    }
+    else if (column.dataType() == DataType::TEXT &&
+             column.measureType() == MeasureType::ID)
+    {
+        vector<char> strings;
+
+        column.forEachSpan<char*>(rowStart, rowCount, [&](int, char **values, int n) {
+            for (int i = 0; i < n; i++)
+            {
+                int offset = INT_MIN;
+                const char *value = (values[i] != NULL) ? _mm->resolve(values[i]) : "";
+
+                if (value[0] != '\0')
+                {
+                    if (stringsOffset > INT_MAX)
+                        throw runtime_error("Too much text to save");
+
+                    size_t size = strlen(value) + 1;
+                    offset = (int)stringsOffset;
+                    strings.insert(strings.end(), value, value + size);
+                    stringsOffset += size;
+                }
+
+                memcpy(data, &offset, sizeof(int));
+                data += sizeof(int);
+            }
+
+            if (strings.size() >= CHUNK_SIZE)
+            {
+                writeAll(stringsFd, &strings[0], strings.size());
+                strings.clear();
+            }
+        });
+
+        if ( ! strings.empty())
+            writeAll(stringsFd, &strings[0], strings.size());
+    }
+    else
+    {
+        column.forEachSpan<int>(rowStart, rowCount, [&](int, int *values, int n) {
+            memcpy(data, values, n * sizeof(int));
+            data += n * sizeof(int);
+        });
+    }
+
+    return stringsOffset;
+}
+
+void DataSetW::importColumnData(int id, int rowCount, int fd, int64_t offset, const char *strings, size_t stringsSize)
+{
+    // reads the cells of a whole column from fd, as exportColumnData()
+    // writes them. strings is the content of the strings table; when it's NULL, the cells of ID columns are ints, and
+    // are converted to text
+
+    ColumnW column = getColumnById(id);
+    column._discardScratchColumn();
+    column._invalidateSummary();
+    column._invalidateZones();
+
+    if (column.dataType() == DataType::DECIMAL)
+    {
+        column.forEachSpan<double>(0, rowCount, [&](int, double *values, int n) {
+            readAll(fd, offset, (char*)values, n * sizeof(double));
+            offset += n * sizeof(double);
+        });
+    }
+    else if (column.dataType() == DataType::TEXT &&
+             column.measureType() == MeasureType::ID)
+    {
+        // setSValue() allocates, which can move the blocks, so this
+        // can't read straight into them
+        vector<int> values(min(rowCount, (int)(CHUNK_SIZE / sizeof(int))));
+        char buffer[Column::FORMAT_BUFFER_SIZE];
+
+        for (int rowStart = 0; rowStart < rowCount; rowStart += values.size())
+        {
+            int n = min((int)values.size(), rowCount - rowStart);
+            readAll(fd, offset, (char*)&values[0], n * sizeof(int));
+            offset += n * sizeof(int);
+
+            for (int i = 0; i < n; i++)
+            {
+                int value = values[i];
+
+                if (value == INT_MIN)
+                {
+                    column.setSValue(rowStart + i, NULL, true);
+                }
+                else if (strings == NULL)
+                {
+                    Column::formatIValue(buffer, value);
+                    column.setSValue(rowStart + i, buffer, true);
+                }
+                else if (value < 0 || (size_t)value >= stringsSize)
+                {
+                    column.setSValue(rowStart + i, NULL, true);
+                }
+                else
+                {
+                    const char *start = strings + value;
+                    const char *end = (const char*)memchr(start, '\0', stringsSize - value);
+                    if (end == NULL)
+                        end = strings + stringsSize;
+                    string str(start, end);
+                    column.setSValue(rowStart + i, str.c_str(), true);
+                }
+            }
+        }
+    }
+    else if (column.hasLevels())
+    {
+        vector<int> values(rowCount);
+        if (rowCount > 0)
+            readAll(fd, offset, (char*)&values[0], rowCount * sizeof(int));
+
+        ColumnStruct *cs = column.struc();
+        Level *levels = _mm->resolve(cs->levels);
+        for (int i = 0; i < cs->levelsUsed; i++)
+        {
+            levels[i].count = 0;
+            levels[i].countExFiltered = 0;
+        }
+
+        column._setLevelValues(values);
+    }
+    else
+    {
+        // the cells can be narrower than the ints of the file
+        vector<int> values(rowCount);
+        if (rowCount > 0)
+            readAll(fd, offset, (char*)&values[0], rowCount * sizeof(int));
+
+        column._setRawValues(values);
+    }
+}
+
+bool DataSetW::evaluate(int id, const vector<Instruction> &program, bool isFilter)
+{
+    // the expression skips batches using the zones of the columns
+    for (const Instruction &instruction : program)
+    {
+        if (instruction.opCode == OpCode::COLUMN)
+            getColumnById((int)instruction.ivalue).refreshZones();
+    }
+
+    ColumnW column = getColumnById(id);
+    Expression expression(this, program);
+
+    if (column.dataType() == DataType::DECIMAL)
+    {
+        vector<double> values;
+        if ( ! expression.evaluate(column.rowCount(), isFilter, values))
+            return false;
+
+        // as setDValue()
+        column._discardScratchColumn();
+        column._setRawValues(values);
+    }
+    else if (column.dataType() == DataType::INTEGER)
+    {
+        vector<int> values;
+        if ( ! expression.evaluate(column.rowCount(), isFilter, values))
+            return false;
+
+        // as setIValue(rowNo, value, true)
+        if (column.hasLevels())
+            column._setLevelValues(values);
+        else
+            column._setRawValues(values);
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -6,17 +6,56 @@
 #define DATASETW_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #include "dataset.h"
 #include "memorymapw.h"
 #include "columnw.h"
+#include "expression.h"
 
 class ColumnW;
 
+// a change to the data and measure types of a column; as the arguments to
+// ColumnW::changeDMType()
+typedef struct
+{
+    int id;
+    DataType::Type dataType;
+    MeasureType::Type measureType;
+} ColumnChange;
+
+// the bytes of the memory map reachable from a column (or from the data
+// set, where id is 0), by what they're for. see DataSetW::memoryUsage()
+typedef struct
+{
+    int id;
+    int64_t blocks;     // the cells, and the blocks reserved for them
+    int64_t levels;     // the level arrays
+    int64_t strings;    // the text of the names, levels, ID cells and missing values
+    int64_t formula;    // the text of the formula and its message
+    int64_t directory;  // the structs, block arrays, zones and missing values
+    int64_t unused;     // of the above, the capacity which isn't in use
+} MemoryUsage;
+
+// size is the size of the memory map, and used the bytes allocated from
+// it. of these, live are reachable from the data set (total, by what
+// they're for), and the rest are orphaned
+typedef struct
+{
+    int64_t size;
+    int64_t used;
+    int64_t live;
+    int64_t orphaned;
+    MemoryUsage total;
+} MemoryReport;
+
 class DataSetW : public DataSet
 {
 public:
 
+    typedef void (*ProgressCallback)(void *context, float progress);
+
     static DataSetW *create(MemoryMapW *mm);
     static DataSetW *retrieve(MemoryMapW *mm);
 
@@ -39,18 +78,46 @@ public:
     void setWeights(int id);
 
     ColumnW swapWithScratchColumn(ColumnW &column);
+    // as swapWithScratchColumn(), with new innards, leaving the scratch
+    // column as it is
+    ColumnW swapWithNewColumn(ColumnW &column);
+    // swaps the column's innards back to old (from either of the above),
+    // where its values couldn't be converted to the new ones
+    void restoreColumn(ColumnW &column, ColumnW &old);
     void discardScratchColumn(int id);
 
+    // as changeDMType() for each of the columns. the new innards are all
+    // allocated first, then the columns are converted on a thread for
+    // each core, and written a round at a time. the progress is reported
+    // (from this thread) as each column is written
+    void changeDMTypes(const std::vector<ColumnChange> &changes, ProgressCallback callback = NULL, void *context = NULL);
+
+    // the bytes of the memory map in use, with those of each column. the
+    // map's allocations are never freed, so values replaced, arrays grown
+    // and columns deleted leave bytes orphaned, which are only reclaimed
+    // by rewriting the data set to a new map. this visits the cells of ID
+    // columns, so isn't for calling with every change
+    MemoryReport memoryUsage(std::vector<MemoryUsage> &columns);
+
     void setEdited(bool edited);
     bool isEdited() const;
 
     void setBlank(bool blank);
     bool isBlank() const;
 
+    // reading and writing the cells in the layout of an .omv data.bin
+    int64_t exportColumnData(int id, int rowStart, int rowCount, char *data, int stringsFd, int64_t stringsOffset);
+    void importColumnData(int id, int rowCount, int fd, int64_t offset, const char *strings, size_t stringsSize);
+
+    // evaluates a formula (see expression.h) into a column; returns false
+    // if it needs to be evaluated in python instead
+    bool evaluate(int id, const std::vector<Instruction> &program, bool isFilter);
+
 protected:
 
     DataSetW(MemoryMapW *memoryMap);
     static void initColumn(MemoryMapW *mm, ColumnStruct *&column);
+    void addMemoryUsage(ColumnStruct *column, bool innardsOnly, MemoryUsage &usage);
 
 private:
 
@@ -0,0 +1,1263 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#include "expression.h"
+
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+    // large enough for the row count of most data sets, small enough that
+    // the registers of a formula stay in the cache
+    const int BATCH_SIZE = 4096;
+
+    const int64_t MISSING = INT_MIN;
+
+    // python's integers don't overflow; keeping the integer registers
+    // within this magnitude means that the arithmetic on them can't either,
+    // and anything larger is left for python
+    const int64_t LIMIT = (int64_t)1 << 61;
+
+    // the largest magnitude at which doubles represent every integer
+    const int64_t EXACT_LIMIT = (int64_t)1 << 53;
+
+    bool isClose(double a, double b)
+    {
+        // math.isclose(a, b), with the default tolerances
+        if (a == b)
+            return true;
+        if (isinf(a) || isinf(b))
+            return false;
+        double diff = fabs(b - a);
+        return diff <= fabs(1e-9 * b) || diff <= fabs(1e-9 * a);
+    }
+
+    bool isOddInteger(double x)
+    {
+        return fmod(fabs(x), 2.0) == 1.0;
+    }
+
+    int compareMixed(int64_t a, double b, bool &bail)
+    {
+        // compares an integer with a double exactly, as python does
+        if (isinf(b))
+            return b > 0 ? -1 : 1;
+        if (a > EXACT_LIMIT || a < -EXACT_LIMIT)
+        {
+            bail = true;
+            return 0;
+        }
+        double d = (double)a;
+        return d < b ? -1 : (d > b ? 1 : 0);
+    }
+
+    bool fsum(const vector<double> &values, double &result)
+    {
+        // math.fsum(); a port of cpython's, which is exactly rounded.
+        // returns false where fsum() raises
+
+        vector<double> partials;
+        double specialSum = 0.0;
+        double infSum = 0.0;
+
+        for (double x : values)
+        {
+            double xsave = x;
+            size_t i = 0;
+
+            for (size_t j = 0; j < partials.size(); j++)
+            {
+                double y = partials[j];
+                if (fabs(x) < fabs(y))
+                    swap(x, y);
+                double hi = x + y;
+                double lo = y - (hi - x);
+                if (lo != 0.0)
+                    partials[i++] = lo;
+                x = hi;
+            }
+
+            partials.resize(i);
+
+            if (x != 0.0)
+            {
+                if ( ! isfinite(x))
+                {
+                    // intermediate overflow
+                    if (isfinite(xsave))
+                        return false;
+                    if (isinf(xsave))
+                        infSum += xsave;
+                    specialSum += xsave;
+                    partials.clear();
+                }
+                else
+                {
+                    partials.push_back(x);
+                }
+            }
+        }
+
+        if (specialSum != 0.0)
+        {
+            // -inf + inf
+            if (isnan(infSum))
+                return false;
+            result = specialSum;
+            return true;
+        }
+
+        double hi = 0.0;
+        double lo = 0.0;
+        size_t n = partials.size();
+
+        if (n > 0)
+        {
+            hi = partials[--n];
+
+            while (n > 0)
+            {
+                double x = hi;
+                double y = partials[--n];
+                hi = x + y;
+                lo = y - (hi - x);
+                if (lo != 0.0)
+                    break;
+            }
+
+            // make half-even rounding work across multiple partials
+            if (n > 0 && ((lo < 0.0 && partials[n - 1] < 0.0) ||
+                          (lo > 0.0 && partials[n - 1] > 0.0)))
+            {
+                double y = lo * 2.0;
+                double x = hi + y;
+                if (y == x - hi)
+                    hi = x;
+            }
+        }
+
+        result = hi;
+        return true;
+    }
+}
+
+Expression::Expression(DataSet *dataset, const vector<Instruction> &program)
+    : _program(program)
+{
+    _dataset = dataset;
+    _bail = false;
+    _registers.resize(program.size());
+    _bounds.resize(program.size());
+    _hasMissingValues.resize(program.size(), false);
+
+    for (size_t i = 0; i < program.size(); i++)
+    {
+        const Instruction &instruction = program[i];
+        Register &reg = _registers[i];
+        reg.dataType = instruction.dataType;
+        if (reg.dataType == DataType::DECIMAL)
+            reg.dvalues.resize(BATCH_SIZE);
+        else
+            reg.ivalues.resize(BATCH_SIZE);
+        reg.errors.resize(BATCH_SIZE);
+
+        if (instruction.opCode == OpCode::COLUMN)
+        {
+            Column column = _dataset->getColumnById((int)instruction.ivalue);
+            _hasMissingValues[i] = ( ! column.missingValues().empty());
+        }
+    }
+}
+
+bool Expression::evaluate(int rowCount, bool isFilter, vector<int> &values)
+{
+    values.resize(rowCount);
+
+    if (_program.empty())
+        return false;
+
+    const Register &result = _registers.back();
+
+    for (int rowStart = 0; rowStart < rowCount; rowStart += BATCH_SIZE)
+    {
+        int n = min(BATCH_SIZE, rowCount - rowStart);
+        if ( ! fold(rowStart, n))
+            run(rowStart, n);
+        if (_bail)
+            return false;
+
+        for (int k = 0; k < n; k++)
+        {
+            int64_t value;
+
+            if (result.errors[k])
+            {
+                value = isFilter ? 1 : MISSING;
+            }
+            else if (result.dataType == DataType::DECIMAL)
+            {
+                // convert(value, int)
+                double d = result.dvalues[k];
+                if ( ! isfinite(d))
+                    value = MISSING;
+                else if (fabs(d) >= 2147483649.0)
+                    return false;
+                else
+                    value = (int64_t)d;
+            }
+            else
+            {
+                value = result.ivalues[k];
+            }
+
+            // set_value() raises for these
+            if (value > INT_MAX || value < INT_MIN)
+                return false;
+
+            values[rowStart + k] = (int)value;
+        }
+    }
+
+    return true;
+}
+
+bool Expression::evaluate(int rowCount, bool isFilter, vector<double> &values)
+{
+    values.resize(rowCount);
+
+    if (_program.empty())
+        return false;
+
+    const Register &result = _registers.back();
+
+    for (int rowStart = 0; rowStart < rowCount; rowStart += BATCH_SIZE)
+    {
+        int n = min(BATCH_SIZE, rowCount - rowStart);
+        if ( ! fold(rowStart, n))
+            run(rowStart, n);
+        if (_bail)
+            return false;
+
+        for (int k = 0; k < n; k++)
+        {
+            double value;
+
+            if (result.errors[k])
+                value = isFilter ? 1 : NAN;
+            else
+                value = toDec(result, k);
+
+            values[rowStart + k] = value;
+        }
+    }
+
+    return true;
+}
+
+void Expression::run(int rowStart, int n)
+{
+    for (size_t i = 0; i < _program.size(); i++)
+    {
+        Register &reg = _registers[i];
+        fill(reg.errors.begin(), reg.errors.begin() + n, 0);
+        execute(i, reg, rowStart, n);
+        if (_bail)
+            return;
+    }
+}
+
+bool Expression::fold(int rowStart, int n)
+{
+    // where the zones of the columns show that a condition is the same
+    // for every row of the batch (i.e. `year == 2023` over blocks of other
+    // years), the result is filled in without running the batch
+
+    int op = _program.back().opCode;
+    if (op != OpCode::COMPARE &&
+        op != OpCode::AND &&
+        op != OpCode::OR &&
+        op != OpCode::NOT &&
+        op != OpCode::FILTER)
+        return false;
+
+    for (size_t i = 0; i < _program.size(); i++)
+        bound(i, _bounds[i], rowStart, n);
+
+    const Bounds &bounds = _bounds.back();
+    if ( ! bounds.known || bounds.missing || bounds.min != bounds.max)
+        return false;
+
+    Register &result = _registers.back();
+    fill(result.errors.begin(), result.errors.begin() + n, 0);
+
+    if (result.dataType == DataType::DECIMAL)
+        fill(result.dvalues.begin(), result.dvalues.begin() + n, bounds.min);
+    else
+        fill(result.ivalues.begin(), result.ivalues.begin() + n, (int64_t)bounds.min);
+
+    return true;
+}
+
+void Expression::bound(int index, Bounds &bounds, int rowStart, int n)
+{
+    // the bounds of the values of the instruction over the batch. errors
+    // are never known, so the instructions which produce them aren't
+    // bound, nor are the instructions which use them
+
+    const Instruction &instruction = _program[index];
+
+    bounds.known = false;
+    bounds.missing = true;
+    bounds.min = NAN;
+    bounds.max = NAN;
+
+    double value;
+
+    switch (instruction.opCode)
+    {
+    case OpCode::CONSTANT:
+        if (instruction.dataType == DataType::DECIMAL)
+        {
+            value = instruction.dvalue;
+            if (isnan(value))
+                return;
+        }
+        else
+        {
+            if (instruction.ivalue == MISSING ||
+                instruction.ivalue > EXACT_LIMIT ||
+                instruction.ivalue < -EXACT_LIMIT)
+                return;
+            value = (double)instruction.ivalue;
+        }
+        break;
+    case OpCode::COLUMN:
+    {
+        Column column = _dataset->getColumnById((int)instruction.ivalue);
+        BlockZone zone;
+
+        if (_hasMissingValues[index] && column.mayTreatAsMissing(rowStart, n))
+            return;
+        if (column.dataType() == DataType::DECIMAL && _registers[index].dataType != DataType::DECIMAL)
+            return;
+        if ( ! column.zoneRange(rowStart, n, zone) || isnan(zone.min))
+            return;
+
+        bounds.known = true;
+        bounds.missing = (zone.missing > 0);
+        bounds.min = zone.min;
+        bounds.max = zone.max;
+        return;
+    }
+    case OpCode::COMPARE:
+        boundCompare(instruction, bounds);
+        return;
+    case OpCode::NOT:
+    {
+        const Bounds &arg = _bounds[instruction.args[0]];
+        if ( ! arg.known || arg.missing)
+            return;
+        if (arg.min > 0 || arg.max < 0)
+            value = 0;
+        else if (arg.min == 0 && arg.max == 0)
+            value = 1;
+        else
+            return;
+        break;
+    }
+    case OpCode::AND:
+    case OpCode::OR:
+    {
+        // the arguments after one which stops the evaluation don't count
+        bool isAnd = (instruction.opCode == OpCode::AND);
+        value = isAnd ? 1 : 0;
+
+        for (int i : instruction.args)
+        {
+            const Bounds &arg = _bounds[i];
+            if ( ! arg.known || arg.missing)
+                return;
+
+            bool isTrue;
+            if (arg.min > 0 || arg.max < 0)
+                isTrue = true;
+            else if (arg.min == 0 && arg.max == 0)
+                isTrue = false;
+            else
+                return;
+
+            if (isTrue != isAnd)
+            {
+                value = isAnd ? 0 : 1;
+                break;
+            }
+        }
+        break;
+    }
+    case OpCode::FILTER:
+    {
+        // missing conditions are 0
+        const Bounds &arg = _bounds[instruction.args[0]];
+        if ( ! arg.known)
+            return;
+        if (arg.min == 0 && arg.max == 0)
+            value = 0;
+        else if ( ! arg.missing && arg.min == arg.max && fabs(arg.min) < (double)LIMIT)
+            value = (double)(int64_t)arg.min;
+        else
+            return;
+        break;
+    }
+    default:
+        return;
+    }
+
+    bounds.known = true;
+    bounds.missing = false;
+    bounds.min = value;
+    bounds.max = value;
+}
+
+void Expression::boundCompare(const Instruction &instruction, Bounds &bounds)
+{
+    // only single comparisons, which pass (or fail) for every value
+
+    if (instruction.params.size() != 1)
+        return;
+
+    const Bounds &a = _bounds[instruction.args[0]];
+    const Bounds &b = _bounds[instruction.args[1]];
+
+    if ( ! a.known || ! b.known)
+        return;
+
+    bool aDec = (_registers[instruction.args[0]].dataType == DataType::DECIMAL);
+    bool bDec = (_registers[instruction.args[1]].dataType == DataType::DECIMAL);
+    int comparison = instruction.params[0];
+    bool pass;
+
+    if (comparison == Comparison::EQ || comparison == Comparison::NOT_EQ)
+    {
+        if ( ! isfinite(a.min) || ! isfinite(a.max) || ! isfinite(b.min) || ! isfinite(b.max))
+            return;
+
+        // != compares with isclose() for integers too
+        bool exact = ( ! aDec && ! bDec && comparison == Comparison::EQ);
+        bool equal;
+
+        if (a.min == a.max && b.min == b.max)
+        {
+            equal = exact ? (a.min == b.min) : isClose(a.min, b.min);
+        }
+        else
+        {
+            // values within this of each other can be close
+            double largest = max(max(fabs(a.min), fabs(a.max)), max(fabs(b.min), fabs(b.max)));
+            double tolerance = exact ? 0 : 2e-9 * largest;
+
+            if (a.max + tolerance < b.min || b.max + tolerance < a.min)
+                equal = false;
+            else
+                return;
+        }
+
+        pass = (comparison == Comparison::EQ) ? equal : ! equal;
+    }
+    else
+    {
+        bool always;
+        bool never;
+
+        switch (comparison)
+        {
+        case Comparison::LT:
+            always = (a.max < b.min);
+            never = (a.min >= b.max);
+            break;
+        case Comparison::LT_E:
+            always = (a.max <= b.min);
+            never = (a.min > b.max);
+            break;
+        case Comparison::GT:
+            always = (a.min > b.max);
+            never = (a.max <= b.min);
+            break;
+        default:
+            always = (a.min >= b.max);
+            never = (a.max < b.min);
+            break;
+        }
+
+        if (always)
+            pass = true;
+        else if (never)
+            pass = false;
+        else
+            return;
+    }
+
+    bounds.known = true;
+    bounds.missing = (a.missing || b.missing);
+    bounds.min = pass ? 1 : 0;
+    bounds.max = bounds.min;
+}
+
+bool Expression::isMissing(const Register &reg, int k) const
+{
+    if (reg.dataType == DataType::DECIMAL)
+        return isnan(reg.dvalues[k]);
+    else
+        return reg.ivalues[k] == MISSING;
+}
+
+bool Expression::isTrue(const Register &reg, int k) const
+{
+    if (reg.dataType == DataType::DECIMAL)
+        return reg.dvalues[k] != 0.0;
+    else
+        return reg.ivalues[k] != 0;
+}
+
+int64_t Expression::toInt(const Register &reg, int k)
+{
+    // convert(value, int)
+    if (reg.dataType != DataType::DECIMAL)
+        return reg.ivalues[k];
+
+    double d = reg.dvalues[k];
+    if ( ! isfinite(d))
+        return MISSING;
+    if (fabs(d) >= (double)LIMIT)
+    {
+        _bail = true;
+        return MISSING;
+    }
+    return (int64_t)d;
+}
+
+double Expression::toDec(const Register &reg, int k) const
+{
+    // convert(value, float)
+    if (reg.dataType == DataType::DECIMAL)
+        return reg.dvalues[k];
+
+    int64_t i = reg.ivalues[k];
+    return i == MISSING ? NAN : (double)i;
+}
+
+void Expression::setInt(Register &reg, int k, int64_t value)
+{
+    if (reg.dataType == DataType::DECIMAL)
+    {
+        reg.dvalues[k] = (value == MISSING ? NAN : (double)value);
+    }
+    else
+    {
+        if (value > LIMIT || value < -LIMIT)
+            _bail = true;
+        reg.ivalues[k] = value;
+    }
+}
+
+void Expression::setDec(Register &reg, int k, double value)
+{
+    // the compiler only puts decimals in integer registers where
+    // they're missing
+    if (reg.dataType == DataType::DECIMAL)
+        reg.dvalues[k] = value;
+    else if (isnan(value))
+        reg.ivalues[k] = MISSING;
+    else
+        _bail = true;
+}
+
+void Expression::setMissing(Register &reg, int k)
+{
+    if (reg.dataType == DataType::DECIMAL)
+        reg.dvalues[k] = NAN;
+    else
+        reg.ivalues[k] = MISSING;
+}
+
+void Expression::setError(Register &reg, int k)
+{
+    reg.errors[k] = true;
+    setMissing(reg, k);
+}
+
+void Expression::copy(const Register &src, Register &dest, int k)
+{
+    if (src.dataType == DataType::DECIMAL)
+        setDec(dest, k, src.dvalues[k]);
+    else
+        setInt(dest, k, src.ivalues[k]);
+}
+
+void Expression::loadColumn(int index, Register &result, int rowStart, int n)
+{
+    const Instruction &instruction = _program[index];
+    Column column = _dataset->getColumnById((int)instruction.ivalue);
+
+    if (column.dataType() == DataType::DECIMAL)
+    {
+        column.forEachSpan<double>(rowStart, n, [&](int rowIndex, double *values, int count) {
+            for (int i = 0; i < count; i++)
+                setDec(result, rowIndex - rowStart + i, values[i]);
+        });
+    }
+    else
+    {
+        column.forEachSpan<int>(rowStart, n, [&](int rowIndex, int *values, int count) {
+            for (int i = 0; i < count; i++)
+                setInt(result, rowIndex - rowStart + i, values[i]);
+        });
+    }
+
+    if (_hasMissingValues[index] && column.mayTreatAsMissing(rowStart, n))
+    {
+        for (int k = 0; k < n; k++)
+        {
+            if (column.shouldTreatAsMissing(rowStart + k))
+                setMissing(result, k);
+        }
+    }
+}
+
+void Expression::compare(const Instruction &instruction, Register &result, int n)
+{
+    // a chain of comparisons, evaluated lazily (see nodes.Compare); the
+    // comparands after a failed comparison (or a missing value) aren't
+    // evaluated, so their errors don't count
+
+    for (int k = 0; k < n; k++)
+    {
+        const Register *a = &_registers[instruction.args[0]];
+
+        if (a->errors[k])
+        {
+            setError(result, k);
+            continue;
+        }
+
+        if (isMissing(*a, k))
+        {
+            setMissing(result, k);
+            continue;
+        }
+
+        int64_t value = 1;
+
+        for (size_t j = 0; j < instruction.params.size(); j++)
+        {
+            const Register *b = &_registers[instruction.args[j + 1]];
+
+            if (b->errors[k])
+            {
+                result.errors[k] = true;
+                value = MISSING;
+                break;
+            }
+
+            if (isMissing(*b, k))
+            {
+                value = MISSING;
+                break;
+            }
+
+            bool aDec = (a->dataType == DataType::DECIMAL);
+            bool bDec = (b->dataType == DataType::DECIMAL);
+            int comparison = instruction.params[j];
+            bool pass;
+
+            if (comparison == Comparison::EQ)
+            {
+                if (aDec || bDec)
+                    pass = isClose(toDec(*a, k), toDec(*b, k));
+                else
+                    pass = (a->ivalues[k] == b->ivalues[k]);
+            }
+            else if (comparison == Comparison::NOT_EQ)
+            {
+                pass = ! isClose(toDec(*a, k), toDec(*b, k));
+            }
+            else
+            {
+                int cmp;
+
+                if (aDec && bDec)
+                {
+                    double av = a->dvalues[k];
+                    double bv = b->dvalues[k];
+                    cmp = av < bv ? -1 : (av > bv ? 1 : 0);
+                }
+                else if (aDec)
+                {
+                    cmp = -compareMixed(b->ivalues[k], a->dvalues[k], _bail);
+                }
+                else if (bDec)
+                {
+                    cmp = compareMixed(a->ivalues[k], b->dvalues[k], _bail);
+                }
+                else
+                {
+                    int64_t av = a->ivalues[k];
+                    int64_t bv = b->ivalues[k];
+                    cmp = av < bv ? -1 : (av > bv ? 1 : 0);
+                }
+
+                switch (comparison)
+                {
+                case Comparison::LT:
+                    pass = (cmp < 0);
+                    break;
+                case Comparison::LT_E:
+                    pass = (cmp <= 0);
+                    break;
+                case Comparison::GT:
+                    pass = (cmp > 0);
+                    break;
+                default:
+                    pass = (cmp >= 0);
+                    break;
+                }
+            }
+
+            if ( ! pass)
+            {
+                value = 0;
+                break;
+            }
+
+            a = b;
+        }
+
+        setInt(result, k, value);
+    }
+}
+
+void Expression::boolOp(const Instruction &instruction, Register &result, int n)
+{
+    // and/or, which stop at the first false/true value (see nodes.BoolOp)
+
+    bool isAnd = (instruction.opCode == OpCode::AND);
+
+    for (int k = 0; k < n; k++)
+    {
+        int64_t value = isAnd ? 1 : 0;
+        bool error = false;
+
+        for (int arg : instruction.args)
+        {
+            const Register &reg = _registers[arg];
+
+            if (reg.errors[k])
+            {
+                error = true;
+                break;
+            }
+
+            if (isMissing(reg, k))
+            {
+                value = MISSING;
+                continue;
+            }
+
+            if (isTrue(reg, k) != isAnd)
+            {
+                value = isAnd ? 0 : 1;
+                break;
+            }
+        }
+
+        if (error)
+            setError(result, k);
+        else
+            setInt(result, k, value);
+    }
+}
+
+void Expression::execute(int index, Register &result, int rowStart, int n)
+{
+    const Instruction &instruction = _program[index];
+    int op = instruction.opCode;
+
+    switch (op)
+    {
+    case OpCode::CONSTANT:
+        for (int k = 0; k < n; k++)
+        {
+            if (result.dataType == DataType::DECIMAL)
+                result.dvalues[k] = instruction.dvalue;
+            else
+                setInt(result, k, instruction.ivalue);
+        }
+        return;
+    case OpCode::COLUMN:
+        loadColumn(index, result, rowStart, n);
+        return;
+    case OpCode::ROW:
+        for (int k = 0; k < n; k++)
+            setInt(result, k, rowStart + k + 1);
+        return;
+    case OpCode::COMPARE:
+        compare(instruction, result, n);
+        return;
+    case OpCode::AND:
+    case OpCode::OR:
+        boolOp(instruction, result, n);
+        return;
+    default:
+        break;
+    }
+
+    // the remaining operations evaluate all of their arguments, so any
+    // error among them is an error
+    for (int arg : instruction.args)
+    {
+        const Register &reg = _registers[arg];
+        for (int k = 0; k < n; k++)
+            result.errors[k] |= reg.errors[k];
+    }
+
+    bool isDec = (result.dataType == DataType::DECIMAL);
+
+    for (int k = 0; k < n; k++)
+    {
+        if (result.errors[k])
+        {
+            setMissing(result, k);
+            continue;
+        }
+
+        switch (op)
+        {
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::FLOOR_DIV:
+        case OpCode::MOD:
+        case OpCode::POW:
+        {
+            // both sides are converted to the type of the result
+            const Register &left = _registers[instruction.args[0]];
+            const Register &right = _registers[instruction.args[1]];
+
+            if (isMissing(left, k) || isMissing(right, k))
+            {
+                setMissing(result, k);
+                break;
+            }
+
+            if (isDec)
+            {
+                double a = toDec(left, k);
+                double b = toDec(right, k);
+
+                if (op == OpCode::ADD)
+                {
+                    setDec(result, k, a + b);
+                }
+                else if (op == OpCode::SUB)
+                {
+                    setDec(result, k, a - b);
+                }
+                else if (op == OpCode::MUL)
+                {
+                    setDec(result, k, a * b);
+                }
+                else if (op == OpCode::DIV)
+                {
+                    if (b == 0.0)
+                        setMissing(result, k);
+                    else
+                        setDec(result, k, a / b);
+                }
+                else if (op == OpCode::MOD)
+                {
+                    // python's %, which takes the sign of the divisor
+                    if (b == 0.0)
+                    {
+                        setError(result, k);
+                        break;
+                    }
+                    double mod = fmod(a, b);
+                    if (mod != 0.0)
+                    {
+                        if ((b < 0) != (mod < 0))
+                            mod += b;
+                    }
+                    else
+                    {
+                        mod = copysign(0.0, b);
+                    }
+                    setDec(result, k, mod);
+                }
+                else if (op == OpCode::POW)
+                {
+                    // python's float **
+                    if (b == 0.0 || a == 1.0)
+                    {
+                        setDec(result, k, 1.0);
+                    }
+                    else if (isinf(b))
+                    {
+                        double absA = fabs(a);
+                        if (absA == 1.0)
+                            setDec(result, k, 1.0);
+                        else if ((b > 0.0) == (absA > 1.0))
+                            setDec(result, k, INFINITY);
+                        else
+                            setDec(result, k, 0.0);
+                    }
+                    else if (isinf(a))
+                    {
+                        bool odd = isOddInteger(b);
+                        if (b > 0.0)
+                            setDec(result, k, odd ? a : fabs(a));
+                        else
+                            setDec(result, k, odd ? copysign(0.0, a) : 0.0);
+                    }
+                    else if (a == 0.0)
+                    {
+                        // 0 ** -n raises
+                        if (b < 0.0)
+                            setError(result, k);
+                        else
+                            setDec(result, k, isOddInteger(b) ? a : 0.0);
+                    }
+                    else if (a < 0.0 && b != floor(b))
+                    {
+                        // python produces a complex number, which is
+                        // missing to everything which consumes it
+                        setMissing(result, k);
+                    }
+                    else
+                    {
+                        bool negate = (a < 0.0 && isOddInteger(b));
+                        double value = pow(fabs(a), b);
+                        if (isinf(value))
+                            setError(result, k);  // overflow
+                        else
+                            setDec(result, k, negate ? -value : value);
+                    }
+                }
+            }
+            else
+            {
+                int64_t a = toInt(left, k);
+                int64_t b = toInt(right, k);
+
+                if (a == MISSING || b == MISSING)
+                {
+                    setMissing(result, k);
+                }
+                else if (op == OpCode::ADD)
+                {
+                    setInt(result, k, a + b);
+                }
+                else if (op == OpCode::SUB)
+                {
+                    setInt(result, k, a - b);
+                }
+                else if (op == OpCode::MUL)
+                {
+                    if (fabs((double)a * (double)b) >= (double)LIMIT)
+                        _bail = true;
+                    else
+                        setInt(result, k, a * b);
+                }
+                else if (op == OpCode::FLOOR_DIV)
+                {
+                    if (b == 0)
+                    {
+                        setMissing(result, k);
+                    }
+                    else
+                    {
+                        int64_t q = a / b;
+                        if (a % b != 0 && ((a < 0) != (b < 0)))
+                            q--;
+                        setInt(result, k, q);
+                    }
+                }
+                else if (op == OpCode::MOD)
+                {
+                    if (b == 0)
+                    {
+                        setError(result, k);
+                    }
+                    else
+                    {
+                        int64_t r = a % b;
+                        if (r != 0 && ((r < 0) != (b < 0)))
+                            r += b;
+                        setInt(result, k, r);
+                    }
+                }
+                else
+                {
+                    // DIV and POW always produce decimals
+                    _bail = true;
+                }
+            }
+            break;
+        }
+        case OpCode::NEGATE:
+        case OpCode::POSITIVE:
+        case OpCode::ABS:
+        {
+            const Register &reg = _registers[instruction.args[0]];
+
+            if (isMissing(reg, k))
+                setMissing(result, k);
+            else if (reg.dataType == DataType::DECIMAL && op == OpCode::NEGATE)
+                setDec(result, k, -reg.dvalues[k]);
+            else if (reg.dataType == DataType::DECIMAL && op == OpCode::ABS)
+                setDec(result, k, fabs(reg.dvalues[k]));
+            else if (op == OpCode::NEGATE)
+                setInt(result, k, -reg.ivalues[k]);
+            else if (op == OpCode::ABS)
+                setInt(result, k, llabs(reg.ivalues[k]));
+            else
+                copy(reg, result, k);
+            break;
+        }
+        case OpCode::NOT:
+        {
+            const Register &reg = _registers[instruction.args[0]];
+
+            if (isMissing(reg, k))
+                setMissing(result, k);
+            else
+                setInt(result, k, isTrue(reg, k) ? 0 : 1);
+            break;
+        }
+        case OpCode::INVERT:
+        {
+            const Register &reg = _registers[instruction.args[0]];
+
+            if (isMissing(reg, k))
+                setInt(result, k, 0);
+            else
+                copy(reg, result, k);
+            break;
+        }
+        case OpCode::IF:
+        {
+            // the condition is converted to an integer
+            int64_t cond = toInt(_registers[instruction.args[0]], k);
+
+            if (cond == MISSING)
+                setMissing(result, k);
+            else if (cond != 0)
+                copy(_registers[instruction.args[1]], result, k);
+            else
+                copy(_registers[instruction.args[2]], result, k);
+            break;
+        }
+        case OpCode::IF_MISSING:
+        {
+            if (isMissing(_registers[instruction.args[0]], k))
+                copy(_registers[instruction.args[1]], result, k);
+            else
+                copy(_registers[instruction.args[2]], result, k);
+            break;
+        }
+        case OpCode::RECODE:
+        {
+            // args are x, cond1, value1, cond2, value2, ..., [otherwise]
+            const std::vector<int> &args = instruction.args;
+            int chosen = -1;
+
+            for (size_t j = 1; j + 1 < args.size(); j += 2)
+            {
+                const Register &cond = _registers[args[j]];
+                if ( ! isMissing(cond, k) && isTrue(cond, k))
+                {
+                    chosen = args[j + 1];
+                    break;
+                }
+            }
+
+            if (chosen == -1)
+                chosen = (args.size() % 2 == 0) ? args.back() : args[0];
+
+            copy(_registers[chosen], result, k);
+            break;
+        }
+        case OpCode::FILTER:
+        {
+            int64_t cond = toInt(_registers[instruction.args[0]], k);
+            setInt(result, k, cond == MISSING ? 0 : cond);
+            break;
+        }
+        case OpCode::FILTER_VALUE:
+        {
+            bool pass = true;
+
+            for (size_t j = 1; j < instruction.args.size(); j++)
+            {
+                int64_t cond = toInt(_registers[instruction.args[j]], k);
+                if (cond == MISSING || cond == 0)
+                {
+                    pass = false;
+                    break;
+                }
+            }
+
+            if (pass)
+                copy(_registers[instruction.args[0]], result, k);
+            else
+                setMissing(result, k);
+            break;
+        }
+        case OpCode::ROUND:
+        case OpCode::FLOOR:
+        case OpCode::CEILING:
+        {
+            const Register &reg = _registers[instruction.args[0]];
+
+            if (isMissing(reg, k))
+            {
+                setMissing(result, k);
+            }
+            else if (reg.dataType != DataType::DECIMAL)
+            {
+                setInt(result, k, reg.ivalues[k]);
+            }
+            else if (op == OpCode::ROUND)
+            {
+                // round half to even, as python does
+                setDec(result, k, nearbyint(reg.dvalues[k]));
+            }
+            else
+            {
+                double d = reg.dvalues[k];
+
+                if (isinf(d))
+                {
+                    setError(result, k);
+                }
+                else
+                {
+                    d = (op == OpCode::FLOOR) ? floor(d) : ceil(d);
+                    if (fabs(d) >= (double)LIMIT)
+                        _bail = true;
+                    else
+                        setInt(result, k, (int64_t)d);
+                }
+            }
+            break;
+        }
+        case OpCode::EXP:
+        case OpCode::LN:
+        case OpCode::LOG10:
+        case OpCode::SQRT:
+        {
+            // the math module raises for values outside the domain, and
+            // for overflow, but lets nan through
+            double d = toDec(_registers[instruction.args[0]], k);
+            double value;
+
+            if (isnan(d))
+            {
+                setMissing(result, k);
+                break;
+            }
+
+            if (op == OpCode::EXP)
+            {
+                value = exp(d);
+                if (isinf(value) && ! isinf(d))
+                {
+                    setError(result, k);
+                    break;
+                }
+            }
+            else if (op == OpCode::SQRT)
+            {
+                if (d < 0.0)
+                {
+                    setError(result, k);
+                    break;
+                }
+                value = sqrt(d);
+            }
+            else
+            {
+                if (d <= 0.0)
+                {
+                    setError(result, k);
+                    break;
+                }
+                value = (op == OpCode::LN) ? log(d) : log10(d);
+            }
+
+            setDec(result, k, value);
+            break;
+        }
+        case OpCode::MIN:
+        case OpCode::MAX:
+        {
+            // the missing values are skipped; if there's nothing left,
+            // min() and max() raise
+            bool found = false;
+            double value = 0.0;
+
+            for (int arg : instruction.args)
+            {
+                double d = toDec(_registers[arg], k);
+                if (isnan(d))
+                    continue;
+                if ( ! found || (op == OpCode::MIN ? d < value : d > value))
+                    value = d;
+                found = true;
+            }
+
+            if (found)
+                setDec(result, k, value);
+            else
+                setError(result, k);
+            break;
+        }
+        case OpCode::SUM:
+        {
+            bool ignoreMissing = (instruction.params[0] != 0);
+            int minValid = instruction.params[1];
+            vector<double> values;
+            values.reserve(instruction.args.size());
+
+            for (int arg : instruction.args)
+            {
+                double d = toDec(_registers[arg], k);
+                if (isnan(d) && (ignoreMissing || minValid > 0))
+                    continue;
+                values.push_back(d);
+            }
+
+            double value;
+
+            if ((int)values.size() < minValid)
+                setMissing(result, k);
+            else if (fsum(values, value))
+                setDec(result, k, value);
+            else
+                setError(result, k);
+            break;
+        }
+        default:
+            // an instruction this doesn't know
+            _bail = true;
+            break;
+        }
+
+        if (_bail)
+            return;
+    }
+}
@@ -0,0 +1,154 @@
+//
+// Copyright (C) 2016 Jonathon Love
+//
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <vector>
+#include <cstdint>
+
+#include "dataset.h"
+#include "vartypes.h"
+
+namespace OpCode
+{
+    enum Type
+    {
+        CONSTANT = 0,
+        COLUMN = 1,
+        ROW = 2,
+
+        ADD = 10,
+        SUB = 11,
+        MUL = 12,
+        DIV = 13,
+        FLOOR_DIV = 14,
+        MOD = 15,
+        POW = 16,
+
+        NEGATE = 20,
+        POSITIVE = 21,
+        NOT = 22,
+        INVERT = 23,
+
+        COMPARE = 30,
+        AND = 31,
+        OR = 32,
+
+        IF = 40,
+        IF_MISSING = 41,
+        FILTER = 42,        // _FILTER(), the condition of a filter
+        FILTER_VALUE = 43,  // FILTER()
+        RECODE = 44,        // RECODE(), and the transforms
+
+        ABS = 50,
+        ROUND = 51,
+        FLOOR = 52,
+        CEILING = 53,
+        EXP = 54,
+        LN = 55,
+        LOG10 = 56,
+        SQRT = 57,
+        MIN = 58,
+        MAX = 59,
+        SUM = 60,
+    };
+}
+
+namespace Comparison
+{
+    enum Type
+    {
+        EQ = 0,
+        NOT_EQ = 1,
+        LT = 2,
+        LT_E = 3,
+        GT = 4,
+        GT_E = 5,
+    };
+}
+
+class Instruction
+{
+public:
+
+    // one step of a formula, as lowered by compute/compiler.py. each
+    // instruction produces one value per row, of dataType INTEGER or
+    // DECIMAL, and refers to the values of earlier instructions by their
+    // index in the program
+
+    int opCode;
+    int dataType;
+    std::vector<int> args;
+    std::vector<int> params;  // COMPARE: the comparisons
+                              // SUM: ignore_missing, min_valid
+    int64_t ivalue;           // CONSTANT (INTEGER), or the column id
+    double dvalue;            // CONSTANT (DECIMAL)
+};
+
+class Expression
+{
+public:
+
+    // evaluates a formula over whole columns, a batch of rows at a time,
+    // reproducing what compute/nodes.py produces a row at a time. where a
+    // row produces an error, it receives the value recalc() assigns to
+    // rows which raise an exception. evaluate() returns false if the
+    // formula can't be reproduced exactly (i.e. overflow), in which case
+    // it needs to be evaluated in python
+
+    Expression(DataSet *dataset, const std::vector<Instruction> &program);
+
+    bool evaluate(int rowCount, bool isFilter, std::vector<int> &values);
+    bool evaluate(int rowCount, bool isFilter, std::vector<double> &values);
+
+private:
+
+    class Register
+    {
+    public:
+        int dataType;
+        std::vector<int64_t> ivalues;
+        std::vector<double> dvalues;
+        std::vector<char> errors;
+    };
+
+    class Bounds
+    {
+    public:
+        bool known;     // false where nothing is known of the values
+        bool missing;   // whether any of the values can be missing
+        double min;     // of the values which aren't missing
+        double max;
+    };
+
+    void run(int rowStart, int n);
+    bool fold(int rowStart, int n);
+    void bound(int index, Bounds &bounds, int rowStart, int n);
+    void boundCompare(const Instruction &instruction, Bounds &bounds);
+    void execute(int index, Register &result, int rowStart, int n);
+
+    void loadColumn(int index, Register &result, int rowStart, int n);
+    void compare(const Instruction &instruction, Register &result, int n);
+    void boolOp(const Instruction &instruction, Register &result, int n);
+
+    bool isMissing(const Register &reg, int k) const;
+    bool isTrue(const Register &reg, int k) const;
+    int64_t toInt(const Register &reg, int k);
+    double toDec(const Register &reg, int k) const;
+    void setInt(Register &reg, int k, int64_t value);
+    void setDec(Register &reg, int k, double value);
+    void setMissing(Register &reg, int k);
+    void setError(Register &reg, int k);
+    void copy(const Register &src, Register &dest, int k);
+
+    DataSet *_dataset;
+    const std::vector<Instruction> &_program;
+    std::vector<Register> _registers;
+    std::vector<Bounds> _bounds;
+    std::vector<char> _hasMissingValues;
+    bool _bail;
+};
+
+#endif // EXPRESSION_H
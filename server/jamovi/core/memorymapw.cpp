@@ -5,10 +5,13 @@
 #include "memorymapw.h"
 
 #include <boost/nowide/fstream.hpp>
+#include <stdexcept>
 
 using namespace std;
 using namespace boost;
 
+thread_local MemoryMapW::Arena *MemoryMapW::_arena = NULL;
+
 MemoryMapW::MemoryMapW(const string &path, interprocess::file_mapping *file, interprocess::mapped_region *region)
     : MemoryMap(path, file, region)
 {
@@ -52,7 +55,11 @@ MemoryMapW *MemoryMapW::create(const string &path, unsigned long long size)
 
 void MemoryMapW::enlarge(int percent)
 {
-    flush();
+    // the pages written to stay in the page cache when the region is
+    // unmapped, and are written back from there, so there's no need to
+    // wait for them here. with a large map (or a slow disk) that's a
+    // stall of seconds. the writing back is only started
+    _region->flush(0, _region->get_size(), true);
 
     delete _region;
     delete _file;
@@ -87,6 +94,82 @@ void MemoryMapW::enlarge(int percent)
     _end = _start + _region->get_size();
 }
 
+void MemoryMapW::refill(Arena *arena, size_t size)
+{
+    // requests larger than a chunk are given just what they need, rather
+    // than leaving the rest of the chunk unused
+    size_t chunk = max(size, ARENA_CHUNK);
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        if (_cursor + chunk < _end)
+        {
+            arena->_cursor = _cursor - _start;
+            arena->_end = arena->_cursor + chunk;
+            _cursor += chunk;
+            return;
+        }
+    }
+
+    // enlarging moves the map, so waits until the other arenas are closed,
+    // or waiting here too. the arena is pinned again whether or not the
+    // map could be enlarged, as ~Arena() unpins it
+
+    _pins.unlock_shared();
+
+    try
+    {
+        unique_lock<shared_mutex> pins(_pins);
+        lock_guard<mutex> lock(_mutex);
+
+        while (_cursor + chunk >= _end)
+            enlarge();
+
+        arena->_cursor = _cursor - _start;
+        arena->_end = arena->_cursor + chunk;
+        _cursor += chunk;
+    }
+    catch (...)
+    {
+        _pins.lock_shared();
+        throw;
+    }
+
+    _pins.lock_shared();
+}
+
+MemoryMapW::Arena::Arena(MemoryMapW *mm)
+{
+    for (Arena *outer = _arena; outer != NULL; outer = outer->_outer)
+    {
+        if (outer->_mm == mm)
+            throw runtime_error("arena already open");
+    }
+
+    _mm = mm;
+    _outer = _arena;
+    _cursor = 0;
+    _end = 0;
+
+    _mm->_pins.lock_shared();
+    _arena = this;
+}
+
+MemoryMapW::Arena::~Arena()
+{
+    {
+        // the rest of the last chunk is returned, if nothing's been
+        // allocated after it
+        lock_guard<mutex> lock(_mm->_mutex);
+        if (_end != 0 && _mm->_cursor == _mm->_start + _end)
+            _mm->_cursor = _mm->_start + _cursor;
+    }
+
+    _mm->_pins.unlock_shared();
+    _arena = _outer;
+}
+
 void MemoryMapW::flush()
 {
     _region->flush(0, _region->get_size(), false);
@@ -7,27 +7,94 @@
 
 #include "memorymap.h"
 
+#include <mutex>
+#include <shared_mutex>
+
 class MemoryMapW : public MemoryMap {
 
 public:
+
+    /*
+     * an Arena lets a thread write to the memory map while other threads do
+     * too. while it's open, the thread's allocations are carved from chunks
+     * of the map set aside for it, and the map is only enlarged (which
+     * moves it) once the other threads with arenas have closed them, or are
+     * waiting to enlarge it too. as without an arena, pointers into the map
+     * are valid until the thread's next allocation. while arenas are open,
+     * the map should only be written to through them, and a thread
+     * shouldn't wait on another while it has one open
+     */
+    class Arena
+    {
+    public:
+        Arena(MemoryMapW *mm);
+        ~Arena();
+
+    private:
+        friend class MemoryMapW;
+
+        Arena(const Arena &); // prevent assignment
+        void operator=(const Arena &);
+
+        MemoryMapW *_mm;
+        Arena *_outer;
+        size_t _cursor;  // offsets, as the map can move
+        size_t _end;
+    };
+
     static MemoryMapW *create(const std::string &path, unsigned long long size);
     
     void enlarge(int percent = 50);
+
+    // writes the map back to its file, returning once it's written. this
+    // is for where the file needs to be durable (a save point); otherwise
+    // the writing back is left to the OS (see enlarge())
     void flush();
+
     void close();
     
-    template<class T> T *allocateSize(size_t size, size_t *allocated = 0)
-    {   
+    // the bytes of the map allocated, from its start (so including the
+    // header). the chunks set aside for open arenas count as allocated
+    size_t used() const
+    {
+        return _cursor - _start;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    // the bytes an allocation of size bytes takes
+    static size_t padded(size_t size)
+    {
         size_t padding = 8 - (size % 8);   // align at 8 bytes
         if (padding > 0 && padding < 8)
             size += padding;
+        return size;
+    }
+
+    template<class T> T *allocateSize(size_t size, size_t *allocated = 0)
+    {   
+        size = padded(size);
         
         if (allocated != NULL)
             *allocated = size;
         
         //std::cout << "allocating " << size << " bytes at " << (unsigned long long)(_cursor - _start) << "\n";
         //std::cout.flush();
-        
+
+        Arena *arena = _arena;
+        if (arena != NULL && arena->_mm == this)
+        {
+            if (arena->_cursor + size > arena->_end)
+                refill(arena, size);
+
+            void *pos = _start + arena->_cursor;
+            arena->_cursor += size;
+            return (T*)pos;
+        }
+
         while (_cursor + size >= _end)
             enlarge();
 
@@ -54,8 +121,16 @@ public:
 private:
     MemoryMapW(const std::string &path, boost::interprocess::file_mapping *file, boost::interprocess::mapped_region *region);
 
+    void refill(Arena *arena, size_t size);
+
     char *_cursor;
     char *_end;
+
+    std::mutex _mutex;              // guards _cursor, while arenas are open
+    std::shared_mutex _pins;        // held shared by each open arena
+    static thread_local Arena *_arena;
+
+    static const size_t ARENA_CHUNK = 64 * 1024;
 };
 
 #endif // MEMORYMAPW_H
\ No newline at end of file
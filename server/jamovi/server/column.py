@@ -15,10 +15,20 @@ from .compute import Transfilterifier
 from .compute import Transfudgifier
 from .compute import Checker
 from .compute import Messages
+from .compute import Compiler
+from .compute.nodes import Num
+from .compute.nodes import Str
+from .compute.nodes import Tuple
+from .compute.nodes import UnaryOp
+from .compute.nodes import BinOp
+from .compute.nodes import BoolOp
+from .compute.nodes import Compare
+from .compute.nodes import Call
 
 from .compute import FValues
 from .compute import convert
 from .compute import is_missing
+from .utils import is_int32
 
 from collections import namedtuple
 
@@ -377,6 +387,11 @@ class Column:
             self._create_child()
         self._child.append(value)
 
+    def import_values(self, start, values):
+        if self._child is None:
+            self._create_child()
+        self._child.import_values(start, values)
+
     def insert_level(self, raw, label, import_value=None, pinned=False):
         if self._child is None:
             self._create_child()
@@ -456,6 +471,10 @@ class Column:
             return self._child.append_level(raw, label, import_value, pinned)
         return False
 
+    def build_levels(self, levels):
+        if self._child is not None:
+            self._child.build_levels(levels)
+
     @property
     def row_count(self):
         if self._child is not None:
@@ -580,6 +599,10 @@ class Column:
 
         self._child.clear_levels()
 
+        if start == 0 and end == self.row_count and self._recode():
+            self._needs_recalc = False
+            return
+
         if self._node is not None and self._node.has_levels:
             for level in self._node.get_levels(self.row_count, self.uses_column_formula):
                 self._child.append_level(level[0], level[1])
@@ -598,6 +621,8 @@ class Column:
                 v = 1
             for row_no in range(start, end):
                 self._child.set_value(row_no, v, True)
+        elif start == 0 and end == self.row_count and self._evaluate():
+            self.determine_dps()
         else:
             for row_no in range(start, end):
                 try:
@@ -619,6 +644,119 @@ class Column:
 
         self._needs_recalc = False
 
+    def _recode(self):
+        # where a recoded column's source has levels, the value of each row
+        # depends only on the source's value in that row. the formula is
+        # evaluated once for each distinct value (at the first row it
+        # appears in), and the core maps the source's values to the results
+        if self.column_type is not ColumnType.RECODED or self._node is None:
+            return False
+        if self._parent_id == 0 or not hasattr(self._child, 'recode'):
+            return False
+        if self.data_type is DataType.TEXT and self.measure_type is MeasureType.ID:
+            return False
+
+        source = self._parent.get_column_by_id(self._parent_id)
+        if (source.is_virtual
+                or not source.has_levels
+                or source.measure_type is MeasureType.CONTINUOUS
+                or not Column._is_level_wise(self._node, source)):
+            return False
+
+        if self.data_type is DataType.DECIMAL:
+            ul_type = float
+        elif self.data_type is DataType.TEXT:
+            ul_type = str
+        else:
+            ul_type = int
+
+        from_values, rows = source._child.first_rows()
+        values = [ ]
+        results = [ ]
+
+        for row_no in rows:
+            try:
+                v = self._node.fvalue(row_no, self.row_count, False)
+                values.append(v)
+                v = convert(v, ul_type)
+            except Exception as e:
+                values.append(NaN)
+                v = convert(NaN, ul_type)
+                self._parent._log.exception(e)
+            results.append(v)
+
+        if ul_type is int and not all(map(is_int32, results)):
+            return False  # let set_value() raise, as it does
+
+        if self._node.has_levels:
+            if isinstance(self._node, Call):
+                levels = self._node.get_levels(self.row_count, False, values)
+            else:
+                levels = self._node.get_levels(self.row_count, False)
+            for level in levels:
+                self._child.append_level(level[0], level[1])
+
+        if ul_type is str:
+            # as set_value() assigns them
+            to_values = [ ]
+            for v in results:
+                if v == '':
+                    to_values.append(-2147483648)
+                elif self._child.has_level(v):
+                    to_values.append(self._child.get_value_for_label(v))
+                else:
+                    level_i = self._child.level_count
+                    self._child.append_level(level_i, v, '')
+                    to_values.append(level_i)
+            results = to_values
+
+        self._child.recode(source._child, from_values, results)
+        self.determine_dps()
+        return True
+
+    @staticmethod
+    def _is_level_wise(node, source):
+        # whether the value of node in a row depends only on the value of
+        # source in that row
+        if isinstance(node, Column):
+            return node.id == source.id
+        elif isinstance(node, (Num, Str, Tuple)):
+            return True
+        elif isinstance(node, UnaryOp):
+            children = [ node.operand ]
+        elif isinstance(node, BinOp):
+            children = [ node.left, node.right ]
+        elif isinstance(node, BoolOp):
+            children = node.values
+        elif isinstance(node, Compare):
+            children = [ node.left ] + node.comparators
+        elif isinstance(node, Call):
+            if node.func.id in Column._ROW_WISE_FUNCS:
+                return False
+            if not node._function.meta.is_row_wise:
+                return False
+            children = node.args + [ kw.value for kw in node.keywords ]
+        else:
+            return False
+        return all(map(lambda child: Column._is_level_wise(child, source), children))
+
+    # functions whose values depend on the row, rather than its values
+    _ROW_WISE_FUNCS = ('ROW', 'NOTROW', 'OFFSET', 'UNIF', 'NORM', 'BETA', 'GAMMA')
+
+    def _evaluate(self):
+        # evaluates the whole column in the core, where the formula only
+        # uses what the core supports (see compute.Compiler). returns False
+        # if it needs evaluating a row at a time
+        dataset = getattr(self._parent, 'dataset', None)
+        if not hasattr(dataset, 'evaluate'):
+            return False
+        if self.data_type is DataType.TEXT or self.uses_column_formula:
+            return False
+        program = Compiler.compile(self._node)
+        if program is None:
+            return False
+        return dataset.evaluate(self.id, program, self.is_filter)
+
     def parse_formula(self):
 
         if not self.needs_parse:
@@ -15,6 +15,7 @@ from .transfilterifier import Transfilterifier
 from .transfudgifier import Transfudgifier
 from .checker import Checker
 from .messages import Messages
+from .compiler import Compiler
 
 
 class FormulaStatus(Enum):
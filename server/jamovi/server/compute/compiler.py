@@ -0,0 +1,291 @@
+import ast
+
+from jamovi.core import DataType
+
+from .nodes import Num
+from .nodes import UnaryOp
+from .nodes import BinOp
+from .nodes import BoolOp
+from .nodes import Compare
+from .nodes import Call
+
+
+class Unsupported(Exception):
+    pass
+
+
+class Compiler:
+    '''Lowers a formula into a program for DataSet.evaluate()
+
+    The core evaluates the program over whole columns, rather than calling
+    fvalue() for each row. Each instruction is a tuple of
+
+        (op, data_type, args, params, value)
+
+    where args are the indices of the earlier instructions it operates on,
+    and data_type is the python type (int or float) fvalue() would produce,
+    which isn't always the node's data_type. The last instruction produces
+    the column's values.
+
+    Only what the core reproduces exactly is supported; anything else (text,
+    column-wise functions, etc.) produces None, and the formula is
+    evaluated a row at a time as before.
+    '''
+
+    MISSING = -2147483648
+
+    _BIN_OPS = {
+        ast.Add: 'add',
+        ast.Sub: 'sub',
+        ast.Mult: 'mul',
+        ast.Div: 'div',
+        ast.FloorDiv: 'floordiv',
+        ast.Mod: 'mod',
+        ast.Pow: 'pow',
+    }
+
+    _COMPARISONS = {
+        ast.Eq: 'eq',
+        ast.NotEq: 'noteq',
+        ast.Lt: 'lt',
+        ast.LtE: 'lte',
+        ast.Gt: 'gt',
+        ast.GtE: 'gte',
+    }
+
+    _RECODE_FUNCS = ('RECODE', '_RECODE_NOM', '_RECODE_ORD', '_RECODE_CONT', '_RECODE_ID')
+
+    _MATH_FUNCS = { 'EXP': 'exp', 'LN': 'ln', 'LOG10': 'log10', 'SQRT': 'sqrt' }
+
+    @staticmethod
+    def compile(node):
+        compiler = Compiler()
+        try:
+            compiler._compile(node, True)
+        except Unsupported:
+            return None
+        return compiler._program
+
+    def __init__(self):
+        self._program = [ ]
+
+    def _emit(self, op, data_type, args=(), params=(), value=0):
+        self._program.append((op, data_type, list(args), list(params), value))
+        return len(self._program) - 1, data_type
+
+    def _constant(self, value, data_type):
+        if data_type is DataType.DECIMAL:
+            value = float(value)
+        return self._emit('constant', data_type, value=value)
+
+    def _missing(self, data_type):
+        if data_type is DataType.DECIMAL:
+            return self._constant(float('nan'), data_type)
+        else:
+            return self._constant(Compiler.MISSING, data_type)
+
+    def _is_missing_constant(self, node):
+        return isinstance(node, Num) and type(node.n) is int and node.n == Compiler.MISSING
+
+    def _compile(self, node, root=False):
+
+        if isinstance(node, Num):
+            if type(node.n) is int:
+                if abs(node.n) > 2 ** 53:
+                    raise Unsupported()
+                return self._constant(node.n, DataType.INTEGER)
+            elif type(node.n) is float:
+                return self._constant(node.n, DataType.DECIMAL)
+            raise Unsupported()
+
+        elif isinstance(node, UnaryOp):
+            operand, data_type = self._compile(node.operand)
+            if isinstance(node.op, ast.USub):
+                return self._emit('negate', data_type, [ operand ])
+            elif isinstance(node.op, ast.UAdd):
+                return self._emit('positive', data_type, [ operand ])
+            elif isinstance(node.op, ast.Not):
+                return self._emit('not', DataType.INTEGER, [ operand ])
+            elif isinstance(node.op, ast.Invert) and data_type is DataType.INTEGER:
+                return self._emit('invert', DataType.INTEGER, [ operand ])
+            raise Unsupported()
+
+        elif isinstance(node, BinOp):
+            op = Compiler._BIN_OPS.get(type(node.op))
+            data_type = node.data_type
+            if op is None or data_type not in (DataType.INTEGER, DataType.DECIMAL):
+                raise Unsupported()
+            left, _ = self._compile(node.left)
+            right, _ = self._compile(node.right)
+            return self._emit(op, data_type, [ left, right ])
+
+        elif isinstance(node, Compare):
+            ops = [ Compiler._COMPARISONS.get(type(op)) for op in node.ops ]
+            if None in ops:
+                raise Unsupported()
+            args = [ self._compile(node.left)[0] ]
+            args += [ self._compile(comp)[0] for comp in node.comparators ]
+            return self._emit('compare', DataType.INTEGER, args, ops)
+
+        elif isinstance(node, BoolOp):
+            if isinstance(node.op, ast.And):
+                op = 'and'
+            elif isinstance(node.op, ast.Or):
+                op = 'or'
+            else:
+                raise Unsupported()
+            args = [ self._compile(value)[0] for value in node.values ]
+            return self._emit(op, DataType.INTEGER, args)
+
+        elif isinstance(node, Call):
+            return self._compile_call(node, root)
+
+        elif hasattr(node, 'is_virtual'):  # a column
+            if node.is_virtual:
+                return self._constant(Compiler.MISSING, DataType.INTEGER)
+            data_type = node.data_type
+            if data_type not in (DataType.INTEGER, DataType.DECIMAL):
+                raise Unsupported()
+            return self._emit('column', data_type, value=node.id)
+
+        raise Unsupported()
+
+    def _compile_branch(self, node):
+        # a value passed through as is by IF(), RECODE(), etc.
+        reg, data_type = self._compile(node)
+        return reg, data_type, self._is_missing_constant(node)
+
+    def _compile_cond(self, node):
+        # the conditions of RECODE() are tested with 'if cond:', which is
+        # true for any level (a tuple), so only those which produce numbers
+        # are supported
+        if isinstance(node, (Compare, BoolOp, UnaryOp)):
+            return self._compile(node)[0]
+        if isinstance(node, Call) and node.func.id in ('NOT', 'IF', 'IFMISS'):
+            for arg in node.args[1:]:
+                if not isinstance(arg, Num):
+                    raise Unsupported()
+            return self._compile(node)[0]
+        raise Unsupported()
+
+    def _unify(self, branches, root):
+        # the values passed through by IF(), RECODE(), etc. need to share a
+        # type. missing values are missing whatever their type, and at the
+        # root the value is converted to the column's type anyway, so there
+        # decimals can stand in for integers
+        types = set([ t for (_, t, missing) in branches if not missing ])
+        if len(types) == 0:
+            data_type = DataType.INTEGER
+        elif len(types) == 1:
+            data_type = types.pop()
+        elif root:
+            data_type = DataType.DECIMAL
+        else:
+            raise Unsupported()
+
+        regs = [ ]
+        for reg, t, missing in branches:
+            if t is not data_type and missing:
+                reg, _ = self._missing(data_type)
+            regs.append(reg)
+        return regs, data_type
+
+    def _compile_call(self, node, root):
+
+        name = node.func.id
+        args = node.args
+        n_args = len(args)
+
+        if name == 'SUM':
+            params = { 'ignore_missing': 0, 'min_valid': 0 }
+            for kw in node.keywords:
+                value = kw.value
+                if (kw.arg not in params
+                        or not isinstance(value, Num)
+                        or type(value.n) is not int):
+                    raise Unsupported()
+                params[kw.arg] = value.n
+            if n_args == 0:
+                raise Unsupported()
+            args = [ self._compile(arg)[0] for arg in args ]
+            params = [ params['ignore_missing'], params['min_valid'] ]
+            return self._emit('sum', DataType.DECIMAL, args, params)
+
+        if len(node.keywords) > 0:
+            raise Unsupported()
+
+        if name == 'IF' or name == 'IFMISS':
+            if n_args < 1 or n_args > 3:
+                raise Unsupported()
+            cond, _ = self._compile(args[0])
+            # the defaults are x=1, y=NA
+            if n_args > 1:
+                x = self._compile_branch(args[1])
+            else:
+                x = self._constant(1, DataType.INTEGER) + (False,)
+            if n_args > 2:
+                y = self._compile_branch(args[2])
+            else:
+                y = self._missing(DataType.INTEGER) + (True,)
+            (x, y), data_type = self._unify([ x, y ], root)
+            op = 'if' if name == 'IF' else 'ifmiss'
+            return self._emit(op, data_type, [ cond, x, y ])
+
+        elif name in Compiler._RECODE_FUNCS and n_args >= 1:
+            # RECODE(x, cond1, value1, cond2, value2, ..., [otherwise])
+            branches = [ self._compile_branch(args[0]) ]
+            conds = [ ]
+            for i in range(1, n_args):
+                if i % 2 == 1 and i < n_args - 1:
+                    conds.append(self._compile_cond(args[i]))
+                else:
+                    branches.append(self._compile_branch(args[i]))
+            values, data_type = self._unify(branches, root)
+            args = [ values[0] ]
+            for i in range(len(conds)):
+                args.append(conds[i])
+                args.append(values[i + 1])
+            args.extend(values[len(conds) + 1:])
+            return self._emit('recode', data_type, args)
+
+        elif name == '_FILTER' and n_args == 1:
+            cond, _ = self._compile(args[0])
+            return self._emit('filter', DataType.INTEGER, [ cond ])
+
+        elif name == 'FILTER' and n_args >= 1:
+            compiled = [ self._compile(arg) for arg in args ]
+            data_type = compiled[0][1]
+            return self._emit('filter_value', data_type, [ c[0] for c in compiled ])
+
+        elif name == 'NOT' and n_args == 1:
+            x, _ = self._compile(args[0])
+            return self._emit('not', DataType.INTEGER, [ x ])
+
+        elif name == 'ABS' and n_args == 1:
+            x, data_type = self._compile(args[0])
+            return self._emit('abs', data_type, [ x ])
+
+        elif name == 'ROUND' and n_args in (1, 2):
+            if n_args == 2:
+                digits = args[1]
+                if not isinstance(digits, Num) or type(digits.n) is not int or digits.n != 0:
+                    raise Unsupported()
+            x, data_type = self._compile(args[0])
+            return self._emit('round', data_type, [ x ])
+
+        elif (name == 'FLOOR' or name == 'CEILING') and n_args == 1:
+            x, _ = self._compile(args[0])
+            return self._emit(name.lower(), DataType.INTEGER, [ x ])
+
+        elif name in Compiler._MATH_FUNCS and n_args == 1:
+            x, _ = self._compile(args[0])
+            return self._emit(Compiler._MATH_FUNCS[name], DataType.DECIMAL, [ x ])
+
+        elif (name == 'MIN' or name == 'MAX') and n_args >= 1:
+            args = [ self._compile(arg)[0] for arg in args ]
+            return self._emit(name.lower(), DataType.DECIMAL, args)
+
+        elif name == 'ROW' and n_args == 0:
+            return self._emit('row', DataType.INTEGER)
+
+        raise Unsupported()
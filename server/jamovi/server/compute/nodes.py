@@ -558,7 +558,9 @@ class Call(ast.Call, Node):
     def has_levels(self):
         return True
 
-    def get_levels(self, row_count, filt):
+    def get_levels(self, row_count, filt, values=None):
+        # values, if provided, are used in place of fvalues(); only which
+        # values occur matters (see Column._recode())
 
         func_meta = self._function.meta
         arg_level_indices = func_meta.arg_level_indices
@@ -592,7 +594,10 @@ class Call(ast.Call, Node):
                 for level in arg.get_levels(row_count, filt):
                     level_use[level[1]] = 0
 
-        for value in self.fvalues(row_count, filt):
+        if values is None:
+            values = self.fvalues(row_count, filt)
+
+        for value in values:
             if is_missing(value):
                 continue
             value = convert(value, str)
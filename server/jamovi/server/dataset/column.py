@@ -162,6 +162,10 @@ class Column(Protocol):
     def clear_levels(self):
         raise NotImplementedError
 
+    @abstractmethod
+    def build_levels(self, levels):
+        raise NotImplementedError
+
     @abstractmethod
     def trim_unused_levels(self):
         raise NotImplementedError
@@ -212,6 +212,10 @@ class DuckColumn(Column):
     def clear_levels(self):
         raise NotImplementedError
 
+    def build_levels(self, levels):
+        for raw, label, import_value, pinned in levels:
+            self.append_level(raw, label, import_value, pinned)
+
     def trim_unused_levels(self):
         raise NotImplementedError
 
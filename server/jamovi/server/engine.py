@@ -68,6 +68,9 @@ class Engine:
         allow_arbitrary_code = config.get('allow_arbitrary_code', 'true')
         self._allow_arbitrary_code = not (allow_arbitrary_code == 'false' or allow_arbitrary_code == '0')
 
+        # requests can be recorded, for replaying with jamovi-replay
+        self._record_path = config.get('engine_record_path', None)
+
         self._conn_path = None
         self._process = None
         self._process_stopping = None
@@ -292,6 +295,9 @@ class Engine:
         self._socket.send(message.SerializeToString())
         self._message_id += 1
 
+        if self._record_path:
+            self._record(request)
+
         # now we've sent a request, if the engine crashes, we'll
         # attribute it to the analysis
         self._at_startup = False
@@ -367,6 +373,17 @@ class Engine:
             if timeout is not None:
                 timeout.cancel()
 
+    def _record(self, request):
+        # each request is written as a 4 byte (little endian) length,
+        # followed by the serialized AnalysisRequest
+        try:
+            payload = request.SerializeToString()
+            with open(self._record_path, 'ab') as file:
+                file.write(len(payload).to_bytes(4, 'little'))
+                file.write(payload)
+        except OSError as e:
+            log.exception(e)
+
     async def restart(self):
         if self._running.is_set():
             log.info('Stopping engine')
@@ -5,11 +5,18 @@
 import os
 import csv
 import math
+import codecs
 from io import TextIOWrapper
 import chardet
 import logging
 
+from jamovi.core import ColumnType
+from jamovi.core import DataSet
+from jamovi.core import CSVReader as CoreCSVReader
+from jamovi.core import CSVWriter as CoreCSVWriter
+
 from .reader import Reader
+from .reader import ColumnReader
 from .jsonlines import JSONLinesReader
 
 
@@ -35,6 +42,15 @@ def read(data, path, prog_cb, *, settings, **kwargs):
 
 def write(data, path, prog_cb):
 
+    if isinstance(getattr(data, 'dataset', None), DataSet):
+        # the core formats the rows on several threads
+        ids = [ column.id for column in data
+                if not (column.is_virtual or (column.is_filter and column.active)) ]
+        writer = CoreCSVWriter(data.dataset, ids, os.linesep)
+        with open(path, 'wb') as file:
+            writer.write(file.fileno(), prog_cb)
+        return
+
     with open(path, 'w', encoding='utf-8') as file:
         sep = ''
         for column in data:
@@ -77,6 +93,7 @@ class CSVReader(Reader):
         super().__init__(settings)
         self._file = None
         self._text_stream = None
+        self._encoding = None
 
     def open(self, path):
 
@@ -93,6 +110,7 @@ class CSVReader(Reader):
             if encoding == 'ascii':
                 encoding = 'utf-8-sig'
 
+            self._encoding = encoding
             self._text_stream = TextIOWrapper(self._file, encoding=encoding, errors='replace')
 
             try:
@@ -110,6 +128,82 @@ class CSVReader(Reader):
                 self._file.close()
             raise e
 
+    def read_into(self, data, path, prog_cb):
+
+        self.open(path)
+        try:
+            read = self._read_natively(data, path, prog_cb)
+        finally:
+            self.close()
+
+        if not read:
+            super().read_into(data, path, prog_cb)
+
+    def _read_natively(self, data, path, prog_cb):
+        # the core parses the file on several threads, where it's utf-8 and
+        # the dialect is one it reproduces exactly. returns False if it
+        # needs to be read in python
+
+        if not isinstance(getattr(data, 'dataset', None), DataSet) or self._total == 0:
+            return False
+
+        try:
+            encoding = codecs.lookup(self._encoding).name
+        except (TypeError, LookupError):
+            return False
+
+        if encoding == 'utf-8':
+            # the core skips a BOM, as utf-8-sig does
+            self._file.seek(0)
+            if self._file.read(3) == codecs.BOM_UTF8:
+                return False
+
+        dialect = self._dialect
+        missings = self._settings.get('missings', 'NA')
+
+        if (encoding not in ('utf-8', 'utf-8-sig')
+                or not isinstance(missings, str)
+                or dialect.escapechar is not None
+                or not dialect.doublequote
+                or dialect.quoting != csv.QUOTE_MINIMAL
+                or getattr(dialect, 'strict', False)):
+            return False
+
+        for char in (dialect.delimiter, dialect.quotechar):
+            if not isinstance(char, str) or len(char) != 1 or not 0 < ord(char) < 128 or char in '\r\n':
+                return False
+        if dialect.delimiter == dialect.quotechar:
+            return False
+
+        reader = CoreCSVReader(
+            path,
+            dialect.delimiter,
+            dialect.quotechar,
+            dialect.skipinitialspace,
+            missings)
+
+        if not reader.scan(lambda p: prog_cb(0.33333 * p)):
+            return False
+
+        column_readers = [ ]
+
+        for i, column_name in enumerate(reader.column_names):
+            data.append_column(column_name)
+            column = data[i]
+            column.column_type = ColumnType.DATA
+            column_readers.append(ColumnReader(column, i, self._settings))
+
+        for i, column_reader in enumerate(column_readers):
+            column_reader.set_examined(**reader.column_stats(i))
+            column_reader.ruminate()
+
+        data.set_row_count(reader.row_count)
+
+        ids = [ data[i].id for i in range(len(column_readers)) ]
+        reader.read_into(data.dataset, ids, lambda p: prog_cb(.33333 + .66666 * p))
+
+        return True
+
     def progress(self):
         return self._file.tell()
 
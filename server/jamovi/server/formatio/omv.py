@@ -17,6 +17,8 @@ from jamovi.core import ColumnType
 from jamovi.core import DataType
 from jamovi.core import MeasureType
 from jamovi.server.appinfo import app_info
+from jamovi.server.utils.parallelzip import write_deflated
+from jamovi.server.utils.parallelzip import CHUNK_SIZE
 
 from ..i18n import _
 
@@ -157,55 +159,94 @@ def write(data, path, prog_cb, html=None, is_template=False):
             else:
                 required_bytes += (4 * row_count)
 
+        cursor = 0
         if string_table_required:
-            cursor = 0
             string_file = NamedTemporaryFile(delete=False)
 
-        temp_file = NamedTemporaryFile(delete=False)
-        temp_file.truncate(required_bytes)
+        # the core data set can copy the cells straight out of its blocks;
+        # these are compressed concurrently, and streamed into the archive
+        if hasattr(data.dataset, 'export_column_data'):
+
+            def data_chunks():
+                nonlocal cursor
+                strings_fd = string_file.fileno() if string_table_required else -1
+                chunk = bytearray(CHUNK_SIZE)
+                used = 0
+
+                for col_no in range(data.column_count):
+                    column = data[col_no]
+                    if column.is_virtual is True:
+                        continue
+                    width = 8 if column.data_type == DataType.DECIMAL else 4
+                    row_no = 0
+                    while row_no < row_count:
+                        n = min(row_count - row_no, (CHUNK_SIZE - used) // width)
+                        if n > 0:
+                            view = memoryview(chunk)[used:used + n * width]
+                            cursor = data.dataset.export_column_data(
+                                column.id, row_no, n, view, strings_fd, cursor)
+                            used += n * width
+                            row_no += n
+                        if CHUNK_SIZE - used < 8:
+                            yield memoryview(chunk)[:used]
+                            chunk = bytearray(CHUNK_SIZE)
+                            used = 0
+                            prog_cb((col_no + row_no / row_count) / data.column_count)
+
+                if used > 0:
+                    yield memoryview(chunk)[:used]
+
+            write_deflated(zip, 'data.bin', data_chunks(), required_bytes)
 
-        for col_no in range(data.column_count):
-            column = data[col_no]
-            if column.is_virtual is True:
-                continue
-            if column.data_type == DataType.DECIMAL:
-                for i in range(0, row_count):
-                    value = column.raw(i)
-                    byts = struct.pack('<d', value)
-                    temp_file.write(byts)
-                    if i % 100000 == 0:
-                        prog_cb((col_no + i / row_count) / data.column_count)
-            elif column.data_type == DataType.TEXT and column.measure_type == MeasureType.ID:
-                for i in range(0, row_count):
-                    value = column[i]
-                    if value != '':
-                        byts = value.encode('utf-8')
-                        string_file.write(byts)
-                        string_file.write(bytes(1))
-                        n = len(byts) + 1
-                        byts = struct.pack('<i', cursor)
+        else:
+
+            temp_file = NamedTemporaryFile(delete=False)
+            temp_file.truncate(required_bytes)
+
+            for col_no in range(data.column_count):
+                column = data[col_no]
+                if column.is_virtual is True:
+                    continue
+                if column.data_type == DataType.DECIMAL:
+                    for i in range(0, row_count):
+                        value = column.raw(i)
+                        byts = struct.pack('<d', value)
                         temp_file.write(byts)
-                        cursor += n
-                    else:
-                        byts = struct.pack('<i', -2147483648)
+                        if i % 100000 == 0:
+                            prog_cb((col_no + i / row_count) / data.column_count)
+                elif column.data_type == DataType.TEXT and column.measure_type == MeasureType.ID:
+                    for i in range(0, row_count):
+                        value = column[i]
+                        if value != '':
+                            byts = value.encode('utf-8')
+                            string_file.write(byts)
+                            string_file.write(bytes(1))
+                            n = len(byts) + 1
+                            byts = struct.pack('<i', cursor)
+                            temp_file.write(byts)
+                            cursor += n
+                        else:
+                            byts = struct.pack('<i', -2147483648)
+                            temp_file.write(byts)
+                        if i % 100000 == 0:
+                            prog_cb((col_no + i / row_count) / data.column_count)
+                else:
+                    for i in range(0, row_count):
+                        value = column.raw(i)
+                        byts = struct.pack('<i', value)
                         temp_file.write(byts)
-                    if i % 100000 == 0:
-                        prog_cb((col_no + i / row_count) / data.column_count)
-            else:
-                for i in range(0, row_count):
-                    value = column.raw(i)
-                    byts = struct.pack('<i', value)
-                    temp_file.write(byts)
-                    if i % 100000 == 0:
-                        prog_cb((col_no + i / row_count) / data.column_count)
+                        if i % 100000 == 0:
+                            prog_cb((col_no + i / row_count) / data.column_count)
 
-        temp_file.close()
-        zip.write(temp_file.name, 'data.bin')
-        os.remove(temp_file.name)
+            temp_file.close()
+            zip.write(temp_file.name, 'data.bin')
+            os.remove(temp_file.name)
 
         if string_table_required:
             string_file.close()
-            zip.write(string_file.name, 'strings.bin')
+            with open(string_file.name, 'rb') as strings:
+                chunks = iter(lambda: strings.read(CHUNK_SIZE), b'')
+                write_deflated(zip, 'strings.bin', chunks, cursor)
             os.remove(string_file.name)
 
         resources = [ ]
@@ -462,6 +503,14 @@ def read(data, path, prog_cb, **kwargs):
 
             ncols = data.dataset.column_count
             col_no = 0
+            data_offset = 0
+
+            # the core data set can read the cells straight into its blocks
+            native = hasattr(data.dataset, 'import_column_data')
+            strings = None
+            if native and string_table_present:
+                string_table.seek(0)
+                strings = string_table.read()
 
             for column in data.dataset:
 
@@ -492,6 +541,16 @@ def read(data, path, prog_cb, **kwargs):
                     repair_levels = column.id in columns_w_bad_levels
                     transform = None
 
+                if native and not repair_levels:
+                    data.dataset.import_column_data(
+                        column.id, row_count, data_file.fileno(), data_offset, strings)
+                    prog_cb(0.1 + 0.85 * (col_no + 1) / ncols)
+                    data_offset += elem_width * row_count
+                    col_no += 1
+                    continue
+
+                data_file.seek(data_offset)
+
                 for row_offset in range(0, row_count, int(BUFF_SIZE / elem_width)):
                     n_bytes_to_read = min(elem_width * (row_count - row_offset), BUFF_SIZE)
                     buff_view = buff[0:n_bytes_to_read]
@@ -521,6 +580,7 @@ def read(data, path, prog_cb, **kwargs):
 
                     prog_cb(0.1 + 0.85 * (col_no + row_offset / row_count) / ncols)
 
+                data_offset += elem_width * row_count
                 col_no += 1
 
             data_file.close()
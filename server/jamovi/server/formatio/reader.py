@@ -199,6 +199,18 @@ class ColumnReader:
 
         return True
 
+    def set_examined(self, *, is_empty, only_integers, only_floats, only_euro_floats, unique_values, many_uniques, dps):
+        # where the rows have been examined elsewhere (i.e. by the core's
+        # CSVReader), rather than with examine_row()
+        self._is_empty = is_empty
+        self._only_integers = only_integers
+        self._only_floats = only_floats
+        self._only_euro_floats = only_euro_floats
+        self._unique_values = unique_values
+        self._n_uniques = len(unique_values)
+        self._many_uniques = many_uniques
+        self._dps = dps
+
     def ruminate(self):
 
         if self._only_integers:
@@ -212,8 +224,9 @@ class ColumnReader:
                 self._unique_values = list(self._unique_values)
                 self._unique_values = list(map(int, self._unique_values))
                 self._unique_values.sort()
-                for level in self._unique_values:
-                    self._column.append_level(level, str(level))
+                self._column.build_levels([
+                    (level, str(level), None, False)
+                    for level in self._unique_values])
             else:
                 self._data_type = DataType.INTEGER
                 self._measure_type = MeasureType.CONTINUOUS
@@ -241,8 +254,9 @@ class ColumnReader:
 
                 self._unique_values = list(self._unique_values)
                 self._unique_values.sort()
-                for i, label in enumerate(self._unique_values):
-                    self._column.append_level(i, label)
+                self._column.build_levels([
+                    (i, label, None, False)
+                    for i, label in enumerate(self._unique_values)])
             else:
                 self._data_type = DataType.TEXT
                 self._measure_type = MeasureType.ID
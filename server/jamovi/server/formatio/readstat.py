@@ -40,7 +40,7 @@ def read(data, path, prog_cb, *, format, **kwargs):
         column.determine_dps()
 
 
-TIME_START = date(1970, 1, 1)
+BATCH_SIZE = 16384
 
 
 class Parser(ReadStatParser):
@@ -51,6 +51,11 @@ class Parser(ReadStatParser):
         self._prog_cb = prog_cb
         self._max_row_index = 0
 
+        # the values are collected a batch of rows at a time, and then
+        # imported into each column in one go
+        self._values = [ ]
+        self._batch_start = 0
+
         self._tmp_value_labels = { }
         self._columns_by_labels_key = { }
 
@@ -60,8 +65,10 @@ class Parser(ReadStatParser):
     def parse(self, path, format):
         try:
             super().parse(path, format)
+            self._import_values()
         except ReadStatError as e:
             if e.errno == 9:  # not expected no. of rows
+                self._import_values()
                 self._data.set_row_count(self._max_row_index + 1)
             else:
                 raise e
@@ -112,6 +119,7 @@ class Parser(ReadStatParser):
         label = variable.label
 
         column = self._data.append_column(name)
+        self._values.append([ ])
         if label is not None:
             column.description = label
 
@@ -274,69 +282,45 @@ class Parser(ReadStatParser):
 
     def handle_value(self, var_index, row_index, value):
 
-        if row_index >= self._data.row_count:
-            self._data.set_row_count(row_index + 1)
-        else:
-            if var_index == 0 and row_index % 100 == 0:
-                self._prog_cb(row_index / self._data.row_count)
-
-        self._max_row_index = max(self._max_row_index, row_index)
-
-        vt = type(value)
-
-        column = self._data[var_index]
-
-        if column.data_type is DataType.TEXT:
-            if value is not None:
-                if vt is not str:
-                    value = str(value)
-                if column.has_levels:
-                    if not column.has_level(value):
-                        column.append_level(
-                            column.level_count,
-                            value,
-                            value,
-                            pinned=False)
-                    if column.level_count > 50:
-                        column.change(measure_type=MeasureType.ID)
-                column.set_value(row_index, value)
-            else:
-                column.set_value(row_index, '')
-        elif (column.measure_type is MeasureType.NOMINAL
-                or column.measure_type is MeasureType.ORDINAL):
-            if isinstance(value, Number):
-                if not math.isclose(float(value) % 1.0, 0.0):
-                    column.change(data_type=DataType.DECIMAL)
-                    self.handle_value(var_index, row_index, value)
-                    return
-
-                try:
-                    value = int(value)
-                    if value.bit_length() > 32:
-                        raise Exception()
-                except Exception:
-                    column.change(
-                        data_type=DataType.DECIMAL,
-                        measure_type=MeasureType.CONTINUOUS)
-                column.set_value(row_index, value)
-            elif vt is date:
-                delta = value - TIME_START
-                ul_value = delta.days
-                if not column.has_level(ul_value):
-                    column.insert_level(ul_value, value.isoformat(), str(ul_value))
-                column.set_value(row_index, ul_value)
-            else:
-                column.set_value(row_index, -2147483648)
-        elif column.data_type is DataType.DECIMAL:
-            if isinstance(value, Number):
-                column.set_value(row_index, float(value))
-            else:
-                column.set_value(row_index, float('nan'))
-        elif column.data_type is DataType.INTEGER:
-            if isinstance(value, Number):
-                column.set_value(row_index, int(value))
-            else:
-                column.set_value(row_index, -2147483648)
+        if var_index == 0 and row_index % 100 == 0:
+            row_count = self._data.row_count
+            if row_index < row_count:
+                self._prog_cb(row_index / row_count)
+
+        if row_index > self._max_row_index:
+            self._max_row_index = row_index
+
+        values = self._values[var_index]
+        offset = row_index - self._batch_start
+
+        if offset == len(values):
+            values.append(value)
+        elif offset > len(values):
+            values.extend([ None ] * (offset - len(values)))
+            values.append(value)
+        elif offset >= 0:
+            values[offset] = value
+        else:  # from an earlier batch
+            self._data[var_index].import_values(row_index, [ value ])
+
+        if offset >= BATCH_SIZE - 1 and var_index == len(self._values) - 1:
+            self._import_values()
+
+    def _import_values(self):
+        n_rows = max(map(len, self._values), default=0)
+        if n_rows == 0:
+            return
+
+        end = self._batch_start + n_rows
+        if end > self._data.row_count:
+            self._data.set_row_count(end)
+
+        for index, values in enumerate(self._values):
+            if values:
+                self._data[index].import_values(self._batch_start, values)
+                values.clear()
+
+        self._batch_start = end
 
 
 def write(data, path, prog_cb, format):
@@ -2146,6 +2146,40 @@ class Instance:
                 self._mod_tracker.log_column_realisation(column)
                 cols_changed.add(column)
 
+            # the data columns changing type are changed together, so
+            # they're converted in parallel
+            type_changes = [ ]
+            before_change = { }
+            for column_pb in request_schema_columns:
+                if column_pb.id == 0:
+                    column = self._data[column_pb.index]
+                else:
+                    column = self._data.get_column_by_id(column_pb.id)
+
+                column_type = column.column_type
+                if column_type is ColumnType.NONE:
+                    column_type = ColumnType(column_pb.columnType)
+                if column_type is not ColumnType.DATA or column.id in before_change:
+                    continue
+
+                data_type = DataType(column_pb.dataType)
+                measure_type = MeasureType(column_pb.measureType)
+                if ((data_type is not DataType.NONE and data_type != column.data_type)
+                        or (measure_type is not MeasureType.NONE and measure_type != column.measure_type)):
+                    before_change[column.id] = (
+                        column.data_type,
+                        column.measure_type,
+                        column.levels,
+                        column.missing_values)
+                    type_changes.append((column, data_type, measure_type))
+
+            if len(type_changes) > 0:
+
+                def prog_cb(p):
+                    self._coms.send(None, self._instance_id, request, complete=False, progress=(1000 * p, 1000))
+
+                self._data.change_column_types(type_changes, prog_cb)
+
             for column_pb in request_schema_columns:
                 column = None
                 if column_pb.id == 0:
@@ -2166,6 +2200,9 @@ class Instance:
                 old_parent_id = column.parent_id
                 old_missing_values = column.missing_values
 
+                if column.id in before_change:
+                    old_d_type, old_m_type, old_levels, old_missing_values = before_change[column.id]
+
                 levels = None
                 if column_pb.hasLevels:
                     levels = [ ]
@@ -2179,7 +2216,7 @@ class Instance:
                 if column.column_type is ColumnType.NONE:
                     column.column_type = ColumnType(column_pb.columnType)
 
-                if column.column_type is ColumnType.DATA:
+                if column.column_type is ColumnType.DATA and column.id not in before_change:
                     column.change(
                         data_type=DataType(column_pb.dataType),
                         measure_type=MeasureType(column_pb.measureType),
@@ -2847,18 +2884,7 @@ class Instance:
             row_data.rowCount = row_count
             row_data.action = jcoms.DataSetRR.RowData.RowDataAction.Value('MODIFY')
 
-            row_nums = range(row_start, row_start + row_count)
-
-            if not self._data.ex_filtered:
-                filtered = map(lambda row_no: self._data.is_row_filtered(row_no), row_nums)
-                filtered = map(lambda filtered: 1 if filtered else 0, filtered)
-                row_data.filterData = bytes(filtered)
-                indices_map = list(range(row_start, row_start + row_count))
-            else:
-                row_nums = map(lambda row_no: self._data.get_index_ex_filtered(row_no), row_nums)
-                row_data.rowNums[:] = row_nums
-                indices_map = self._data.get_indices_ex_filtered(row_start, row_count)
-
+            columns = [ ]
             base_index = 0
             search_index = col_start
             for cc in range(col_count):
@@ -2870,7 +2896,33 @@ class Instance:
 
                 base_index = column.index + 1
                 search_index = 0
+                columns.append(column)
+
+            # the core data set can fetch the whole block in one call
+            if hasattr(self._data.dataset, 'fetch_block'):
+                column_ids = map(lambda column: 0 if column.is_virtual else column.id, columns)
+                row_nums, filtered, values = self._data.dataset.fetch_block(
+                    row_start, row_count, list(column_ids), self._data.ex_filtered)
+                if not self._data.ex_filtered:
+                    row_data.filterData = filtered
+                else:
+                    row_data.rowNums[:] = row_nums
+                block_pb.MergeFromString(values)
+                continue
+
+            row_nums = range(row_start, row_start + row_count)
+
+            if not self._data.ex_filtered:
+                filtered = map(lambda row_no: self._data.is_row_filtered(row_no), row_nums)
+                filtered = map(lambda filtered: 1 if filtered else 0, filtered)
+                row_data.filterData = bytes(filtered)
+                indices_map = list(range(row_start, row_start + row_count))
+            else:
+                row_nums = map(lambda row_no: self._data.get_index_ex_filtered(row_no), row_nums)
+                row_data.rowNums[:] = row_nums
+                indices_map = self._data.get_indices_ex_filtered(row_start, row_count)
 
+            for column in columns:
                 if column.data_type == DataType.DECIMAL:
                     for j in range(row_count):
                         cell = block_pb.values.add()
@@ -406,6 +406,15 @@ class InstanceModel:
     def refresh_filter_state(self):
         self._dataset.refresh_filter_state()
 
+    def change_column_types(self, changes, prog_cb=None):
+        # as column.change() for each (column, data_type, measure_type) in
+        # changes, with the columns converted in parallel
+        children = [ ]
+        for column, data_type, measure_type in changes:
+            column.realise()
+            children.append((column._child, data_type, measure_type))
+        self._dataset.change_types(children, prog_cb)
+
     def delete_columns(self, start, end):
         self._dataset.delete_columns(start, end)
         del self._columns[start:end + 1]
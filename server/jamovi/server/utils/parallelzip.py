@@ -0,0 +1,138 @@
+
+import io
+import os
+import time
+import zlib
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+from zipfile import ZipFile
+from zipfile import ZipInfo
+from zipfile import ZIP_DEFLATED
+from zipfile import ZIP64_LIMIT
+
+
+# deflate can refer back this far; each chunk is primed with this much of
+# the chunk before it, so splitting the data costs very little compression
+WINDOW_SIZE = 32768
+
+# a reasonable size for the chunks passed to write_deflated()
+CHUNK_SIZE = 1048576
+
+
+def _has_internals():
+    # write_deflated() writes the entry with zipfile's private internals
+    # (as ZipFile.open(name, 'w') does); where a python doesn't have
+    # them, the entry is written through ZipFile.open() instead
+    if not hasattr(ZipInfo, 'FileHeader'):
+        return False
+    with ZipFile(io.BytesIO(), 'w') as zip:
+        return all(hasattr(zip, attr) for attr in (
+            '_lock', '_writecheck', '_didModify', 'start_dir', 'fp', 'filelist', 'NameToInfo'))
+
+
+_HAS_INTERNALS = _has_internals()
+
+
+def _deflate(chunk, zdict):
+    # raw deflate (no zlib header), ending on a byte boundary, but not
+    # ending the stream, so the outputs of successive chunks can be
+    # concatenated into one stream (this is how pigz does it)
+    if zdict is not None:
+        compressor = zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED, -15, zdict=zdict)
+    else:
+        compressor = zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED, -15)
+    return compressor.compress(chunk) + compressor.flush(zlib.Z_SYNC_FLUSH)
+
+
+def write_deflated(zip, name, chunks, size, workers=None):
+    '''Writes an entry to the zip file, deflating the chunks concurrently
+
+    chunks is an iterable of bytes-like objects, which are consumed as
+    they are compressed, so the whole entry needn't be in memory (or in a
+    temporary file) at once. size is the total uncompressed size, used to
+    decide whether the entry needs zip64.
+
+    Each chunk must be a buffer of its own, which isn't changed after
+    it's yielded: the chunks are compressed on other threads while the
+    next chunks are produced, so reusing one buffer for successive chunks
+    would corrupt the entry.
+
+    zlib releases the GIL while it compresses, so threads are sufficient.
+    The output is a single ordinary deflate stream, readable by anything
+    which reads zip files. Where zipfile lacks the internals this relies
+    on, the chunks are compressed one after the other, through
+    ZipFile.open(name, 'w').
+    '''
+
+    if workers is None:
+        workers = os.cpu_count() or 1
+
+    zinfo = ZipInfo(name, time.localtime(time.time())[:6])
+    zinfo.compress_type = ZIP_DEFLATED
+    zinfo.external_attr = 0o600 << 16
+    zinfo.file_size = 0
+    zinfo.compress_size = 0
+    zinfo.CRC = 0
+
+    zip64 = size * 1.05 > ZIP64_LIMIT
+
+    if not _HAS_INTERNALS:
+        with zip.open(zinfo, 'w', force_zip64=zip64) as entry:
+            for chunk in chunks:
+                entry.write(chunk)
+        return
+
+    # zipfile has no public interface for writing data which is already
+    # compressed, so this does what ZipFile.open(name, 'w') does
+    with zip._lock:
+        zip._writecheck(zinfo)
+        zip._didModify = True
+        zip.fp.seek(zip.start_dir)
+        zinfo.header_offset = zip.fp.tell()
+        zip.fp.write(zinfo.FileHeader(zip64))
+
+        crc = 0
+        file_size = 0
+        compress_size = 0
+
+        def write(compressed):
+            nonlocal compress_size
+            zip.fp.write(compressed)
+            compress_size += len(compressed)
+
+        with ThreadPoolExecutor(max_workers=workers) as executor:
+            pending = deque()
+            zdict = None
+
+            for chunk in chunks:
+                if len(chunk) == 0:
+                    continue
+                pending.append(executor.submit(_deflate, chunk, zdict))
+                zdict = bytes(chunk[-WINDOW_SIZE:])
+                crc = zlib.crc32(chunk, crc)
+                file_size += len(chunk)
+
+                # bound the number of chunks held in memory
+                if len(pending) >= 2 * workers:
+                    write(pending.popleft().result())
+
+            while pending:
+                write(pending.popleft().result())
+
+        # an empty final block ends the stream
+        write(zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED, -15).flush())
+
+        zinfo.CRC = crc
+        zinfo.file_size = file_size
+        zinfo.compress_size = compress_size
+
+        if not zip64 and (file_size > ZIP64_LIMIT or compress_size > ZIP64_LIMIT):
+            raise RuntimeError('File size too large')
+
+        zip.start_dir = zip.fp.tell()
+        zip.fp.seek(zinfo.header_offset)
+        zip.fp.write(zinfo.FileHeader(zip64))
+        zip.fp.seek(zip.start_dir)
+
+        zip.filelist.append(zinfo)
+        zip.NameToInfo[zinfo.filename] = zinfo
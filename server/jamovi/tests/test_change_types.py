@@ -0,0 +1,116 @@
+"""Tests for changing the types of columns at once."""
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+
+
+ROW_COUNT = 300
+NAN = float("nan")
+NAN_INT = -2147483648
+
+
+@pytest.mark.parametrize("column_count", [1, 2, 8])
+def test_change_types_failure_keeps_values(
+    shared_memory_store: Store, column_count: int
+):
+    """test that columns which can't be converted keep their values"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(ROW_COUNT)
+
+    # GIVEN nominal integer columns, where one has lost its levels (so its
+    # values can't be converted to text)
+    columns = []
+    for column_no in range(column_count):
+        column = ds.append_column(f"col{column_no}")
+        column.change(data_type=DataType.INTEGER, measure_type=MeasureType.NOMINAL)
+        for row_no in range(ROW_COUNT):
+            column.set_value(row_no, (row_no + column_no) % 5 + 1)
+        columns.append(column)
+
+    broken = columns[column_count // 2]
+    broken.clear_levels()
+
+    before = [[column.get_value(i) for i in range(ROW_COUNT)] for column in columns]
+
+    # WHEN changing them all to text
+    with pytest.raises(RuntimeError):
+        ds.change_types(
+            [(column, DataType.TEXT, MeasureType.NOMINAL) for column in columns]
+        )
+
+    # THEN the column which failed is as it was
+    assert broken.data_type is DataType.INTEGER
+    assert broken.measure_type is MeasureType.NOMINAL
+    assert [broken.get_value(i) for i in range(ROW_COUNT)] == before[column_count // 2]
+
+    # AND the others are either converted, or as they were
+    for column, values in zip(columns, before):
+        after = [column.get_value(i) for i in range(ROW_COUNT)]
+        if column.data_type is DataType.TEXT:
+            assert after == [str(value) for value in values]
+        else:
+            assert column.data_type is DataType.INTEGER
+            assert after == values
+
+
+SOURCES = [
+    ("dec", DataType.DECIMAL, MeasureType.CONTINUOUS,
+        [1.5, NAN, -2.0, 1e10, 0.125, 3.0, -0.0]),
+    ("int", DataType.INTEGER, MeasureType.CONTINUOUS,
+        [3, NAN_INT, -4, 2147483647, 0, 1000]),
+    ("nom", DataType.INTEGER, MeasureType.NOMINAL,
+        [5, 1, NAN_INT, 300, -7, 1]),
+    ("text", DataType.TEXT, MeasureType.NOMINAL,
+        ["fred", "2", None, "3.5", "-1", "jim", "2"]),
+    ("id", DataType.TEXT, MeasureType.ID,
+        ["a1", "7", None, "", "8.25", "b"]),
+]
+
+TARGETS = [
+    (DataType.INTEGER, MeasureType.NOMINAL),
+    (DataType.INTEGER, MeasureType.CONTINUOUS),
+    (DataType.DECIMAL, MeasureType.CONTINUOUS),
+    (DataType.TEXT, MeasureType.NOMINAL),
+    (DataType.TEXT, MeasureType.ORDINAL),
+    (DataType.TEXT, MeasureType.ID),
+]
+
+
+def test_change_types_as_change(shared_memory_store: Store):
+    """test that changing the types of many columns at once (on worker
+    threads, each with an arena) is the same as changing them in turn"""
+    ds = shared_memory_store.create_dataset()
+    row_count = 20000
+    ds.set_row_count(row_count)
+
+    # GIVEN two copies of columns of each type, to be changed to each type
+    pairs = []
+    for name, data_type, measure_type, values in SOURCES:
+        cells = [values[(i * 7 + i // 3) % len(values)] for i in range(row_count)]
+        for to_data_type, to_measure_type in TARGETS:
+            copies = []
+            for copy in ("at once", "in turn"):
+                column = ds.append_column(f"{name} {to_data_type} {to_measure_type} {copy}")
+                column.change(data_type=data_type, measure_type=measure_type)
+                column.import_values(0, cells)
+                copies.append(column)
+            pairs.append((copies[0], copies[1], to_data_type, to_measure_type))
+
+    # WHEN changing the types of one copy at once, and the other in turn
+    ds.change_types([(at_once, dt, mt) for at_once, _, dt, mt in pairs])
+    for _, in_turn, data_type, measure_type in pairs:
+        in_turn.change(data_type=data_type, measure_type=measure_type)
+
+    # THEN they're the same
+    for at_once, in_turn, _, _ in pairs:
+        assert at_once.data_type is in_turn.data_type, at_once.name
+        assert at_once.measure_type is in_turn.measure_type, at_once.name
+        assert at_once.levels == in_turn.levels, at_once.name
+        assert at_once.dps == in_turn.dps, at_once.name
+        for i in range(row_count):
+            x = at_once.get_value(i)
+            y = in_turn.get_value(i)
+            assert x == y or (x != x and y != y), f"{at_once.name}: row {i} is {x!r} rather than {y!r}"
@@ -0,0 +1,310 @@
+"""Tests for evaluating formulas over whole columns in the core."""
+
+from types import SimpleNamespace
+import logging
+import math
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.server.dataset import ColumnType
+from jamovi.server.instancemodel import InstanceModel
+from jamovi.server.column import Column
+
+
+NAN = float("nan")
+NAN_INT = -2147483648
+
+A_VALUES = [1.5, -2.0, 0.0, NAN, 3.25, 7.0, 0.5, -0.5]
+B_VALUES = [3, 0, -4, NAN_INT, 2, 1, 7, -1]
+N_VALUES = [1, 2, 3, 2, NAN_INT, 1, 3, 3]
+
+
+def equals(x, y) -> bool:
+    """test if two cell values are equal (nan equal to nan)"""
+    if isinstance(x, float) and isinstance(y, float):
+        if math.isnan(x):
+            return math.isnan(y)
+        return x == y
+    return x == y
+
+
+@pytest.fixture
+def model(shared_memory_store: Store) -> InstanceModel:
+    """a data set of a decimal column a, an integer column b, and a nominal
+    integer column n"""
+    session = SimpleNamespace(
+        modules=SimpleNamespace(add_listener=lambda listener: None)
+    )
+    model = InstanceModel(SimpleNamespace(session=session))
+    model.dataset = shared_memory_store.create_dataset()
+    model.set_log(logging.getLogger(__name__))
+    model.set_row_count(len(A_VALUES) * 4)
+
+    for name, data_type, measure_type, values in (
+        ("a", DataType.DECIMAL, MeasureType.CONTINUOUS, A_VALUES),
+        ("b", DataType.INTEGER, MeasureType.CONTINUOUS, B_VALUES),
+        ("n", DataType.INTEGER, MeasureType.NOMINAL, N_VALUES),
+    ):
+        column = model.append_column(name)
+        column.change(data_type=data_type, measure_type=measure_type)
+        for row_no in range(model.row_count):
+            column.set_value(row_no, values[row_no % len(values)])
+
+    return model
+
+
+def recalc(column: Column, native: bool) -> tuple[list, list]:
+    """recalculates the column, either in the core (as it would be) or a
+    row at a time, and returns its values, and whether each of _recode()
+    and _evaluate() were used"""
+    used = []
+    recode = Column._recode
+    evaluate = Column._evaluate
+
+    def spy(name, method):
+        def call(self):
+            result = method(self) if native else False
+            if self is column:
+                used.append((name, result))
+            return result
+
+        return call
+
+    with pytest.MonkeyPatch.context() as mp:
+        mp.setattr(Column, "_recode", spy("recode", recode))
+        mp.setattr(Column, "_evaluate", spy("evaluate", evaluate))
+        column.set_needs_recalc()
+        column.recalc()
+
+    values = [column.get_value(row_no) for row_no in range(column.row_count)]
+    return values, used
+
+
+def compare_computed(model: InstanceModel, formula: str, filter: bool = False):
+    """test that a computed (or filter) column has the same values when
+    evaluated in the core as when evaluated a row at a time"""
+    column = model.append_column(f"c{model.column_count}")
+    column.column_type = ColumnType.FILTER if filter else ColumnType.COMPUTED
+    column.formula = formula
+    column.parse_formula()
+    assert column.formula_message == ""
+
+    native, used = recalc(column, True)
+    assert ("evaluate", True) in used, "not evaluated in the core"
+    row_wise, _ = recalc(column, False)
+
+    assert len(native) == len(row_wise)
+    for row_no, (x, y) in enumerate(zip(native, row_wise)):
+        assert equals(x, y), f"{formula}: row {row_no} is {x} rather than {y}"
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "a * 2 + b",
+        "a - b / 4",
+        "b * b - 3 * b",
+        "-a + +b",
+        "a ** 2",
+        "b ** 2",
+        "b // 3",
+        "b % 3",
+        "a // 0.5",
+        "a % 1.25",
+        "~b",
+        "not a",
+        "1 < a <= 3",
+        "b < a < 2 < 5",
+        "a == b != 0",
+        "ABS(a) + ROUND(a) + FLOOR(a) + CEILING(a)",
+        "SQRT(ABS(a)) + EXP(b / 8)",
+        "MIN(a, b, 2) + MAX(a, b)",
+        "ROW() * 2",
+        "1.5",
+        "n + 1",
+    ],
+)
+def test_operators(model: InstanceModel, formula: str):
+    """test operators, and chains of them"""
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "a > 0 and b > 0",
+        "a or b",
+        "a and b or 5",
+        "b != 0 and 10 // b > 1",
+        "b == 0 or 10 % b == 1",
+        "b and 3 // b",
+        "not (b == 0 or 1 // b)",
+    ],
+)
+def test_bool_ops(model: InstanceModel, formula: str):
+    """test and and or, which only evaluate the values they need to (so
+    the division by zero is never reached)"""
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "IF(a > 1, a, b)",
+        "IF(b > 0)",
+        "IF(b > 0, 5)",
+        "IF(a > 0, 1, NA)",
+        "IFMISS(a, 0, a)",
+        "IFMISS(b)",
+        "IFMISS(b, -1)",
+        "FILTER(a, b > 0)",
+        "FILTER(b, a > 0, n == 1)",
+        "SUM(a, b)",
+        "SUM(a, b, ignore_missing=1)",
+        "SUM(a, b, 4, min_valid=2)",
+        "SUM(a, b, ignore_missing=1, min_valid=2)",
+        "RECODE(a, a > 1, 10, a < 0, -10, 0)",
+        "RECODE(b, b > 1, 1.5, b)",
+        "RECODE(b, b == 0, NA, 2)",
+    ],
+)
+def test_functions(model: InstanceModel, formula: str):
+    """test IF, IFMISS, FILTER, SUM (with its options) and RECODE"""
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "a / 0",
+        "b / 0",
+        "b // 0",
+        "b % 0",
+        "a // 0",
+        "a % 0",
+        "10 / b",
+        "10 // b",
+        "10 % b",
+        "a // b + a % b",
+    ],
+)
+def test_division_by_zero(model: InstanceModel, formula: str):
+    """test division and modulo by zero"""
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "a + b",
+        "IFMISS(a, 99, a)",
+        "IFMISS(n, 99, n)",
+        "SUM(a, b, ignore_missing=1)",
+        "b > 0 or a > 0",
+        "FILTER(a, b > -5)",
+    ],
+)
+def test_user_missing(model: InstanceModel, formula: str):
+    """test that the columns' missing values are treated as missing"""
+    model["a"].set_missing_values(["== 0", ">= 7"])
+    model["b"].set_missing_values(["<= -2"])
+    model["n"].set_missing_values(["== 3"])
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize("formula", ["a > 0", "b != 0 and a > -1"])
+def test_filter(model: InstanceModel, formula: str):
+    """test filter columns"""
+    compare_computed(model, formula, filter=True)
+
+
+@pytest.mark.parametrize(
+    "formula",
+    [
+        "IF(z > 1000, 1, 2)",
+        "IF(z < 10, z, -z)",
+        "z >= 50 and z < 5000",
+        "FILTER(z, z > 100)",
+        "IFMISS(z, 0, z * 2)",
+    ],
+)
+def test_zones(shared_memory_store: Store, formula: str):
+    """test formulas over many blocks, where the comparisons are known
+    for some of them from their smallest and largest values"""
+    session = SimpleNamespace(
+        modules=SimpleNamespace(add_listener=lambda listener: None)
+    )
+    model = InstanceModel(SimpleNamespace(session=session))
+    model.dataset = shared_memory_store.create_dataset()
+    model.set_log(logging.getLogger(__name__))
+    model.set_row_count(20000)
+
+    # GIVEN a column with runs of small values, large values, and missing
+    # values
+    z = model.append_column("z")
+    z.change(data_type=DataType.DECIMAL, measure_type=MeasureType.CONTINUOUS)
+    for row_no in range(20000):
+        if row_no < 6000:
+            value = float(row_no % 7)
+        elif row_no < 12000:
+            value = NAN
+        elif row_no < 16000:
+            value = 10000.0 + row_no
+        else:
+            value = float(row_no % 200)
+        z.set_value(row_no, value)
+
+    compare_computed(model, formula)
+
+
+@pytest.mark.parametrize(
+    ("source", "formulas", "measure_type", "recoded"),
+    [
+        ("n", ["== 1", "10", "== 2", "20", "$source"], MeasureType.NONE, True),
+        ("n", ["== 1", '"one"', "$source"], MeasureType.NOMINAL, True),
+        ("n", ["> 1", "1.5", "0"], MeasureType.CONTINUOUS, True),
+        ("n", ["== 3", "NA", "$source"], MeasureType.ORDINAL, True),
+        ("a", ["> 1", "10", "< 0", "-10", "$source"], MeasureType.NONE, False),
+        ("b", ["== 0", "NA", "$source * 2"], MeasureType.CONTINUOUS, False),
+    ],
+)
+def test_transforms(
+    model: InstanceModel,
+    source: str,
+    formulas: list[str],
+    measure_type: MeasureType,
+    recoded: bool,
+):
+    """test transformed columns; those of sources with levels are recoded
+    a level at a time (_recode()), and the others are evaluated in the
+    core"""
+    parent = model[source]
+
+    transform = model.append_transform("fred")
+    transform.formula = formulas
+    transform.measure_type = measure_type
+    transform.parse_formula()
+
+    column = model.append_column("jim")
+    column.column_type = ColumnType.RECODED
+    column.parent_id = parent.id
+    column.transform = transform.id
+    column.set_needs_parse()
+    column.parse_formula()
+
+    native, used = recalc(column, True)
+    if recoded:
+        assert ("recode", True) in used, "not recoded"
+    else:
+        assert ("evaluate", True) in used, "not evaluated in the core"
+    native_levels = column.levels
+
+    row_wise, _ = recalc(column, False)
+    row_wise_levels = column.levels
+
+    for row_no, (x, y) in enumerate(zip(native, row_wise)):
+        assert equals(x, y), f"row {row_no} is {x} rather than {y}"
+    assert native_levels == row_wise_levels
@@ -0,0 +1,316 @@
+"""Tests for reading and writing csv files in the core."""
+
+from os import path
+from types import SimpleNamespace
+import logging
+import math
+import csv
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import StoreFactory
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.server.dataset import ColumnType
+from jamovi.server.instancemodel import InstanceModel
+from jamovi.server.formatio import csv as csv_format
+from jamovi.server.formatio.csv import CSVReader
+
+
+NAN = float("nan")
+INF = float("inf")
+
+
+def equals(x, y) -> bool:
+    """test if two cell values are equal (nan equal to nan)"""
+    if isinstance(x, float) and isinstance(y, float):
+        if math.isnan(x):
+            return math.isnan(y)
+        return x == y
+    return x == y
+
+
+def read(temp_dir: str, file_path: str, native: bool, settings=None):
+    """reads a csv file, either as it would be (natively where it can be),
+    or in python, and returns its columns and whether it was read
+    natively"""
+    if settings is None:
+        settings = { "missings": "NA" }
+
+    name = "native.mm" if native else "python.mm"
+    store = StoreFactory.create(path.join(temp_dir, name), "shmem")
+    session = SimpleNamespace(
+        modules=SimpleNamespace(add_listener=lambda listener: None)
+    )
+    model = InstanceModel(SimpleNamespace(session=session))
+    model.dataset = store.create_dataset()
+    model.set_log(logging.getLogger(__name__))
+
+    used = []
+    read_natively = CSVReader._read_natively
+
+    def spy(self, *args):
+        result = read_natively(self, *args) if native else False
+        used.append(result)
+        return result
+
+    try:
+        with pytest.MonkeyPatch.context() as mp:
+            mp.setattr(CSVReader, "_read_natively", spy)
+            CSVReader(settings).read_into(model, file_path, lambda p: None)
+
+        columns = [
+            (
+                column.name,
+                column.data_type,
+                column.measure_type,
+                column.dps,
+                column.levels,
+                [column.get_value(i) for i in range(model.row_count)],
+            )
+            for column in model
+        ]
+    finally:
+        store.close()
+
+    return columns, any(used)
+
+
+def compare(temp_dir: str, content: bytes, native: bool = True, settings=None):
+    """test that a csv file is read the same natively as in python; native
+    is whether it's expected to be read natively"""
+    file_path = path.join(temp_dir, "fred.csv")
+    with open(file_path, "wb") as file:
+        file.write(content)
+
+    expected, _ = read(temp_dir, file_path, False, settings)
+    actual, read_natively = read(temp_dir, file_path, True, settings)
+
+    assert read_natively == native
+
+    assert len(actual) == len(expected)
+    for actual_column, expected_column in zip(actual, expected):
+        assert actual_column[:5] == expected_column[:5]
+        actual_values = actual_column[5]
+        expected_values = expected_column[5]
+        assert len(actual_values) == len(expected_values)
+        for row_no, (x, y) in enumerate(zip(actual_values, expected_values)):
+            assert equals(x, y), f"{actual_column[0]}: row {row_no} is {x!r} rather than {y!r}"
+
+
+def test_read_types(temp_dir: str):
+    """test the columns' types, levels and values"""
+    content = (
+        b"int,dec,text,missing,mixed\n"
+        b"1,2.5,fred,NA,1\n"
+        b"3,,jim,,2.25\n"
+        b"-7,1e3,\"bob, jim\",NA,x\n"
+        b"  4 ,  .125,\xc3\xa9t\xc3\xa9, ,3\n"
+    )
+    compare(temp_dir, content)
+
+
+@pytest.mark.parametrize("line_ending", [b"\n", b"\r\n", b"\r"])
+def test_read_line_endings(temp_dir: str, line_ending: bytes):
+    """test CR and CRLF line endings, and in quoted fields"""
+    rows = [
+        b"a,b,c",
+        b'1,"fred\r\njim",2.5',
+        b'2,"bob\rjim",3.5',
+        b'3,"\n",',
+        b'4,"x""y""",7',
+    ]
+    compare(temp_dir, line_ending.join(rows) + line_ending)
+
+
+@pytest.mark.parametrize(
+    "content",
+    [
+        b"a,b\n1,2\n3,4\n\n\n",
+        b"a,b\n1,2\n3,4\n,\n,\n",
+        b"a,b\n1,2\n3,4\r\n\r\n",
+        b"a,b\n1,2\n\n3,4\n",
+        b"a,b\n1,2\n3,4",
+        b"a,b\n1\n2,3,4\n",
+    ],
+)
+def test_read_empty_rows(temp_dir: str, content: bytes):
+    """test trailing empty rows, and rows with too few or many cells"""
+    compare(temp_dir, content)
+
+
+def test_read_euro_decimals(temp_dir: str):
+    """test decimals with commas"""
+    content = (
+        b"a;b;c\n"
+        b'"1,5";2,25;1\n'
+        b'"-3,125";"4";2,5\n'
+        b"7;;x\n"
+    )
+    compare(temp_dir, content)
+
+
+@pytest.mark.parametrize(
+    "values",
+    [
+        [b"2147483647", b"-2147483647", b"0"],
+        [b"2147483648", b"1"],
+        [b"-2147483648", b"1"],
+        [b"-2147483649", b"1"],
+        [b"99999999999999999999", b"1"],
+        [b"007", b"+3", b"1_000"],
+    ],
+)
+def test_read_int_bounds(temp_dir: str, values: list[bytes]):
+    """test integers at and beyond those a column can hold"""
+    compare(temp_dir, b"a\n" + b"\n".join(values) + b"\n")
+
+
+def test_read_chunks(temp_dir: str):
+    """test files of several chunks, where the chunks start in quoted
+    fields with new lines (and text which looks like rows)"""
+    rows = [b"id,text,value"]
+    row_no = 0
+    size = 0
+    while size < 5 * 1024 * 1024:
+        lines = b"\n".join(b"%d,fake,%d.5" % (i, row_no) for i in range(row_no % 700))
+        if row_no % 3 == 0:
+            lines = lines.replace(b"\n", b"\r\n")
+        row = b'%d,"%s ""quoted""",%d.25' % (row_no, lines, row_no)
+        rows.append(row)
+        size += len(row) + 1
+        row_no += 1
+    compare(temp_dir, b"\n".join(rows) + b"\n")
+
+
+@pytest.mark.parametrize(
+    "content",
+    [
+        b"a\tb\tc\n1\t'x\ty'\t2.5\n3\t'it''s'\t\n",
+        b"a, b, c\n1, 'x, y', 2.5\n3,  'z',4\n",
+        b"a;b;c\n1;\"x;y\";2\n",
+    ],
+)
+def test_read_dialects(temp_dir: str, content: bytes):
+    """test the delimiters, quotes and spaces the sniffer finds"""
+    compare(temp_dir, content)
+
+
+def test_read_bom(temp_dir: str):
+    """test a file with a BOM, which the core skips as utf-8-sig does"""
+    compare(temp_dir, b"\xef\xbb\xbfa,b\n1,2\n")
+
+
+@pytest.mark.parametrize(
+    "content",
+    [
+        b"a,b\n1,\x002\n3,4\n",  # a NUL
+        "a,b\n1,\xe9t\xe9\n".encode("latin-1"),  # not utf-8
+        b"a,b\n1,2\n3,\xff\xfe\n",  # invalid utf-8
+    ],
+)
+def test_read_fallback(temp_dir: str, content: bytes):
+    """test files which are read in python"""
+    compare(temp_dir, content, native=False)
+
+
+def test_read_fallback_missings(temp_dir: str):
+    """test missing values other than one string are read in python"""
+    compare(temp_dir, b"a,b\n1,2\n-99,4\n", native=False, settings={ "missings": None })
+
+
+def test_read_fallback_dialect(temp_dir: str, monkeypatch: pytest.MonkeyPatch):
+    """test dialects the core doesn't reproduce are read in python"""
+    sniff = csv.Sniffer.sniff
+
+    def sniff_escaped(self, *args, **kwargs):
+        dialect = sniff(self, *args, **kwargs)
+        dialect.escapechar = "\\"
+        return dialect
+
+    monkeypatch.setattr(csv.Sniffer, "sniff", sniff_escaped)
+    compare(temp_dir, b'a,b\n1,"x\\"y"\n2,z\\,w\n', native=False)
+
+
+def test_read_long_field(temp_dir: str):
+    """test fields longer than python's csv module allows are left to it"""
+    file_path = path.join(temp_dir, "fred.csv")
+    with open(file_path, "wb") as file:
+        file.write(b'a,b\n1,"' + b"x" * (csv.field_size_limit() + 1) + b'"\n')
+
+    with pytest.raises(csv.Error):
+        read(temp_dir, file_path, True)
+
+
+def test_write(shared_memory_store: Store, temp_dir: str):
+    """test that the core writes the same bytes as python"""
+    session = SimpleNamespace(
+        modules=SimpleNamespace(add_listener=lambda listener: None)
+    )
+    model = InstanceModel(SimpleNamespace(session=session))
+    model.dataset = shared_memory_store.create_dataset()
+    model.set_log(logging.getLogger(__name__))
+    row_count = 3000
+    model.set_row_count(row_count)
+
+    # GIVEN a filter, columns of each type (with missing values, nan and
+    # inf, quotes, commas and new lines), text with labels other than
+    # its values, and a virtual column
+    filter = model.append_column("Filter 1")
+
+    columns = [
+        ("int", DataType.INTEGER, MeasureType.CONTINUOUS,
+            [1, -2, -2147483648, 0, 2147483647, -2147483647]),
+        ("dec", DataType.DECIMAL, MeasureType.CONTINUOUS,
+            [0.1, NAN, INF, -INF, 1e20, -0.0, 1 / 3, 2.5e-8, 123456.789, 1.0]),
+        ("nom", DataType.INTEGER, MeasureType.NOMINAL,
+            [1, 2, 3, -2147483648]),
+        ("id", DataType.TEXT, MeasureType.ID,
+            ['i"d', "", "x,y", "z\nw", "q", "\u00e9"]),
+    ]
+    for name, data_type, measure_type, values in columns:
+        column = model.append_column(name)
+        column.change(data_type=data_type, measure_type=measure_type)
+        for row_no in range(row_count):
+            column.set_value(row_no, values[row_no % len(values)])
+
+    labels = ['a "b"', "c,d", "e\nf", "g", "h", "\u00e9", " "]
+    text = model.append_column('te"xt')
+    text.change(data_type=DataType.TEXT, measure_type=MeasureType.NOMINAL)
+    for value, label in enumerate(labels):
+        text.append_level(value, label, label)
+    for row_no in range(row_count):
+        text.set_value(row_no, (labels + [""])[row_no % (len(labels) + 1)])
+    text.change(
+        levels=[
+            (value, "label " + label if label == "g" else label, import_value, pinned)
+            for value, label, import_value, pinned in text.levels
+        ]
+    )
+
+    model.append_column("virtual")
+
+    filter.column_type = ColumnType.FILTER
+    filter.formula = "ROW() % 3 != 0 and `dec` != 0.1"
+    filter.parse_formula()
+    filter.set_needs_recalc()
+    filter.recalc()
+    model.refresh_filter_state()
+    assert model.row_count_ex_filtered < row_count
+
+    # WHEN writing it in the core, and in python
+    native_path = path.join(temp_dir, "native.csv")
+    python_path = path.join(temp_dir, "python.csv")
+    csv_format.write(model, native_path, lambda p: None)
+    with pytest.MonkeyPatch.context() as mp:
+        mp.setattr(csv_format, "DataSet", type("NotDataSet", (), { }))
+        csv_format.write(model, python_path, lambda p: None)
+
+    # THEN the files are the same
+    with open(native_path, "rb") as file:
+        native = file.read()
+    with open(python_path, "rb") as file:
+        python = file.read()
+
+    assert native == python
@@ -0,0 +1,144 @@
+"""Tests for importing the values read from a data file a batch at a time."""
+
+from numbers import Number
+from datetime import date
+import math
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+
+
+NAN = float("nan")
+NAN_INT = -2147483648
+TIME_START = date(1970, 1, 1)
+
+
+def handle_value(column, row_index, value):
+    """sets a value a row at a time, as the readstat parser did before
+    import_values()"""
+    vt = type(value)
+
+    if column.data_type is DataType.TEXT:
+        if value is not None:
+            if vt is not str:
+                value = str(value)
+            if column.has_levels:
+                if not column.has_level(value):
+                    column.append_level(
+                        column.level_count,
+                        value,
+                        value,
+                        pinned=False)
+                if column.level_count > 50:
+                    column.change(measure_type=MeasureType.ID)
+            column.set_value(row_index, value)
+        else:
+            column.set_value(row_index, '')
+    elif (column.measure_type is MeasureType.NOMINAL
+            or column.measure_type is MeasureType.ORDINAL):
+        if isinstance(value, Number):
+            if not math.isclose(float(value) % 1.0, 0.0):
+                column.change(data_type=DataType.DECIMAL)
+                handle_value(column, row_index, value)
+                return
+
+            try:
+                value = int(value)
+                if value.bit_length() > 32:
+                    raise Exception()
+            except Exception:
+                column.change(
+                    data_type=DataType.DECIMAL,
+                    measure_type=MeasureType.CONTINUOUS)
+            column.set_value(row_index, value)
+        elif vt is date:
+            delta = value - TIME_START
+            ul_value = delta.days
+            if not column.has_level(ul_value):
+                column.insert_level(ul_value, value.isoformat(), str(ul_value))
+            column.set_value(row_index, ul_value)
+        else:
+            column.set_value(row_index, -2147483648)
+    elif column.data_type is DataType.DECIMAL:
+        if isinstance(value, Number):
+            column.set_value(row_index, float(value))
+        else:
+            column.set_value(row_index, float('nan'))
+    elif column.data_type is DataType.INTEGER:
+        if isinstance(value, Number):
+            column.set_value(row_index, int(value))
+        else:
+            column.set_value(row_index, -2147483648)
+
+
+WORDS = [f"word {i}" for i in range(60)]
+
+
+@pytest.mark.parametrize(
+    ("data_type", "measure_type", "values"),
+    [
+        # dates become levels, among integers and missings
+        (DataType.INTEGER, MeasureType.NOMINAL,
+            [date(2020, 1, 3), 5, None, date(1969, 12, 31), date(2020, 1, 3), "x", 3.0]),
+        (DataType.INTEGER, MeasureType.ORDINAL,
+            [date(2001, 1, 1) if i % 3 else date(2000, 6, 1) for i in range(40)]),
+        # nominal becomes decimal at the first value which isn't an integer
+        (DataType.INTEGER, MeasureType.NOMINAL,
+            [1, 2, None, 3, 2.5, 7, None, -1.25, 4]),
+        (DataType.INTEGER, MeasureType.NOMINAL,
+            [1, 2, 3, 1, 2, 3, 1, 2, 3, 1, 2, 3, 0.5]),
+        # or isn't an int32
+        (DataType.INTEGER, MeasureType.NOMINAL,
+            [1, 2, 2 ** 40, 3, None]),
+        (DataType.INTEGER, MeasureType.ORDINAL,
+            [2147483647, -2147483647, 5, -(2 ** 40)]),
+        # text becomes an ID past 50 levels
+        (DataType.TEXT, MeasureType.NOMINAL,
+            [WORDS[i % 60] if i % 13 else None for i in range(200)]),
+        (DataType.TEXT, MeasureType.NOMINAL,
+            [WORDS[i % 50] for i in range(120)] + ["fred", 3, 2.5, None]),
+        (DataType.TEXT, MeasureType.NOMINAL,
+            ["b", "a", None, 1, 2.5, "", "b"]),
+        (DataType.TEXT, MeasureType.ID,
+            ["b", None, 7, "", "c"]),
+        (DataType.DECIMAL, MeasureType.CONTINUOUS,
+            [1, 2.5, None, "x", -0.125, 2 ** 40]),
+        (DataType.INTEGER, MeasureType.CONTINUOUS,
+            [1, None, -7, "x", 2147483647]),
+    ],
+)
+@pytest.mark.parametrize("batch_size", [1, 4, 1000])
+def test_import_values(
+    shared_memory_store: Store,
+    data_type: DataType,
+    measure_type: MeasureType,
+    values: list,
+    batch_size: int,
+):
+    """test that importing values a batch at a time is the same as setting
+    them a value at a time, as the readstat parser did"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(len(values))
+
+    imported = ds.append_column("imported")
+    imported.change(data_type=data_type, measure_type=measure_type)
+    one_at_a_time = ds.append_column("one at a time")
+    one_at_a_time.change(data_type=data_type, measure_type=measure_type)
+
+    # WHEN importing the values in batches, and one at a time
+    for start in range(0, len(values), batch_size):
+        imported.import_values(start, values[start:start + batch_size])
+    for row_index, value in enumerate(values):
+        handle_value(one_at_a_time, row_index, value)
+
+    # THEN the columns are the same
+    assert imported.data_type is one_at_a_time.data_type
+    assert imported.measure_type is one_at_a_time.measure_type
+    assert imported.levels == one_at_a_time.levels
+    for row_index in range(len(values)):
+        x = imported.get_value(row_index)
+        y = one_at_a_time.get_value(row_index)
+        assert x == y or (x != x and y != y), f"row {row_index} is {x!r} rather than {y!r}"
@@ -0,0 +1,135 @@
+"""Tests for storing int cells in 1, 2 or 4 bytes."""
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.server.jamovi_pb2 import DataSetRR
+
+
+NAN_INT = -2147483648
+ROW_COUNT = 70000  # a few blocks, at each size
+
+
+def check(ds, column, values: list):
+    """test that raw(), get_value() and fetch_block() each return values"""
+    assert [column.raw(i) for i in range(ROW_COUNT)] == values
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == values
+
+    _, _, cells = ds.fetch_block(0, ROW_COUNT, [column.id], False)
+    block = DataSetRR.DataBlock()
+    block.MergeFromString(cells)
+    fetched = [
+        cell.i if cell.WhichOneof("type") == "i" else NAN_INT
+        for cell in block.values
+    ]
+    assert fetched == values
+
+
+@pytest.fixture
+def ints(shared_memory_store: Store):
+    """a data set with an integer column of small values (and missings)"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(ROW_COUNT)
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.CONTINUOUS)
+    values = [NAN_INT if i % 11 == 0 else i % 100 - 50 for i in range(ROW_COUNT)]
+    column.import_values(0, values)
+    return ds, column, values
+
+
+@pytest.mark.parametrize(
+    ("value", "size"),
+    [
+        (127, 1),
+        (-127, 1),
+        (128, 2),
+        (-128, 2),
+        (32767, 2),
+        (-32767, 2),
+        (32768, 4),
+        (-32768, 4),
+        (2147483647, 4),
+        (-2147483647, 4),
+        (NAN_INT, 1),
+    ],
+)
+def test_widen(ints, value: int, size: int):
+    """test that cells are widened in place for the values which need it;
+    -128 and -32768 are the narrow missing values, so need wider cells"""
+    ds, column, values = ints
+    assert column.int_size == 1
+
+    # WHEN setting a value in the last block, and one in the first
+    for row_no in (ROW_COUNT - 3, 5):
+        column.set_value(row_no, value)
+        values[row_no] = value
+
+    # THEN the cells are as wide as the value needs, and keep their values
+    assert column.int_size == size
+    check(ds, column, values)
+
+
+def test_widen_twice(ints):
+    """test widening from 1 byte to 2, then to 4"""
+    ds, column, values = ints
+
+    for value, size in ((300, 2), (-70000, 4), (5, 4)):
+        row_no = (value * 7) % ROW_COUNT
+        column.set_value(row_no, value)
+        values[row_no] = value
+        assert column.int_size == size
+        check(ds, column, values)
+
+
+def test_narrow_type_change(ints):
+    """test cells are narrowed where the whole column is rewritten, by a
+    change of type"""
+    ds, column, values = ints
+
+    # GIVEN a column widened to 4 bytes, where the value which needed it
+    # has since been overwritten
+    column.set_value(7, 100000)
+    column.set_value(7, 3)
+    values[7] = 3
+    assert column.int_size == 4
+
+    # WHEN changing it to nominal
+    column.change(measure_type=MeasureType.NOMINAL)
+
+    # THEN it's narrowed
+    assert column.int_size == 1
+    check(ds, column, values)
+
+    # AND changing it back to continuous, from wider values
+    column.set_value(9, -40000)
+    values[9] = -40000
+    assert column.int_size == 4
+    column.set_value(9, 200)
+    values[9] = 200
+    column.change(measure_type=MeasureType.CONTINUOUS)
+    assert column.int_size == 2
+    check(ds, column, values)
+
+
+def test_narrow_recode(ints):
+    """test cells are narrowed where the whole column is rewritten, by
+    recode()"""
+    ds, source, source_values = ints
+
+    # GIVEN a column of wide values
+    column = ds.append_column("jim")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.CONTINUOUS)
+    column.import_values(0, [1000000] * ROW_COUNT)
+    assert column.int_size == 4
+
+    # WHEN recoding it from a column of small values
+    distinct = sorted(set(source_values))
+    to_values = [NAN_INT if v == NAN_INT else -v for v in distinct]
+    column.recode(source, distinct, to_values)
+
+    # THEN it's narrowed
+    recoded = [NAN_INT if v == NAN_INT else -v for v in source_values]
+    assert column.int_size == 1
+    check(ds, column, recoded)
@@ -0,0 +1,235 @@
+"""Tests for setting and trimming the levels of columns."""
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.server.dataset import ColumnType
+
+
+NAN_INT = -2147483648
+ROW_COUNT = 1000
+
+
+@pytest.fixture
+def ds(shared_memory_store: Store):
+    """a data set with a filter, which filters out every third row"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(ROW_COUNT)
+
+    filter = ds.append_column("Filter 1")
+    filter.column_type = ColumnType.FILTER
+    filter.change(data_type=DataType.INTEGER, measure_type=MeasureType.CONTINUOUS)
+    for row_no in range(ROW_COUNT):
+        filter.set_value(row_no, 0 if row_no % 3 == 0 else 1)
+    ds.refresh_filter_state()
+    assert ds.row_count_ex_filtered < ROW_COUNT
+
+    return ds
+
+
+def check_counts(ds, column):
+    """test that the level counts kept as the cells are set are the same as
+    those counted afresh"""
+    counts = column.level_counts()
+    ds.refresh_filter_state()  # recounts the levels
+    assert column.level_counts() == counts
+
+
+def text_column(ds, labels: list[str], cells: list):
+    """a text column with a level for each label (its own import value),
+    and the cells set to cells (labels, or '' for missing), repeated"""
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.TEXT, measure_type=MeasureType.NOMINAL)
+    for value, label in enumerate(labels):
+        column.append_level(value, label, label)
+    for row_no in range(ROW_COUNT):
+        column.set_value(row_no, cells[row_no % len(cells)])
+    check_counts(ds, column)
+    return column
+
+
+def test_set_levels_text(ds):
+    """test reordering and relabelling the levels of a text column, where
+    levels are dropped, and new levels share an import value"""
+    cells = ["a", "b", "", "c", "d", "b", "a"]
+    column = text_column(ds, ["a", "b", "c", "d"], cells)
+
+    # WHEN reordering and relabelling the levels; without d, and with two
+    # levels for b (the cells take the last)
+    column.set_levels(
+        [
+            (0, "C", "c", False),
+            (1, "A", "a", False),
+            (2, "B1", "b", False),
+            (3, "B2", "b", False),
+            (4, "E", "e", True),
+        ]
+    )
+
+    # THEN the cells have the new labels of their levels (d's becoming the
+    # first level's), and the unused levels are trimmed unless pinned
+    relabel = { "a": "A", "b": "B2", "c": "C", "d": "C", "": "" }
+    expected = [relabel[cells[row_no % len(cells)]] for row_no in range(ROW_COUNT)]
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == expected
+    assert column.levels == [
+        (0, "C", "c", False),
+        (1, "A", "a", False),
+        (2, "B2", "b", False),
+        (3, "E", "e", True),
+    ]
+    check_counts(ds, column)
+
+
+def test_set_levels_text_duplicate_imports(ds):
+    """test setting the levels of a text column with old levels which share
+    an import value"""
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.TEXT, measure_type=MeasureType.NOMINAL)
+    column.append_level(0, "x", "same")
+    column.append_level(1, "y", "same")
+    column.append_level(2, "z", "other")
+    for row_no in range(ROW_COUNT):
+        column.set_value(row_no, ["x", "y", "z", ""][row_no % 4])
+
+    # WHEN setting levels of the import values
+    column.set_levels([(0, "O", "other", False), (1, "S", "same", False)])
+
+    # THEN the cells of the first old level of an import value take the
+    # new level, and those of the others take the first level
+    relabel = { "x": "S", "y": "O", "z": "O", "": "" }
+    expected = [relabel[["x", "y", "z", ""][row_no % 4]] for row_no in range(ROW_COUNT)]
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == expected
+    check_counts(ds, column)
+
+
+def test_set_levels_integer(ds):
+    """test setting the levels of an integer column, where cells are left
+    without a level"""
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.NOMINAL)
+    cells = [5, 1, NAN_INT, 300, -7, 1, 2]
+    for row_no in range(ROW_COUNT):
+        column.set_value(row_no, cells[row_no % len(cells)])
+    check_counts(ds, column)
+
+    # WHEN setting levels for some of the values, relabelled and out of
+    # order, and a pinned level without cells
+    column.set_levels(
+        [
+            (300, "three hundred", "300", False),
+            (1, "one", "1", False),
+            (9, "nine", "9", True),
+            (4, "four", "4", False),
+        ]
+    )
+
+    # THEN the cells keep their values, those without a level are given
+    # one, and the unused levels are trimmed unless pinned
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == [
+        cells[row_no % len(cells)] for row_no in range(ROW_COUNT)
+    ]
+    levels = column.levels
+    assert levels[:3] == [
+        (300, "three hundred", "300", False),
+        (1, "one", "1", False),
+        (9, "nine", "9", True),
+    ]
+    assert sorted(levels[3:]) == [
+        (-7, "-7", "-7", False),
+        (2, "2", "2", False),
+        (5, "5", "5", False),
+    ]
+    check_counts(ds, column)
+
+
+def test_build_levels_counts(ds):
+    """test the counts of levels built at once, for cells set beforehand"""
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.NOMINAL)
+    column.import_values(0, [(i * 7) % 13 if i % 5 else None for i in range(ROW_COUNT)])
+
+    column.build_levels([(v, f"level {v}", None, False) for v in range(13, -1, -1)])
+
+    assert [level[0] for level in column.levels] == list(range(13, -1, -1))
+    check_counts(ds, column)
+
+
+def check_text_levels(ds, column, expected: list[str]):
+    """test that the levels of a text column have the values 0..n-1, and
+    the cells have the labels expected"""
+    levels = column.levels
+    for value, level in enumerate(levels):
+        assert column.get_label(value) == level[1]
+    for row_no in range(ROW_COUNT):
+        raw = column.raw(row_no)
+        assert raw == NAN_INT or 0 <= raw < len(levels)
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == expected
+    check_counts(ds, column)
+
+
+def test_trim_unused_levels(ds):
+    """test trimming unused levels among used ones, and pinned ones"""
+    # GIVEN a text column with levels without cells, among those with
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.TEXT, measure_type=MeasureType.NOMINAL)
+    for value in range(12):
+        label = f"level {value}"
+        column.append_level(value, label, label, pinned=(value == 7))
+    cells = ["level 2", "level 3", "", "level 5", "level 9", "level 3", "level 11"]
+    for row_no in range(ROW_COUNT):
+        column.set_value(row_no, cells[row_no % len(cells)])
+    expected = [cells[row_no % len(cells)] for row_no in range(ROW_COUNT)]
+    check_text_levels(ds, column, expected)
+
+    # WHEN trimming them
+    column.trim_unused_levels()
+
+    # THEN the levels without cells are gone, unless pinned, and the cells
+    # keep their labels
+    assert [level[1] for level in column.levels] == [
+        "level 2", "level 3", "level 5", "level 7", "level 9", "level 11"
+    ]
+    check_text_levels(ds, column, expected)
+
+
+def test_trim_unused_levels_integer(ds):
+    """test trimming the unused levels of an integer column leaves the
+    others' values as they are"""
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.NOMINAL)
+    for value in range(10):
+        column.append_level(value * 10, str(value * 10))
+    cells = [20, 50, NAN_INT, 90, 20]
+    for row_no in range(ROW_COUNT):
+        column.set_value(row_no, cells[row_no % len(cells)])
+
+    column.trim_unused_levels()
+
+    assert [level[0] for level in column.levels] == [20, 50, 90]
+    assert [column.get_value(i) for i in range(ROW_COUNT)] == [
+        cells[row_no % len(cells)] for row_no in range(ROW_COUNT)
+    ]
+    check_counts(ds, column)
+
+
+@pytest.mark.parametrize("new_label", ["", "a", "b"])
+def test_remove_level(ds, new_label: str):
+    """test that a level is removed where the last of its cells is set to
+    another value, and the levels above it come down"""
+    column = text_column(ds, ["a", "b", "c", "d", "e"], ["a", "b", "d", "e", ""])
+
+    # GIVEN c with a single cell
+    column.set_value(7, "c")
+    check_counts(ds, column)
+    assert len(column.levels) == 5
+
+    # WHEN setting the cell to another (lower) level, or missing
+    column.set_value(7, new_label)
+
+    # THEN c is removed, and the cells keep their labels
+    assert [level[1] for level in column.levels] == ["a", "b", "d", "e"]
+    expected = [["a", "b", "d", "e", ""][row_no % 5] for row_no in range(ROW_COUNT)]
+    expected[7] = new_label
+    check_text_levels(ds, column, expected)
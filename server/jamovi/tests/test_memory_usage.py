@@ -0,0 +1,52 @@
+"""Tests for the memory usage of a data set."""
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+
+
+def test_inserted_levels_not_orphaned(shared_memory_store: Store):
+    """test that the text of levels is counted after inserting levels"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(6)
+
+    # GIVEN a column with levels appended
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.INTEGER, measure_type=MeasureType.NOMINAL)
+    for value in (0, 2, 3):
+        column.append_level(value, str(value))
+
+    assert ds.memory_usage().orphaned == 0
+
+    # WHEN inserting a level, which moves the others along
+    column.insert_level(1, "a much longer label than the others")
+
+    # THEN the bytes of the map are all accounted for
+    report = ds.memory_usage()
+    assert report.orphaned == 0
+    assert report.live == report.used
+
+
+def test_built_levels_not_orphaned(shared_memory_store: Store):
+    """test that the text of levels set at once is counted"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(6)
+
+    # GIVEN a text column
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.TEXT, measure_type=MeasureType.NOMINAL)
+
+    # WHEN setting its levels at once (with text of odd lengths, and
+    # pinned, so they're kept without cells)
+    column.set_levels(
+        [
+            (0, "a", "a", True),
+            (1, "bbb", "bbb", True),
+            (2, "cc", "cc", True),
+        ]
+    )
+
+    # THEN the bytes of the map are all accounted for
+    report = ds.memory_usage()
+    assert report.orphaned == 0
+    assert report.live == report.used
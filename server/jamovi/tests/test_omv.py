@@ -0,0 +1,223 @@
+"""Tests for writing and reading .omv files natively from the core."""
+
+from os import path
+from types import SimpleNamespace
+import json
+import logging
+import math
+import zipfile
+
+import pytest
+
+from jamovi.server.dataset import StoreFactory
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.server.instancemodel import InstanceModel
+from jamovi.server.formatio import omv
+
+
+NAN = float("nan")
+INF = float("inf")
+NAN_INT = -2147483648
+ROW_COUNT = 5000
+
+
+@pytest.fixture(autouse=True)
+def small_chunks(monkeypatch: pytest.MonkeyPatch):
+    """data.bin written in chunks small enough for it to take several,
+    with the columns split across them"""
+    monkeypatch.setattr(omv, "CHUNK_SIZE", 16381)
+
+
+class NotNative:
+    """a core data set without export_column_data() and
+    import_column_data(), so the .omv is written and read in python"""
+
+    def __init__(self, dataset):
+        self._dataset = dataset
+
+    def __getattr__(self, name):
+        if name in ("export_column_data", "import_column_data"):
+            raise AttributeError(name)
+        return getattr(self._dataset, name)
+
+    def __iter__(self):
+        return iter(self._dataset)
+
+    def __getitem__(self, index_or_name):
+        return self._dataset[index_or_name]
+
+
+def create_model(temp_dir: str, name: str, native: bool):
+    """an empty model, with its own store"""
+    store = StoreFactory.create(path.join(temp_dir, name + ".mm"), "shmem")
+    session = SimpleNamespace(
+        modules=SimpleNamespace(add_listener=lambda listener: None)
+    )
+    model = InstanceModel(SimpleNamespace(session=session))
+    dataset = store.create_dataset()
+    model.dataset = dataset if native else NotNative(dataset)
+    model.set_log(logging.getLogger(__name__))
+    return model, store
+
+
+COLUMNS = [
+    ("int", DataType.INTEGER, MeasureType.CONTINUOUS,
+        [1, NAN_INT, -2147483647, 2147483647, 0, -5]),
+    ("nominal", DataType.INTEGER, MeasureType.NOMINAL,
+        [3, -1000000, NAN_INT, 70000, 2147483647, 3]),
+    ("decimal", DataType.DECIMAL, MeasureType.CONTINUOUS,
+        [0.1, NAN, -0.0, INF, -INF, 1e300, -2.5e-300, 0.0]),
+    ("text", DataType.TEXT, MeasureType.NOMINAL,
+        ["fred", "", "jim", "été", "fred"]),
+]
+
+ID_COLUMNS = [
+    ("id", DataType.TEXT, MeasureType.ID,
+        ["a1", "", "été", "b2", "", "x" * 300, "c"]),
+    ("empty id", DataType.TEXT, MeasureType.ID, [""]),
+]
+
+
+def cells(values: list) -> list:
+    """the values, repeated over the rows"""
+    return [values[(i * 7 + i // 5) % len(values)] for i in range(ROW_COUNT)]
+
+
+def populate(model, id_columns: bool = True):
+    """columns of each type, with missing values, INT_MIN, sparse level
+    values, nan and -0.0"""
+    model.set_row_count(ROW_COUNT)
+
+    for name, data_type, measure_type, values in COLUMNS + (ID_COLUMNS if id_columns else []):
+        column = model.append_column(name)
+        column.change(data_type=data_type, measure_type=measure_type)
+        if data_type is DataType.TEXT and measure_type is MeasureType.NOMINAL:
+            for row_no, value in enumerate(cells(values)):
+                column.set_value(row_no, value)
+        else:
+            model.dataset[name].import_values(0, cells(values))
+        column.determine_dps()
+
+
+def contents(model) -> list:
+    """the columns of the model; their names, types, levels and values"""
+    columns = [ ]
+    for column in model:
+        values = [ ]
+        for row_no in range(model.row_count):
+            value = column.get_value(row_no)
+            if isinstance(value, float):
+                # nan and -0.0 are compared by their representation
+                value = "nan" if math.isnan(value) else repr(value)
+            values.append(value)
+        columns.append((
+            column.name,
+            column.data_type,
+            column.measure_type,
+            column.levels,
+            column.dps,
+            values,
+        ))
+    return columns
+
+
+def write(temp_dir: str, name: str, native: bool, id_columns: bool = True) -> str:
+    """writes an .omv file of the populated model"""
+    model, store = create_model(temp_dir, "write " + name, native)
+    try:
+        populate(model, id_columns)
+        file_path = path.join(temp_dir, name + ".omv")
+        omv.write(model, file_path, lambda p: None)
+    finally:
+        store.close()
+    return file_path
+
+
+def read(temp_dir: str, file_path: str, native: bool) -> list:
+    """reads an .omv file, and returns its contents"""
+    name = "read " + path.basename(file_path) + (" native" if native else " python")
+    model, store = create_model(temp_dir, name, native)
+    try:
+        omv.read(model, file_path, lambda p: None)
+        return contents(model)
+    finally:
+        store.close()
+
+
+def entries(file_path: str) -> dict:
+    """the entries of the cells in an .omv file"""
+    with zipfile.ZipFile(file_path) as archive:
+        assert archive.testzip() is None
+        names = archive.namelist()
+        return { name: archive.read(name) for name in ("data.bin", "strings.bin") if name in names }
+
+
+def test_write(temp_dir: str):
+    """test the cells are written natively the same as in python"""
+    native = write(temp_dir, "native", True)
+    python = write(temp_dir, "python", False)
+
+    native_entries = entries(native)
+    python_entries = entries(python)
+    assert set(native_entries) == { "data.bin", "strings.bin" }
+    assert native_entries == python_entries
+
+
+@pytest.mark.parametrize("write_natively", [True, False])
+def test_read(temp_dir: str, write_natively: bool):
+    """test a file is read natively the same as in python, and the same as
+    it was written"""
+    file_path = write(temp_dir, "fred", write_natively)
+
+    native = read(temp_dir, file_path, True)
+    python = read(temp_dir, file_path, False)
+
+    assert len(native) == len(python)
+    for native_column, python_column in zip(native, python):
+        assert native_column == python_column, native_column[0]
+
+    model, store = create_model(temp_dir, "expected", True)
+    try:
+        populate(model)
+        expected = contents(model)
+    finally:
+        store.close()
+
+    for native_column, expected_column in zip(native, expected):
+        assert native_column == expected_column, native_column[0]
+
+
+def test_read_without_strings(temp_dir: str):
+    """test a file without a strings table, where an integer column is
+    read as ID text"""
+    file_path = write(temp_dir, "fred", True, id_columns=False)
+
+    # GIVEN a file where the integer column is marked as ID text
+    with zipfile.ZipFile(file_path) as archive:
+        items = [(info, archive.read(info.filename)) for info in archive.infolist()]
+    assert "strings.bin" not in [info.filename for info, _ in items]
+
+    with zipfile.ZipFile(file_path, "w", zipfile.ZIP_DEFLATED) as archive:
+        for info, content in items:
+            if info.filename == "metadata.json":
+                metadata = json.loads(content)
+                for field in metadata["dataSet"]["fields"]:
+                    if field["name"] == "int":
+                        field["dataType"] = "Text"
+                        field["measureType"] = "ID"
+                        field["type"] = "string"
+                content = json.dumps(metadata)
+            archive.writestr(info, content)
+
+    # WHEN reading it
+    native = read(temp_dir, file_path, True)
+    python = read(temp_dir, file_path, False)
+
+    # THEN its values are the integers as text
+    for native_column, python_column in zip(native, python):
+        assert native_column == python_column, native_column[0]
+
+    int_column = native[0]
+    assert int_column[:3] == ("int", DataType.TEXT, MeasureType.ID)
+    assert int_column[5] == ["" if v == NAN_INT else str(v) for v in cells(COLUMNS[0][3])]
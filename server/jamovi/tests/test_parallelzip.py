@@ -0,0 +1,66 @@
+"""Tests for writing zip entries deflated concurrently."""
+
+from os import path
+import random
+import zipfile
+
+import pytest
+
+from jamovi.server.utils import parallelzip
+from jamovi.server.utils.parallelzip import write_deflated
+
+
+def entries() -> list[tuple[str, bytes, int]]:
+    """the entries to write; (name, content, chunk size), where a chunk
+    size of 0 is written with writestr()"""
+    rng = random.Random(1)
+    noise = rng.randbytes(300000)
+    text = b"".join(b"row %d,%d,fred\n" % (i, i * 7 % 13) for i in range(200000))
+    return [
+        ("first.json", b'{"fred": 1}', 0),
+        ("data.bin", text + noise + text, 65536),
+        ("one chunk", text[:1000], 4096),
+        ("empty", b"", 1024),
+        ("between", b"jim" * 1000, 0),
+        ("uneven chunks", noise[:99999], 777),
+        ("empty writestr", b"", 0),
+    ]
+
+
+def chunked(content: bytes, size: int):
+    """the content in chunks of size; each a buffer of its own, with empty
+    chunks among them"""
+    yield bytearray()
+    for start in range(0, len(content), size):
+        yield memoryview(bytearray(content[start:start + size]))
+        if start % (size * 5) == 0:
+            yield b""
+
+
+@pytest.mark.parametrize("workers", [1, 4])
+@pytest.mark.parametrize("internals", [True, False])
+def test_write_deflated(temp_dir: str, monkeypatch: pytest.MonkeyPatch, workers: int, internals: bool):
+    """test entries written with write_deflated(), among ones written with
+    writestr(), read back as they were written; with zipfile's internals,
+    and through ZipFile.open() where they're missing"""
+    monkeypatch.setattr(parallelzip, "_HAS_INTERNALS", internals)
+    file_path = path.join(temp_dir, "fred.zip")
+
+    # WHEN writing the entries
+    with zipfile.ZipFile(file_path, "w", zipfile.ZIP_DEFLATED) as zip:
+        for name, content, chunk_size in entries():
+            if chunk_size == 0:
+                zip.writestr(name, content, zipfile.ZIP_DEFLATED)
+            else:
+                write_deflated(zip, name, chunked(content, chunk_size), len(content), workers)
+
+    # THEN the archive is valid, and the entries are as written
+    with zipfile.ZipFile(file_path, "r") as zip:
+        assert zip.testzip() is None
+        assert zip.namelist() == [name for name, _, _ in entries()]
+        for name, content, _ in entries():
+            info = zip.getinfo(name)
+            assert info.compress_type == zipfile.ZIP_DEFLATED
+            assert info.file_size == len(content)
+            assert zip.read(name) == content
+
@@ -0,0 +1,170 @@
+"""Tests for the summary of each column's values, kept as the cells are set."""
+
+import math
+import random
+
+import pytest
+
+from jamovi.server.dataset import Store
+from jamovi.server.dataset import DataType
+from jamovi.server.dataset import MeasureType
+from jamovi.core import Column
+
+
+NAN = float("nan")
+NAN_INT = -2147483648
+ROW_COUNT = 500
+
+
+def check(column):
+    """test that the summary kept is that found afresh from the cells"""
+    kept = column.summary
+    fresh = column.compute_summary()
+    assert kept.count == fresh.count
+    assert kept.min == fresh.min
+    assert kept.max == fresh.max
+    if fresh.sum is None:
+        assert kept.sum is None and kept.sum_sq is None
+    else:
+        assert kept.sum == pytest.approx(fresh.sum)
+        assert kept.sum_sq == pytest.approx(fresh.sum_sq)
+    assert kept.dps == fresh.dps
+
+
+@pytest.fixture(
+    params=[
+        (DataType.INTEGER, MeasureType.CONTINUOUS, lambda i: (i * 37) % 101 - 50),
+        (DataType.INTEGER, MeasureType.NOMINAL, lambda i: (i * 7) % 13),
+        (DataType.DECIMAL, MeasureType.CONTINUOUS, lambda i: ((i * 37) % 101 - 50) / 8),
+        (DataType.TEXT, MeasureType.NOMINAL, lambda i: f"level {(i * 7) % 13}"),
+        (DataType.TEXT, MeasureType.ID, lambda i: f"id {i}"),
+    ],
+    ids=["integer", "nominal", "decimal", "text", "id"],
+)
+def column(shared_memory_store: Store, request):
+    """a data set with a column of each type, with some cells missing"""
+    data_type, measure_type, value = request.param
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(ROW_COUNT)
+    column = ds.append_column("fred")
+    column.change(data_type=data_type, measure_type=measure_type)
+    column.import_values(0, [None if i % 9 == 0 else value(i) for i in range(ROW_COUNT)])
+    check(column)
+    return ds, column
+
+
+def extreme_rows(column):
+    """the rows of the smallest and largest values"""
+    values = [column.raw(i) for i in range(ROW_COUNT)]
+    present = [i for i, v in enumerate(values) if v != NAN_INT and not math.isnan(v)]
+    lo = min(present, key=lambda i: values[i])
+    hi = max(present, key=lambda i: values[i])
+    return lo, hi
+
+
+def test_overwrite(column):
+    """test overwriting cells, including the smallest and largest values,
+    and with missing values"""
+    ds, column = column
+    missing = "" if column.data_type is DataType.TEXT else NAN_INT
+    if column.data_type is DataType.DECIMAL:
+        missing = NAN
+    other = column.get_value(1)
+
+    if column.data_type is not DataType.TEXT:
+        lo, hi = extreme_rows(column)
+        for row_no in (lo, hi):
+            column.set_value(row_no, other)
+            check(column)
+
+    for row_no in (2, 3, 0, 9):
+        column.set_value(row_no, missing)
+        check(column)
+        column.set_value(row_no, other)
+        check(column)
+
+
+def test_insert_delete_rows(column):
+    """test inserting and deleting rows"""
+    ds, column = column
+    ds.insert_rows(10, 19)
+    check(column)
+    ds.delete_rows(0, 4)
+    check(column)
+    ds.delete_rows(ds.row_count - 20, ds.row_count - 1)
+    check(column)
+    ds.set_row_count(ds.row_count + 30)
+    check(column)
+
+
+@pytest.mark.parametrize(
+    ("data_type", "measure_type"),
+    [
+        (DataType.INTEGER, MeasureType.CONTINUOUS),
+        (DataType.INTEGER, MeasureType.NOMINAL),
+        (DataType.DECIMAL, MeasureType.CONTINUOUS),
+        (DataType.TEXT, MeasureType.NOMINAL),
+        (DataType.TEXT, MeasureType.ID),
+    ],
+)
+def test_change_type(column, data_type: DataType, measure_type: MeasureType):
+    """test changing the column's type"""
+    ds, column = column
+    column.change(data_type=data_type, measure_type=measure_type)
+    check(column)
+    column.set_value(4, column.get_value(5))
+    check(column)
+
+
+def test_import_values(column):
+    """test importing values into rows added to the column"""
+    ds, column = column
+    values = [column.get_value(i) for i in range(50)]
+    ds.set_row_count(ROW_COUNT + 50)
+    column.import_values(ROW_COUNT, values)
+    check(column)
+    column.import_values(ROW_COUNT + 25, [None] * 25)
+    check(column)
+
+
+def determine_dps(values: list[float]) -> int:
+    """the decimal places as determine_dps() found them before the summary"""
+    ceiling_dps = 3
+    max_dps = 0
+    for value in values:
+        max_dps = max(max_dps, Column.how_many_dps(value, ceiling_dps))
+        if max_dps == ceiling_dps:
+            break
+    return max_dps
+
+
+def test_determine_dps(shared_memory_store: Store):
+    """test the decimal places found from the summary are those found from
+    each value with how_many_dps()"""
+    ds = shared_memory_store.create_dataset()
+    ds.set_row_count(1)
+    column = ds.append_column("fred")
+    column.change(data_type=DataType.DECIMAL, measure_type=MeasureType.CONTINUOUS)
+
+    rng = random.Random(1)
+    values = [
+        0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 0.1, -0.1, 0.25, 0.125, 0.0625,
+        0.0004, 0.0005, 0.0006, 0.9994, 0.9995, 0.9996, -0.9996, -0.0004,
+        1e-10, -1e-10, 1e20, 1e20 + 0.5, 2.675, 1.005, 123456.789,
+        NAN, float("inf"), float("-inf"),
+    ]
+    values += [rng.uniform(-1000, 1000) for _ in range(500)]
+    values += [round(rng.uniform(-10, 10), rng.randint(0, 4)) for _ in range(500)]
+
+    for value in values:
+        column.set_value(0, value)
+        column.determine_dps()
+        assert column.dps == determine_dps([value]), value
+
+    # AND over many values
+    for start in range(0, len(values), 25):
+        chunk = values[start:start + 25]
+        ds.set_row_count(len(chunk))
+        column.import_values(0, chunk)
+        column.determine_dps()
+        assert column.dps == determine_dps(chunk), chunk
@@ -32,20 +32,20 @@ include_dirs = [
 if os.name == 'nt':  # windows
     libraries = [ "libboost_filesystem-vc143-mt-x64-1_81", "libboost_system-vc143-mt-x64-1_81", "shell32" ]
     library_dirs = [ 'C:/local/boost_1_81_0/lib64-msvc-14.3' ]
-    extra_compile_args = ["/D", "UNICODE"]
+    extra_compile_args = ["/D", "UNICODE", "/std:c++17"]
     extra_link_args = [ ]
     include_dirs += [ 'C:/local/boost_1_81_0' ]
 
 elif os.uname()[0] == "Linux":
     libraries = [ "boost_filesystem", "boost_system" ]
     library_dirs = [ ]
-    extra_compile_args = [ ]
+    extra_compile_args = [ '-std=c++17' ]
     extra_link_args = [ "-Wl,-rpath,'$$ORIGIN/../lib'" ]
 
 elif os.uname()[0] == "Darwin":
     libraries = [ "boost_filesystem", "boost_system" ]
     library_dirs = [ tld + '/../Frameworks' ]
-    extra_compile_args = [ '-mmacosx-version-min=10.13' ]
+    extra_compile_args = [ '-std=c++17', '-mmacosx-version-min=10.13' ]
     extra_link_args = [ "-framework", "Foundation", '-mmacosx-version-min=10.13' ]
 else:
     raise RuntimeError("Shouldn't get here!")